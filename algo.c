@@ -1,5 +1,6 @@
 #include "algo.h"
 #include "math.h"
+#include <string.h>
 
 double round_stat(double stat) {
 	if (isnan(stat) || isinf(stat))
@@ -23,6 +24,188 @@ void print_algo_stat(FILE* stream, algo_stat_t* stat) {
 	        stat->cs_cpu + stat->cs_io, stat->cs_cpu, stat->cs_io);
 	fprintf(stream, "-- number of preemptions: %d (%d/%d)\n",
 	        stat->pre_cpu + stat->pre_io, stat->pre_cpu, stat->pre_io);
+	if (stat->arrived)
+		fprintf(stream, "-- number of arrivals: %d (at most %d live)\n",
+		        stat->arrived, stat->live_max);
+	if (stat->jain > 0) {
+		fprintf(stream, "-- max vruntime spread: %.3f ms\n",
+		        round_stat(stat->vrt_spread));
+		fprintf(stream, "-- Jain's fairness index: %.3f\n", round_stat(stat->jain));
+	}
+	if (stat->deadline.enabled) {
+		const deadline_stat_t* d = &stat->deadline;
+		fprintf(stream, "-- number of deadline misses: %d of %d bursts (%d/%d)\n",
+		        d->miss_cpu + d->miss_io, d->bursts, d->miss_cpu, d->miss_io);
+		fprintf(stream, "-- average lateness: %.3f ms\n", round_stat(d->lateness));
+		fprintf(stream,
+		        "-- tardiness of misses: p50 %.3f ms; p95 %.3f ms; p99 %.3f ms; "
+		        "max %.3f ms\n",
+		        round_stat(d->tardy_p50), round_stat(d->tardy_p95),
+		        round_stat(d->tardy_p99), round_stat(d->tardy_max));
+		fprintf(stream,
+		        "-- burst density: peak %.3f; above 1 for %.3f%% of the "
+		        "time%s\n",
+		        round_stat(d->density_peak), round_stat(d->over_pct),
+		        d->density_peak > 1.0 ? " (deadlines not guaranteed)" : "");
+	}
+	if (stat->share.n > 0) {
+		const share_stat_t* s = &stat->share;
+		fprintf(stream, "-- CPU share (achieved/entitled):");
+		for (int i = 0; i < s->n; ++i)
+			fprintf(stream, " %c %.3f%%/%.3f%%", s->id[i],
+			        round_stat(s->got[i] * 100.0), round_stat(s->due[i] * 100.0));
+		fprintf(stream, "\n");
+		fprintf(stream, "-- largest share error: %.3f%%\n",
+		        round_stat(s->max_err * 100.0));
+	}
+	if (stat->prio.levels > 0) {
+		const prio_stat_t* p = &stat->prio;
+		fprintf(stream, "-- wait by priority (average/max):");
+		for (int l = 0; l < p->levels; ++l) {
+			if (p->bursts[l] == 0) continue;
+			fprintf(stream, " %d %.3f ms/%.3f ms", l, round_stat(p->avg_wait[l]),
+			        round_stat(p->max_wait[l]));
+		}
+		fprintf(stream, "\n");
+		fprintf(stream, "-- number of aging promotions: %d\n", p->promotions);
+	}
+	for (int g = 0; g < stat->group.n; ++g) {
+		const group_stat_t* s = &stat->group;
+		fprintf(stream,
+		        "-- group %d: CPU %.3f%%; throttled %d time%s for %.3f ms; "
+		        "turnaround p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n",
+		        g, round_stat(s->util[g]), s->throttles[g],
+		        s->throttles[g] == 1 ? "" : "s", round_stat(s->throttled[g]),
+		        round_stat(s->lat_p50[g]), round_stat(s->lat_p95[g]),
+		        round_stat(s->lat_p99[g]));
+	}
+	if (stat->mcpu.n > 0) {
+		const mcpu_stat_t* m = &stat->mcpu;
+		for (int k = 0; k < m->classes; ++k) {
+			fprintf(stream,
+			        "-- %d CPU%s at speed %.2f: utilization %.3f%%; average "
+			        "turnaround %.3f ms over %d bursts\n",
+			        m->cpus[k], m->cpus[k] == 1 ? "" : "s", m->speed[k],
+			        round_stat(m->util[k]), round_stat(m->turn[k]), m->bursts[k]);
+		}
+		if (m->cache) {
+			fprintf(stream,
+			        "-- cache reloads: %.3f ms over %d switches (%.3f%% of CPU "
+			        "time); average warmth %.3f; %d migration%s\n",
+			        round_stat(m->reload), m->switches, round_stat(m->reload_pct),
+			        m->warmth, m->migrations, m->migrations == 1 ? "" : "s");
+		}
+		if (m->queues) {
+			fprintf(stream,
+			        "-- load balancing: %d process%s moved, %d migration%s; "
+			        "imbalance %.3f on average, %d at most, 2 or more %.3f%% of "
+			        "the time\n",
+			        m->moved, m->moved == 1 ? "" : "es", m->migrations,
+			        m->migrations == 1 ? "" : "s", round_stat(m->imbalance),
+			        m->imbalance_max, round_stat(m->imbalanced_pct));
+			fprintf(stream, "-- idle while work waited:");
+			for (int k = 0; k < m->n; ++k) {
+				fprintf(stream, " CPU %d %.3f ms", k, round_stat(m->idle_waiting[k]));
+			}
+			fprintf(stream, "\n");
+		}
+	}
+	if (stat->pred.enabled) {
+		fprintf(stream,
+		        "-- burst prediction (%s): mean absolute error %.3f ms; bias "
+		        "%.3f ms over %ld bursts\n",
+		        predict_name(stat->pred.kind), round_stat(stat->pred.mae),
+		        round_stat(stat->pred.bias), stat->pred.n);
+	}
+	if (stat->pred.sweep > 0) {
+		const pred_stat_t* p = &stat->pred;
+		int best = 0;
+		for (int k = 0; k < p->sweep; ++k) {
+			fprintf(stream,
+			        "-- alpha %.2f: mean absolute error %.3f ms; bias %.3f ms\n",
+			        p->sweep_alpha[k], round_stat(p->sweep_mae[k]),
+			        round_stat(p->sweep_bias[k]));
+			if (p->sweep_mae[k] < p->sweep_mae[best]) best = k;
+		}
+		fprintf(stream, "-- lowest prediction error at alpha %.2f\n",
+		        p->sweep_alpha[best]);
+	}
+	for (int d = 0; d < stat->io.n; ++d) {
+		const io_stat_t* io = &stat->io;
+		fprintf(stream,
+		        "-- I/O device %d (%d unit%s, %s): utilization %.3f%%; average "
+		        "queueing delay %.3f ms (max %.3f ms) over %ld requests; longest "
+		        "queue %d\n",
+		        d, io->units[d], io->units[d] == 1 ? "" : "s",
+		        io->discipline[d] == IO_SHORTEST ? "shortest first" : "FIFO",
+		        round_stat(io->util[d]), round_stat(io->delay[d]),
+		        round_stat(io->delay_max[d]), io->requests[d], io->queue_max[d]);
+	}
+	if (stat->conv.enabled) {
+		const conv_stat_t* c = &stat->conv;
+		fprintf(stream,
+		        "-- steady-state average %s time: %.3f ms +/- %.3f ms "
+		        "(%ld of %ld bursts truncated as warm-up)\n",
+		        c->metric == CONV_WAIT ? "wait" : "turnaround", round_stat(c->mean),
+		        round_stat(c->half), c->truncated, c->observed);
+		if (c->stopped) {
+			fprintf(stream,
+			        "-- stopped early at %llums: %ld events simulated, about %ld "
+			        "skipped\n",
+			        c->t_stop, c->events, c->skipped);
+		} else {
+			fprintf(stream, "-- did not converge: %ld events simulated\n",
+			        c->events);
+		}
+	}
+}
+
+const algo_t algos[] = {
+    {"FCFS", algo_fcfs},
+    {"SJF", algo_sjf},
+    {"SRT", algo_srt},
+    {"RR", algo_rr},
+    {"MLFQ", algo_mlfq},
+    {"CFS", algo_cfs},
+    {"EDF", algo_edf},
+    {"EDF-NP", algo_edf_np},
+    {"STRIDE", algo_stride},
+    {"LOTTERY", algo_lottery},
+    {"PRIO", algo_prio},
+    {"GROUP", algo_group},
+    {"MC-FCFS", algo_mc_fcfs, 1},
+    {"MC-SJF", algo_mc_sjf, 1},
+    {"MC-RR", algo_mc_rr, 1},
+    {"MC-FCFS-AFF", algo_mc_fcfs_aff, 2},
+    {"MC-SJF-AFF", algo_mc_sjf_aff, 2},
+    {"MC-RR-AFF", algo_mc_rr_aff, 2},
+    {"SJF-ORACLE", algo_sjf_oracle, 0, "SJF"},
+    {"SRT-ORACLE", algo_srt_oracle, 0, "SRT"},
+};
+const int n_algos = sizeof(algos) / sizeof(algos[0]);
+
+const algo_t* algo_find(const char* name) {
+	for (int i = 0; i < n_algos; ++i) {
+		if (strcmp(algos[i].name, name) == 0) return &algos[i];
+	}
+	return NULL;
+}
+
+int algo_enabled(const algo_t* a, const args_t* args) {
+	if (a->multi_cpu == 2 && args->balance != BAL_SHARED) return 0;
+	return !a->multi_cpu || args->cpus > 0;
+}
+
+void print_oracle_gap(FILE* stream, const char* name, const algo_stat_t* stat,
+                      const algo_stat_t* oracle) {
+	double wait = stat->t_wait.avg - oracle->t_wait.avg;
+	double turn = stat->t_turn.avg - oracle->t_turn.avg;
+	fprintf(stream,
+	        "-- gap of %s to its oracle: wait time %.3f ms (%.3f%%); "
+	        "turnaround time %.3f ms (%.3f%%)\n",
+	        name, wait,
+	        oracle->t_wait.avg > 0 ? wait / oracle->t_wait.avg * 100.0 : 0.0, turn,
+	        oracle->t_turn.avg > 0 ? turn / oracle->t_turn.avg * 100.0 : 0.0);
 }
 
 int exp_avg_tau(float alpha, int b_n, int tau_n) {
@@ -57,8 +240,33 @@ void stat_pre_inc(algo_stat_t* stat, int cpu_bound) {
 	}
 }
 
+void stat_warmup(algo_stat_t* sum, algo_stat_t* ct, sim_time_t warmup,
+                 sim_time_t t, sim_time_t* t_begin) {
+	if (*t_begin < warmup && t >= warmup) {
+		*sum = (algo_stat_t){0};
+		*ct = (algo_stat_t){0};
+		*t_begin = warmup;
+	}
+}
+
+void stat_share(share_stat_t* share, const char* id, const double* received,
+                const double* entitled, const double* runnable, int n) {
+	*share = (share_stat_t){.n = n < SHARE_MAX_PROCS ? n : SHARE_MAX_PROCS};
+	for (int i = 0; i < n; ++i) {
+		double got = runnable[i] > 0 ? received[i] / runnable[i] : 0.0;
+		double due = runnable[i] > 0 ? entitled[i] / runnable[i] : 0.0;
+		if (i < share->n) {
+			share->id[i] = id[i];
+			share->got[i] = got;
+			share->due[i] = due;
+		}
+		double err = fabs(got - due);
+		if (err > share->max_err) share->max_err = err;
+	}
+}
+
 void stat_calc_final(algo_stat_t* sum, const algo_stat_t* ct,
-                     unsigned long t_total) {
+                     sim_time_t t_total) {
 	sum->cpu_util = sum->t_burst.avg / t_total * 100.0;
 	sum->t_burst.avg /= ct->t_burst.avg;
 	sum->t_burst.cpu_avg /= ct->t_burst.cpu_avg;
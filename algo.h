@@ -3,6 +3,9 @@
 
 #include <stdio.h>
 #include "args.h"
+#include "converge.h"
+#include "io_sys.h"
+#include "predict.h"
 #include "process.h"
 
 typedef struct {
@@ -12,6 +15,75 @@ typedef struct {
 } sim_stat_t;
 
 typedef struct {
+	int enabled;       // Whether the algorithm schedules by deadline
+	int bursts;        // CPU bursts completed
+	int miss_cpu;      // Deadline misses (CPU-bound)
+	int miss_io;       // Deadline misses (IO-bound)
+	double lateness;   // Average lateness (completion - deadline)
+	double tardy_p50;  // Percentiles of how late the missed deadlines were
+	double tardy_p95;
+	double tardy_p99;
+	double tardy_max;
+	double density_peak; // Largest density of the pending bursts
+	double over_pct;   // Percent of the time it was above 1 (EDF's bound)
+} deadline_stat_t;
+
+// Processes reported: 'A' to 'Z' (open system: the first 26 slots).
+#define SHARE_MAX_PROCS 26
+
+typedef struct {
+	int n;                       // Processes reported (0 = not proportional-share)
+	char id[SHARE_MAX_PROCS];    // Process (open system: slot) ids
+	double got[SHARE_MAX_PROCS]; // Fraction of the CPU it received while runnable
+	double due[SHARE_MAX_PROCS]; // Fraction its tickets entitled it to
+	double max_err;              // Largest |got - due|
+} share_stat_t;
+
+// Most static priority levels (--priorities).
+#define PRIO_MAX_LEVELS 16
+
+typedef struct {
+	int levels;                        // Priority levels (0 = not a priority scheduler)
+	int bursts[PRIO_MAX_LEVELS];       // CPU bursts completed, by static priority
+	double avg_wait[PRIO_MAX_LEVELS];  // Average wait of a burst
+	double max_wait[PRIO_MAX_LEVELS];  // Longest wait of a burst
+	int promotions;                    // Aging promotions
+} prio_stat_t;
+
+typedef struct {
+	int n;                           // Groups (0 = not a group scheduler)
+	double util[GROUP_MAX];          // Percent of the time the group used the CPU
+	double throttled[GROUP_MAX];     // Time spent throttled
+	int throttles[GROUP_MAX];        // Times the group was throttled
+	double lat_p50[GROUP_MAX];       // Percentiles of CPU burst turnaround
+	double lat_p95[GROUP_MAX];
+	double lat_p99[GROUP_MAX];
+} group_stat_t;
+
+typedef struct {
+	int n;                          // CPUs (0 = single-CPU algorithm)
+	int classes;                    // Distinct CPU speeds, fastest first
+	double speed[MCPU_MAX];         // Speed of each class
+	int cpus[MCPU_MAX];             // CPUs in each class
+	double util[MCPU_MAX];          // Average utilization of a CPU in the class
+	double turn[MCPU_MAX];          // Average turnaround of bursts ending there
+	int bursts[MCPU_MAX];           // CPU bursts that ended there
+	int cache;                      // Whether switch costs follow cache warmth
+	double reload;                  // Time spent reloading caches at switch-in
+	double reload_pct;              // ... as a percentage of all CPU time
+	double warmth;                  // Average cache warmth at switch-in
+	int switches;                   // Switch-ins
+	int migrations;                 // Switch-ins on another CPU than last time
+	int queues;                     // Whether each CPU has its own ready queue
+	int moved;                      // Processes moved between queues
+	double imbalance;               // Average longest minus shortest CPU load
+	int imbalance_max;              // ... at worst
+	double imbalanced_pct;          // Time with loads 2 or more apart (%)
+	double idle_waiting[MCPU_MAX];  // Time each CPU idled while work waited
+} mcpu_stat_t;
+
+typedef struct {
+	int error;          // Whether the run failed; the rest is then meaningless.
 	double cpu_util;
 	sim_stat_t t_burst; // CPU burst time
 	sim_stat_t t_wait;  // wait time
@@ -20,6 +92,18 @@ typedef struct {
 	int cs_io;          // Context switches (IO-bound)
 	int pre_cpu;        // Preemptions (CPU-bound)
 	int pre_io;         // Preemptions (IO-bound)
+	int arrived;        // Open system: arrivals after the warm-up
+	int live_max;       // Open system: most processes live at once
+	conv_stat_t conv;   // Steady-state estimate and early stop
+	double vrt_spread;  // CFS: largest vruntime spread among runnable processes
+	double jain;        // CFS: Jain's index of CPU received vs. fair share
+	deadline_stat_t deadline; // EDF: deadline misses and oversubscription
+	share_stat_t share;       // Stride/lottery: achieved vs. entitled CPU share
+	prio_stat_t prio;         // Priority: starvation by priority class
+	group_stat_t group;       // Group: per-group usage, throttling and latency
+	mcpu_stat_t mcpu;         // Multi-CPU: utilization and turnaround by speed
+	io_stat_t io;             // I/O devices: utilization and queueing delay
+	pred_stat_t pred;         // SJF/SRT: burst prediction error
 } algo_stat_t;
 
 void print_algo_stat(FILE* stream, algo_stat_t* stat);
@@ -27,7 +111,55 @@ void print_algo_stat(FILE* stream, algo_stat_t* stat);
 algo_stat_t algo_fcfs(const args_t* args, process_t* procs);
 algo_stat_t algo_sjf(const args_t* args, process_t* procs);
 algo_stat_t algo_srt(const args_t* args, process_t* procs);
+algo_stat_t algo_sjf_oracle(const args_t* args, process_t* procs);
+algo_stat_t algo_srt_oracle(const args_t* args, process_t* procs);
 algo_stat_t algo_rr(const args_t* args, process_t* procs);
+algo_stat_t algo_mlfq(const args_t* args, process_t* procs);
+algo_stat_t algo_cfs(const args_t* args, process_t* procs);
+algo_stat_t algo_edf(const args_t* args, process_t* procs);
+algo_stat_t algo_edf_np(const args_t* args, process_t* procs);
+algo_stat_t algo_stride(const args_t* args, process_t* procs);
+algo_stat_t algo_lottery(const args_t* args, process_t* procs);
+algo_stat_t algo_prio(const args_t* args, process_t* procs);
+algo_stat_t algo_group(const args_t* args, process_t* procs);
+algo_stat_t algo_mc_fcfs(const args_t* args, process_t* procs);
+algo_stat_t algo_mc_sjf(const args_t* args, process_t* procs);
+algo_stat_t algo_mc_rr(const args_t* args, process_t* procs);
+algo_stat_t algo_mc_fcfs_aff(const args_t* args, process_t* procs);
+algo_stat_t algo_mc_sjf_aff(const args_t* args, process_t* procs);
+algo_stat_t algo_mc_rr_aff(const args_t* args, process_t* procs);
+
+typedef struct {
+	const char* name;
+	algo_stat_t (*run)(const args_t* args, process_t* procs);
+	// Runs only when args->cpus is given; 2 if also only with a shared ready
+	// queue, where it differs from the same policy without affinity.
+	int multi_cpu;
+	const char* oracle_of; // Algorithm this one is the clairvoyant baseline of.
+} algo_t;
+
+/**
+ * Every algorithm, in the order they are simulated and reported.
+ */
+extern const algo_t algos[];
+extern const int n_algos;
+
+/**
+ * @return The algorithm called name, or NULL if there is none.
+ */
+const algo_t* algo_find(const char* name);
+
+/**
+ * @return Whether algorithm a runs with these options.
+ */
+int algo_enabled(const algo_t* a, const args_t* args);
+
+/**
+ * Print how far the wait and turnaround of algorithm name, in stat, are from
+ * those of its clairvoyant oracle.
+ */
+void print_oracle_gap(FILE* stream, const char* name, const algo_stat_t* stat,
+                      const algo_stat_t* oracle);
 
 int exp_avg_tau(float alpha, int b_n, int tau_n);
 
@@ -51,6 +183,27 @@ void stat_cs_inc(algo_stat_t* stat, int cpu_bound);
  */
 void stat_pre_inc(algo_stat_t* stat, int cpu_bound);
 
+/**
+ * Discard the statistics gathered during the warm-up period. Call with the
+ * time of each event before recording its statistics.
+ *
+ * @param sum Statistic sums.
+ * @param ct Statistic counts.
+ * @param warmup End of the warm-up period.
+ * @param t Current simulation time.
+ * @param t_begin Time measurement began; start it at 0.
+ */
+void stat_warmup(algo_stat_t* sum, algo_stat_t* ct, sim_time_t warmup,
+                 sim_time_t t, sim_time_t* t_begin);
+
+/**
+ * Fill share from the CPU time each of the n processes received and was
+ * entitled to, as fractions of the time it was runnable. The first
+ * SHARE_MAX_PROCS are reported; the largest error is over all n.
+ */
+void stat_share(share_stat_t* share, const char* id, const double* received,
+                const double* entitled, const double* runnable, int n);
+
 /*
  * Calculates final statistics with sums and counts and stores the averages
  * in sum.
@@ -60,6 +213,6 @@ void stat_pre_inc(algo_stat_t* stat, int cpu_bound);
  * @param t_total Total simulation runtime.
  */
 void stat_calc_final(algo_stat_t* sum, const algo_stat_t* ct,
-                     unsigned long t_total);
+                     sim_time_t t_total);
 
 #endif // OPSYS_SIM_ALGO_H_
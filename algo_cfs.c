@@ -0,0 +1,529 @@
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "open_sys.h"
+#include "queue.h"
+
+/*
+Completely fair scheduler, after Linux CFS. Each process has a load weight
+from its nice level and a virtual runtime: the CPU time it has received,
+scaled by 1024 / weight. The ready queue is a heap keyed on vruntime and the
+process with the smallest vruntime runs next.
+
+- A running process gets a slice of the scheduling period in proportion to
+  its weight, where the period is args->cfs_latency, stretched to
+  args->cfs_min_gran per process when too many are runnable. No slice is
+  shorter than the minimum granularity.
+- When its slice expires, the process keeps the CPU unless the head of the
+  ready queue has a smaller vruntime.
+- A process that arrives or completes I/O preempts the running process if
+  its vruntime is smaller by more than the minimum granularity.
+- New processes start at the queue's minimum vruntime; processes waking from
+  I/O get at most half a target latency of credit below it.
+
+Fairness is measured against a weighted fair share: while runnable, each
+process is entitled to its weight's fraction of the time.
+
+Ties between events are broken in the same order as RR.
+*/
+
+enum event_type {
+	EV_PROC_CPU_STOP = 0,
+	EV_PROC_CPU_PREEMPTION,
+	EV_PROC_CPU_START,
+	EV_PROC_CPU_CS,
+	EV_PROC_IO_STOP,
+	EV_PROC_ARRIVAL,
+};
+
+typedef struct {
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
+	enum event_type type; // Event type.
+	int burst;            // Current burst ID associated with event.
+} event_t;
+
+int Q_event_cmp_cfs(const void* lhs, const void* rhs) {
+	const event_t *lhe = lhs, *rhe = rhs;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
+	int d_type = (int) lhe->type - (int) rhe->type;
+	int d_id = lhe->id - rhe->id;
+	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
+}
+
+typedef struct {
+	int id;           // Ready queue process id.
+	int weight;       // Load weight from the nice level.
+	double vruntime;  // Virtual runtime, in nice-0 milliseconds.
+	int burst;        // Current burst ID.
+	int remaining;    // CPU time left in the current burst.
+	int started;      // Whether the current burst has used the CPU yet.
+	sim_time_t t_join;  // When the current burst became ready. (turnaround)
+	sim_time_t p_join;  // When this process joined the ready queue. (wait)
+	long wait_obs;      // Its observation of the wait (conv_add()).
+	int runnable;     // Whether it is ready or running rather than blocked.
+	double v_join;    // Fair-share clock when it last became runnable.
+	double received;  // CPU time received.
+	double entitled;  // CPU time its weighted fair share would have given.
+} ready_t;
+
+#define CFS_NICE_0_WEIGHT 1024
+
+// Load weight of each nice level from -20 to 19, as in Linux.
+static const int cfs_weights[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,    36,    29,    23,    18,    15,
+};
+
+int Q_ready_cmp_cfs(const void* lhs, const void* rhs) {
+	const ready_t *lhg = lhs, *rhg = rhs;
+	if (lhg->vruntime != rhg->vruntime)
+		return lhg->vruntime < rhg->vruntime ? -1 : 1;
+	return lhg->id - rhg->id;
+}
+
+void print_ready_queue_cfs(FILE* out, const void* q, int n) {
+	queue_t* q2 = make_queue();
+	queue_copy(q2, q);
+	fprintf(out, "[Q");
+	if (queue_peek(q2) == NULL) {
+		fprintf(out, " <empty>");
+	} else {
+		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
+			fprintf(out, " %c", g->id);
+		}
+	}
+	fprintf(out, "]");
+	free_queue(&q2);
+}
+
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_cfs, Q, 0, str); \
+	} while (0)
+
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_cfs, Q, 0, fmt, __VA_ARGS__); \
+	} while (0)
+
+/**
+ * The slice of a process with the given weight when w_total is the weight of
+ * all nr runnable processes.
+ */
+unsigned slice_cfs(const args_t* args, int weight, long w_total, int nr) {
+	unsigned long period = args->cfs_latency;
+	if (nr > (long) (args->cfs_latency / args->cfs_min_gran))
+		period = nr * args->cfs_min_gran;
+	unsigned long slice = ceil((double) period * weight / w_total);
+	return slice > args->cfs_min_gran ? slice : args->cfs_min_gran;
+}
+
+/**
+ * Charge g for the CPU time since run_start.
+ */
+void account_cfs(ready_t* g, sim_time_t t, sim_time_t run_start) {
+	unsigned ran = t - run_start;
+	g->remaining -= ran;
+	g->received += ran;
+	g->vruntime += (double) ran * CFS_NICE_0_WEIGHT / g->weight;
+}
+
+/**
+ * Set e to the end of the running process's slice or burst, whichever is
+ * sooner.
+ */
+void schedule_run_cfs(event_t* e, const ready_t* g, unsigned slice, sim_time_t t) {
+	if ((unsigned) g->remaining <= slice) {
+		e->time = t + g->remaining;
+		e->type = EV_PROC_CPU_STOP;
+	} else {
+		e->time = t + slice;
+		e->type = EV_PROC_CPU_PREEMPTION;
+	}
+}
+
+algo_stat_t algo_cfs(const args_t* args, process_t* procs) {
+	algo_stat_t cfs_stats = {0}, cfs_counts = {0};
+
+	queue_t *Q_event = make_queue(), *Q_ready = make_queue();
+	queue_set_cmp(Q_event, Q_event_cmp_cfs);
+	queue_set_cmp(Q_ready, Q_ready_cmp_cfs);
+
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = procs[i].arrival_time,
+		               .id = procs[i].id,
+		               .type = EV_PROC_ARRIVAL,
+		               .burst = 0};
+		queue_push(Q_event, e);
+
+		guesses[i]->id = procs[i].id;
+	}
+
+	sim_time_t t = 0;
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for CFS", Q_ready);
+
+	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+
+	// The pending stop or slice expiry of the running process.
+	event_t* e_run = NULL;
+	sim_time_t run_start = 0;
+
+	double min_vruntime = 0.0;
+	long w_run = 0; // Total weight of runnable processes.
+	int nr_run = 0; // Runnable processes.
+
+	// Fair-share clock: advances by dt / w_run, so a process of weight w is
+	// entitled to w * (v_fair - v_join) ms of CPU.
+	double v_fair = 0.0;
+	sim_time_t t_prev = 0;
+
+	// Fairness of finished processes.
+	double jain_sum = 0.0, jain_sq = 0.0;
+	int jain_n = 0;
+
+	sim_time_t t_begin = 0, t_fair = 0;
+	int cfs_error = 0;
+	while (cfs_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		event_t* e = queue_pop(Q_event);
+
+		t = e->time;
+		stat_warmup(&cfs_stats, &cfs_counts, args->warmup, t, &t_begin);
+
+		if (w_run > 0) v_fair += (double) (t - t_prev) / w_run;
+		t_prev = t;
+		if (t_fair != t_begin) {
+			// Warm-up over: measure fairness from here.
+			for (int i = 0; i < n_slots; ++i) {
+				guesses[i]->received = guesses[i]->entitled = 0.0;
+				guesses[i]->v_join = v_fair;
+			}
+			jain_sum = jain_sq = 0.0;
+			jain_n = 0;
+			cfs_stats.vrt_spread = 0.0;
+			t_fair = t_begin;
+		}
+
+		ready_t* woken = NULL;
+		switch (e->type) {
+		case EV_PROC_CPU_STOP: {
+			ready_t* g = guesses[e->id - 'A'];
+			account_cfs(g, t, run_start);
+			e_run = NULL;
+
+			// Blocks until the next burst is ready.
+			g->runnable = 0;
+			g->entitled += g->weight * (v_fair - g->v_join);
+			w_run -= g->weight;
+			--nr_run;
+
+			double t_turn = t - g->t_join + args->Tcs / 2;
+			stat_avg_add(&cfs_stats.t_turn, &cfs_counts.t_turn, t_turn,
+			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+
+			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
+			if (bursts_left == 0) {
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				if (g->entitled > 0) {
+					double x = g->received / g->entitled;
+					jain_sum += x;
+					jain_sq += x * x;
+					++jain_n;
+				}
+				open_sys_retire(&os, e->id - 'A');
+				free(e);
+			} else {
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+				             "Process %c (vruntime %.1fms) completed a CPU burst; %d "
+				             "burst%s to go",
+				             Q_ready, e->id, g->vruntime, bursts_left,
+				             bursts_left == 1 ? "" : "s");
+
+				// Requeue IO burst completion once its device takes it.
+				e->type = EV_PROC_IO_STOP;
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
+			}
+
+			// Simulate context switch.
+			cpu_mode = CM_CS;
+			event_t* e_out = malloc(sizeof(event_t));
+			*e_out = (event_t){.id = '#', .time = t + args->Tcs / 2, .type = EV_PROC_CPU_CS};
+			queue_push(Q_event, e_out);
+
+			break;
+		}
+		case EV_PROC_CPU_PREEMPTION: {
+			// Slice expired.
+			ready_t* g = guesses[e->id - 'A'];
+			account_cfs(g, t, run_start);
+
+			ready_t* left = queue_peek(Q_ready);
+			if (left == NULL || left->vruntime >= g->vruntime) {
+				printf_event(t, 0, OBS_OTHER, e->id, 0,
+				             "Time slice expired; no preemption because process %c has the smallest vruntime",
+				             Q_ready, e->id);
+				run_start = t;
+				schedule_run_cfs(e, g, slice_cfs(args, g->weight, w_run, nr_run), t);
+				queue_push(Q_event, e);
+			} else {
+				printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+				             "Time slice expired; preempting process %c with %dms remaining",
+				             Q_ready, e->id, g->remaining);
+				stat_pre_inc(&cfs_stats, procs[e->id - 'A'].cpu_bound);
+				e_run = NULL;
+				cpu_mode = CM_CS;
+				e->time = t + args->Tcs / 2;
+				e->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e);
+			}
+			break;
+		}
+		case EV_PROC_CPU_START: {
+			ready_t* g = guesses[e->id - 'A'];
+			int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+			if (g->remaining != burst_len) {
+				printf_event(t, 0, OBS_START, e->id, g->remaining,
+				             "Process %c (vruntime %.1fms) started using the CPU "
+				             "for remaining %dms of %dms burst",
+				             Q_ready, e->id, g->vruntime, g->remaining, burst_len);
+			} else {
+				printf_event(t, 0, OBS_START, e->id, burst_len,
+				             "Process %c (vruntime %.1fms) started using the CPU "
+				             "for %dms burst",
+				             Q_ready, e->id, g->vruntime, burst_len);
+			}
+
+			cpu_mode = CM_BURST;
+			run_start = t;
+			schedule_run_cfs(e, g, slice_cfs(args, g->weight, w_run, nr_run), t);
+			queue_push(Q_event, e);
+			e_run = e;
+
+			stat_cs_inc(&cfs_stats, procs[e->id - 'A'].cpu_bound);
+
+			// Track how far apart the runnable processes' vruntimes drift.
+			double lo = INFINITY, hi = -INFINITY;
+			for (int i = 0; i < n_slots; ++i) {
+				if (!guesses[i]->runnable) continue;
+				if (guesses[i]->vruntime < lo) lo = guesses[i]->vruntime;
+				if (guesses[i]->vruntime > hi) hi = guesses[i]->vruntime;
+			}
+			if (hi - lo > cfs_stats.vrt_spread) cfs_stats.vrt_spread = hi - lo;
+			break;
+		}
+		case EV_PROC_CPU_CS: {
+			// Switch out done; a preempted process rejoins the ready queue.
+			if (e->id != '#') {
+				ready_t* g = guesses[e->id - 'A'];
+				g->p_join = t;
+				queue_push(Q_ready, g);
+			}
+
+			cpu_mode = CM_IDLE;
+			free(e);
+			break;
+		}
+		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			ready_t* g = guesses[e->id - 'A'];
+			g->burst = e->burst + 1;
+			g->remaining = procs[e->id - 'A'].cpu_bursts[g->burst];
+			g->started = 0;
+			g->t_join = t;
+			g->p_join = t;
+			stat_avg_add(&cfs_stats.t_burst, &cfs_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			// Sleeper credit is capped at half a target latency.
+			double floor_vr = min_vruntime - args->cfs_latency / 2.0;
+			if (g->vruntime < floor_vr) g->vruntime = floor_vr;
+
+			g->runnable = 1;
+			g->v_join = v_fair;
+			w_run += g->weight;
+			++nr_run;
+
+			queue_push(Q_ready, g);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
+			             "Process %c (vruntime %.1fms) completed I/O; "
+			             "added to ready queue",
+			             Q_ready, e->id, g->vruntime);
+			woken = g;
+			free(e);
+			break;
+		}
+		case EV_PROC_ARRIVAL: {
+			ready_t* g = guesses[e->id - 'A'];
+			*g = (ready_t){.id = e->id,
+			               .weight = cfs_weights[procs[e->id - 'A'].nice + 20],
+			               .vruntime = min_vruntime,
+			               .remaining = procs[e->id - 'A'].cpu_bursts[0],
+			               .t_join = t,
+			               .p_join = t,
+			               .runnable = 1,
+			               .v_join = v_fair};
+			w_run += g->weight;
+			++nr_run;
+			stat_avg_add(&cfs_stats.t_burst, &cfs_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			queue_push(Q_ready, g);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (nice %d) arrived; added to ready queue",
+			             Q_ready, e->id, procs[e->id - 'A'].nice);
+			woken = g;
+			free(e);
+			break;
+		}
+		default:
+			fprintf(stderr, "ERROR: invalid event type %d.\n", e->type);
+			cfs_error = 1;
+			free(e);
+			break;
+		}
+
+		// Wakeup preemption.
+		if (woken && cpu_mode == CM_BURST) {
+			ready_t* g = guesses[e_run->id - 'A'];
+			double curr_vr =
+			    g->vruntime + (double) (t - run_start) * CFS_NICE_0_WEIGHT / g->weight;
+			if (curr_vr - woken->vruntime > args->cfs_min_gran) {
+				account_cfs(g, t, run_start);
+				queue_delete(Q_event, queue_search(Q_event, e_run));
+				printf_event(t, 0, OBS_PREEMPT, e_run->id, g->remaining,
+				             "Process %c (vruntime %.1fms) preempting %c with %dms remaining",
+				             Q_ready, woken->id, woken->vruntime, e_run->id,
+				             g->remaining);
+				stat_pre_inc(&cfs_stats, procs[e_run->id - 'A'].cpu_bound);
+
+				cpu_mode = CM_CS;
+				e_run->time = t + args->Tcs / 2;
+				e_run->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e_run);
+				e_run = NULL;
+			}
+		}
+
+		// min_vruntime only moves forward.
+		ready_t* left = queue_peek(Q_ready);
+		double v = e_run ? guesses[e_run->id - 'A']->vruntime
+		                 : (left ? left->vruntime : min_vruntime);
+		if (left && left->vruntime < v) v = left->vruntime;
+		if (v > min_vruntime) min_vruntime = v;
+
+		if (cpu_mode == CM_IDLE) {
+			// Context switch in the process with the smallest vruntime.
+			ready_t* r = queue_pop(Q_ready);
+			if (r) {
+				event_t* e_start = malloc(sizeof(event_t));
+				*e_start = (event_t){.time = t + args->Tcs / 2,
+				                     .id = r->id,
+				                     .type = EV_PROC_CPU_START,
+				                     .burst = r->burst};
+				queue_push(Q_event, e_start);
+				cpu_mode = CM_CS;
+
+				// A preempted burst's later waits add to its first.
+				stat_avg_add(&cfs_stats.t_wait, r->started ? NULL : &cfs_counts.t_wait,
+				             t - r->p_join, procs[r->id - 'A'].cpu_bound);
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->started ? r->wait_obs : CONV_NEW);
+				r->started = 1;
+			}
+		}
+	}
+
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for CFS", Q_ready);
+
+	// Processes cut off by an early stop or the end of an open-system run.
+	for (int i = 0; i < n_slots; ++i) {
+		ready_t* g = guesses[i];
+		if (g->runnable) g->entitled += g->weight * (v_fair - g->v_join);
+		if (g->runnable && g->entitled > 0) {
+			double x = g->received / g->entitled;
+			jain_sum += x;
+			jain_sq += x * x;
+			++jain_n;
+		}
+	}
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+
+	free_queue(&Q_ready);
+	free_queue(&Q_event);
+	open_sys_free_state((void**) guesses, n_slots);
+
+	stat_calc_final(&cfs_stats, &cfs_counts, t - t_begin);
+	cfs_stats.jain = jain_sq > 0 ? jain_sum * jain_sum / (jain_n * jain_sq) : 0.0;
+	cfs_stats.arrived = os.arrived;
+	cfs_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &cfs_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &cfs_stats.conv);
+
+	cfs_stats.error = cfs_error;
+	return cfs_stats;
+}
@@ -0,0 +1,441 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "hist.h"
+#include "open_sys.h"
+#include "queue.h"
+
+/*
+Earliest deadline first. Each CPU burst has an absolute deadline: the time it
+became ready plus its relative deadline from the workload (--deadline), or
+twice its length if the workload has none. The ready queue is a heap keyed on
+deadline and the burst with the earliest deadline runs next.
+
+- Preemptive EDF: a process that arrives or completes I/O preempts the
+  running process if its deadline is earlier.
+- Non-preemptive EDF: a burst runs to completion once started.
+
+Deadlines are soft: a late burst still runs to completion, and its lateness
+is recorded when it leaves the CPU.
+
+A pending burst of length C and relative deadline D has density C / D. On
+one CPU, EDF meets every deadline while the summed density of the pending
+bursts stays at or below 1; the run reports how often it did not.
+
+Ties between events are broken in the same order as RR.
+*/
+
+enum event_type {
+	EV_PROC_CPU_STOP = 0,
+	EV_PROC_CPU_START,
+	EV_PROC_CPU_CS,
+	EV_PROC_IO_STOP,
+	EV_PROC_ARRIVAL,
+};
+
+typedef struct {
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
+	enum event_type type; // Event type.
+	int burst;            // Current burst ID associated with event.
+} event_t;
+
+int Q_event_cmp_edf(const void* lhs, const void* rhs) {
+	const event_t *lhe = lhs, *rhe = rhs;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
+	int d_type = (int) lhe->type - (int) rhe->type;
+	int d_id = lhe->id - rhe->id;
+	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
+}
+
+typedef struct {
+	int id;            // Ready queue process id.
+	sim_time_t deadline; // Absolute deadline of the current burst.
+	int burst;         // Current burst ID.
+	int remaining;     // CPU time left in the current burst.
+	int started;       // Whether the current burst has used the CPU yet.
+	sim_time_t t_join;   // When the current burst became ready. (turnaround)
+	sim_time_t p_join;   // When this process joined the ready queue. (wait)
+	long wait_obs;       // Its observation of the wait (conv_add()).
+	double density;    // Of the pending burst.
+} ready_t;
+
+int Q_ready_cmp_edf(const void* lhs, const void* rhs) {
+	const ready_t *lhg = lhs, *rhg = rhs;
+	if (lhg->deadline != rhg->deadline)
+		return lhg->deadline < rhg->deadline ? -1 : 1;
+	return lhg->id - rhg->id;
+}
+
+void print_ready_queue_edf(FILE* out, const void* q, int n) {
+	queue_t* q2 = make_queue();
+	queue_copy(q2, q);
+	fprintf(out, "[Q");
+	if (queue_peek(q2) == NULL) {
+		fprintf(out, " <empty>");
+	} else {
+		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
+			fprintf(out, " %c", g->id);
+		}
+	}
+	fprintf(out, "]");
+	free_queue(&q2);
+}
+
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_edf, Q, 0, str); \
+	} while (0)
+
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_edf, Q, 0, fmt, __VA_ARGS__); \
+	} while (0)
+
+/**
+ * Make burst j of process p ready at time t.
+ */
+void release_edf(ready_t* g, const process_t* p, int j, sim_time_t t) {
+	g->burst = j;
+	g->remaining = p->cpu_bursts[j];
+	int d = p->deadlines ? p->deadlines[j] : 2 * p->cpu_bursts[j];
+	g->deadline = t + d;
+	g->density = d > 0 ? (double) p->cpu_bursts[j] / d : 1.0;
+	g->started = 0;
+	g->t_join = t;
+	g->p_join = t;
+}
+
+algo_stat_t run_edf(const args_t* args, process_t* procs, int preemptive) {
+	const char* name = preemptive ? "EDF" : "EDF-NP";
+	algo_stat_t edf_stats = {0}, edf_counts = {0};
+
+	queue_t *Q_event = make_queue(), *Q_ready = make_queue();
+	queue_set_cmp(Q_event, Q_event_cmp_edf);
+	queue_set_cmp(Q_ready, Q_ready_cmp_edf);
+
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = procs[i].arrival_time,
+		               .id = procs[i].id,
+		               .type = EV_PROC_ARRIVAL,
+		               .burst = 0};
+		queue_push(Q_event, e);
+
+		guesses[i]->id = procs[i].id;
+	}
+
+	sim_time_t t = 0;
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for %s", Q_ready,
+	             name);
+
+	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+
+	// The pending stop of the running process.
+	event_t* e_run = NULL;
+	sim_time_t run_start = 0;
+
+	// Density of the pending bursts, and the time it spent above 1.
+	double density = 0.0;
+	sim_time_t t_over = 0;
+	sim_time_t t_prev = 0;
+
+	// Tardiness of missed deadlines.
+	hist_t* tardy = calloc(1, sizeof(hist_t));
+
+	sim_time_t t_begin = 0, t_measure = 0;
+	int edf_error = 0;
+	while (edf_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		event_t* e = queue_pop(Q_event);
+
+		t = e->time;
+		stat_warmup(&edf_stats, &edf_counts, args->warmup, t, &t_begin);
+
+		if (density > 1.0) t_over += t - t_prev;
+		t_prev = t;
+		if (t_measure != t_begin) {
+			// Warm-up over: measure deadlines and load from here.
+			*tardy = (hist_t){0};
+			t_over = 0;
+			edf_stats.deadline.density_peak = density;
+			t_measure = t_begin;
+		}
+
+		ready_t* woken = NULL;
+		switch (e->type) {
+		case EV_PROC_CPU_STOP: {
+			ready_t* g = guesses[e->id - 'A'];
+			int cpu_bound = procs[e->id - 'A'].cpu_bound;
+			e_run = NULL;
+			density -= g->density;
+
+			double t_turn = t - g->t_join + args->Tcs / 2;
+			stat_avg_add(&edf_stats.t_turn, &edf_counts.t_turn, t_turn, cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+
+			double late = (double) t - g->deadline;
+			++edf_stats.deadline.bursts;
+			edf_stats.deadline.lateness += late;
+			if (late > 0) {
+				if (cpu_bound) {
+					++edf_stats.deadline.miss_cpu;
+				} else {
+					++edf_stats.deadline.miss_io;
+				}
+				hist_add(tardy, late);
+			}
+
+			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
+			if (bursts_left == 0) {
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
+				free(e);
+			} else {
+				if (late > 0) {
+					printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+					             "Process %c completed a CPU burst %.0fms past its "
+					             "deadline; %d burst%s to go",
+					             Q_ready, e->id, late, bursts_left,
+					             bursts_left == 1 ? "" : "s");
+				} else {
+					printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+					             "Process %c completed a CPU burst; %d burst%s to go",
+					             Q_ready, e->id, bursts_left,
+					             bursts_left == 1 ? "" : "s");
+				}
+
+				// Requeue IO burst completion once its device takes it.
+				e->type = EV_PROC_IO_STOP;
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
+			}
+
+			// Simulate context switch.
+			cpu_mode = CM_CS;
+			event_t* e_out = malloc(sizeof(event_t));
+			*e_out = (event_t){.id = '#', .time = t + args->Tcs / 2, .type = EV_PROC_CPU_CS};
+			queue_push(Q_event, e_out);
+
+			break;
+		}
+		case EV_PROC_CPU_START: {
+			ready_t* g = guesses[e->id - 'A'];
+			int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+			if (g->remaining != burst_len) {
+				printf_event(t, 0, OBS_START, e->id, g->remaining,
+				             "Process %c (deadline %llums) started using the CPU for "
+				             "remaining %dms of %dms burst",
+				             Q_ready, e->id, g->deadline, g->remaining, burst_len);
+			} else {
+				printf_event(t, 0, OBS_START, e->id, burst_len,
+				             "Process %c (deadline %llums) started using the CPU for "
+				             "%dms burst",
+				             Q_ready, e->id, g->deadline, burst_len);
+			}
+
+			cpu_mode = CM_BURST;
+			run_start = t;
+			e->time = t + g->remaining;
+			e->type = EV_PROC_CPU_STOP;
+			queue_push(Q_event, e);
+			e_run = e;
+
+			stat_cs_inc(&edf_stats, procs[e->id - 'A'].cpu_bound);
+
+			// A burst with an earlier deadline became ready during the switch.
+			ready_t* left = queue_peek(Q_ready);
+			if (preemptive && left && left->deadline < g->deadline) woken = left;
+			break;
+		}
+		case EV_PROC_CPU_CS: {
+			// Switch out done; a preempted process rejoins the ready queue.
+			if (e->id != '#') {
+				ready_t* g = guesses[e->id - 'A'];
+				g->p_join = t;
+				queue_push(Q_ready, g);
+			}
+
+			cpu_mode = CM_IDLE;
+			free(e);
+			break;
+		}
+		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			ready_t* g = guesses[e->id - 'A'];
+			release_edf(g, &procs[e->id - 'A'], e->burst + 1, t);
+			stat_avg_add(&edf_stats.t_burst, &edf_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+			density += g->density;
+			if (density > edf_stats.deadline.density_peak)
+				edf_stats.deadline.density_peak = density;
+
+			queue_push(Q_ready, g);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
+			             "Process %c (deadline %llums) completed I/O; added to ready "
+			             "queue",
+			             Q_ready, e->id, g->deadline);
+			woken = g;
+			free(e);
+			break;
+		}
+		case EV_PROC_ARRIVAL: {
+			ready_t* g = guesses[e->id - 'A'];
+			*g = (ready_t){.id = e->id};
+			release_edf(g, &procs[e->id - 'A'], 0, t);
+			stat_avg_add(&edf_stats.t_burst, &edf_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+			density += g->density;
+			if (density > edf_stats.deadline.density_peak)
+				edf_stats.deadline.density_peak = density;
+
+			queue_push(Q_ready, g);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (deadline %llums) arrived; added to ready queue",
+			             Q_ready, e->id, g->deadline);
+			woken = g;
+			free(e);
+			break;
+		}
+		default:
+			fprintf(stderr, "ERROR: invalid event type %d.\n", e->type);
+			edf_error = 1;
+			free(e);
+			break;
+		}
+
+		// An earlier deadline preempts the running burst.
+		if (preemptive && woken && cpu_mode == CM_BURST &&
+		    woken->deadline < guesses[e_run->id - 'A']->deadline) {
+			ready_t* g = guesses[e_run->id - 'A'];
+			g->remaining -= t - run_start;
+			queue_delete(Q_event, queue_search(Q_event, e_run));
+			printf_event(t, 0, OBS_PREEMPT, e_run->id, g->remaining,
+			             "Process %c (deadline %llums) preempting %c with %dms "
+			             "remaining",
+			             Q_ready, woken->id, woken->deadline, e_run->id,
+			             g->remaining);
+			stat_pre_inc(&edf_stats, procs[e_run->id - 'A'].cpu_bound);
+
+			cpu_mode = CM_CS;
+			e_run->time = t + args->Tcs / 2;
+			e_run->type = EV_PROC_CPU_CS;
+			queue_push(Q_event, e_run);
+			e_run = NULL;
+		}
+
+		if (cpu_mode == CM_IDLE) {
+			// Context switch in the burst with the earliest deadline.
+			ready_t* r = queue_pop(Q_ready);
+			if (r) {
+				event_t* e_start = malloc(sizeof(event_t));
+				*e_start = (event_t){.time = t + args->Tcs / 2,
+				                     .id = r->id,
+				                     .type = EV_PROC_CPU_START,
+				                     .burst = r->burst};
+				queue_push(Q_event, e_start);
+				cpu_mode = CM_CS;
+
+				// A preempted burst's later waits add to its first.
+				stat_avg_add(&edf_stats.t_wait, r->started ? NULL : &edf_counts.t_wait,
+				             t - r->p_join, procs[r->id - 'A'].cpu_bound);
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->started ? r->wait_obs : CONV_NEW);
+				r->started = 1;
+			}
+		}
+	}
+
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for %s", Q_ready,
+	             name);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+
+	free_queue(&Q_ready);
+	free_queue(&Q_event);
+	open_sys_free_state((void**) guesses, n_slots);
+
+	stat_calc_final(&edf_stats, &edf_counts, t - t_begin);
+	deadline_stat_t* d = &edf_stats.deadline;
+	d->enabled = 1;
+	if (d->bursts > 0) d->lateness /= d->bursts;
+	d->tardy_p50 = hist_percentile(tardy, 50);
+	d->tardy_p95 = hist_percentile(tardy, 95);
+	d->tardy_p99 = hist_percentile(tardy, 99);
+	d->tardy_max = tardy->max;
+	d->over_pct = t > t_begin ? t_over * 100.0 / (t - t_begin) : 0.0;
+	free(tardy);
+
+	edf_stats.arrived = os.arrived;
+	edf_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &edf_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &edf_stats.conv);
+
+	edf_stats.error = edf_error;
+	return edf_stats;
+}
+
+algo_stat_t algo_edf(const args_t* args, process_t* procs) {
+	return run_edf(args, procs, 1);
+}
+
+algo_stat_t algo_edf_np(const args_t* args, process_t* procs) {
+	return run_edf(args, procs, 0);
+}
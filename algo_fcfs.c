@@ -1,7 +1,10 @@
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include "algo.h"
+#include "ckpt.h"
+#include "open_sys.h"
 #include "queue.h"
 
 enum event_type {
@@ -13,74 +16,174 @@ enum event_type {
 };
 
 typedef struct {
-	unsigned time;        // Event time.
-	char id;              // Process id associated with event.
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
 	enum event_type type; // Event type.
 	int burst;            // Current burst ID associated with event.
 } event_t;
 
 int Q_event_cmp_fcfs(const void* lhs, const void* rhs) {
 	const event_t *lhe = lhs, *rhe = rhs;
-	int d_time = lhe->time - rhe->time;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
 	int d_type = (int) lhe->type - (int) rhe->type;
 	int d_id = lhe->id - rhe->id;
 	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
 }
 
 typedef struct {
-	char id; // Ready queue process id.
-	unsigned arrival;
+	int id; // Ready queue process id.
+	sim_time_t arrival;
 	int burst;       // Next burst ID.
-	unsigned t_join; // When this process joined the ready queue.	
+	sim_time_t t_join; // When this process joined the ready queue.	
 } ready_t;
 
 int Q_ready_cmp_fcfs(const void* lhs, const void* rhs) {
 	const ready_t *lhg = lhs, *rhg = rhs;
-	int d_arrival = lhg->arrival - rhg->arrival;
+	int d_arrival = SIM_TIME_CMP(lhg->arrival, rhg->arrival);
 	int d_id = lhg->id - rhg->id;
 
 	return d_arrival == 0 ? d_id : d_arrival;
 }
 
-void print_ready_queue_fcfs(queue_t* q) {
+void print_ready_queue_fcfs(FILE* out, const void* q, int n) {
 	queue_t* q2 = make_queue();
 	queue_copy(q2, q);
-	printf("[Q");
+	fprintf(out, "[Q");
 	if (queue_peek(q2) == NULL) {
-		printf(" <empty>");
+		fprintf(out, " <empty>");
 	} else {
 		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
-			printf(" %c", g->id);
+			fprintf(out, " %c", g->id);
 		}
 	}
-	printf("]");
+	fprintf(out, "]");
 	free_queue(&q2);
 }
 
-#ifdef DEBUG_MODE
-#define DALWAYS_PRINT 1
-#else
-#define DALWAYS_PRINT 0
-#endif
-
-#define print_event(t, always_print, str, Q) \
+#define print_event(t, always_print, kind, id, arg, str, Q) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " str " ", t); \
-			print_ready_queue_fcfs(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_fcfs, Q, 0, str); \
 	} while (0)
 
-#define printf_event(t, always_print, fmt, Q, ...) \
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " fmt " ", t, __VA_ARGS__); \
-			print_ready_queue_fcfs(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_fcfs, Q, 0, fmt, __VA_ARGS__); \
 	} while (0)
 
+enum cpu_mode { CM_IDLE = 0, CM_CS, CM_BURST };
+
+/**
+ * Write or read the state of an FCFS run between two events: the state every
+ * engine shares, then, unless restoring another engine's checkpoint, FCFS's.
+ */
+static void ckpt_state_fcfs(ckpt_t* ck, process_t** procs, ckpt_proc_t** where,
+                            ready_t*** guesses, int* n_slots, queue_t* Q_event,
+                            queue_t* Q_ready, open_sys_t* os, conv_t* cv,
+                            algo_stat_t* stats, algo_stat_t* counts,
+                            sim_time_t* t, sim_time_t* t_begin,
+                            enum cpu_mode* cpu_mode) {
+	ckpt_common(ck, t, os, procs, where);
+	if (ck->error) return;
+	if (os->slots > *n_slots) {
+		*guesses = (ready_t**) open_sys_grow_state(os, (void**) *guesses,
+		                                           *n_slots, sizeof(ready_t));
+		*n_slots = os->slots;
+	}
+	if (ck->restoring && !ck->same) return;
+	ckpt_data(ck, t_begin, sizeof(*t_begin));
+	ckpt_data(ck, cpu_mode, sizeof(*cpu_mode));
+	ckpt_data(ck, stats, sizeof(*stats));
+	ckpt_data(ck, counts, sizeof(*counts));
+	for (int i = 0; i < *n_slots; ++i)
+		ckpt_data(ck, (*guesses)[i], sizeof(ready_t));
+	ckpt_items(ck, Q_event, sizeof(event_t));
+	ckpt_refs(ck, Q_ready, (void**) *guesses, *n_slots);
+	ckpt_conv(ck, cv);
+}
+
+/**
+ * Where each process of an FCFS run stands at time t, for ckpt_common().
+ */
+static ckpt_proc_t* where_fcfs(process_t* procs, ready_t** guesses,
+                               int n_slots, queue_t* Q_event, queue_t* Q_ready,
+                               sim_time_t t) {
+	ckpt_proc_t* where = calloc(n_slots, sizeof(ckpt_proc_t));
+	queue_t* q = make_queue();
+	queue_copy(q, Q_event);
+	for (event_t* e = queue_pop(q); e; e = queue_pop(q)) {
+		if (e->type == EV_PROC_CS_OUT) continue;
+		ckpt_proc_t* w = &where[e->id - 'A'];
+		switch (e->type) {
+		case EV_PROC_ARRIVAL:
+			*w = (ckpt_proc_t){.where = CKPT_ARRIVING, .t = e->time};
+			break;
+		case EV_PROC_IO_STOP:
+			*w = (ckpt_proc_t){
+			    .where = CKPT_IO, .burst = e->burst, .t = e->time};
+			break;
+		case EV_PROC_CPU_START:
+		case EV_PROC_CPU_STOP:
+			*w = (ckpt_proc_t){
+			    .where = CKPT_READY,
+			    .burst = e->burst,
+			    .left = e->type == EV_PROC_CPU_STOP
+			                ? (int) (e->time - t)
+			                : procs[e->id - 'A'].cpu_bursts[e->burst],
+			    .t = guesses[e->id - 'A']->t_join};
+			break;
+		default:
+			break;
+		}
+	}
+	queue_copy(q, Q_ready);
+	for (ready_t* r = queue_pop(q); r; r = queue_pop(q)) {
+		where[r->id - 'A'] =
+		    (ckpt_proc_t){.where = CKPT_READY,
+		                  .burst = r->burst,
+		                  .left = procs[r->id - 'A'].cpu_bursts[r->burst],
+		                  .t = r->t_join};
+	}
+	free_queue(&q);
+	return where;
+}
+
+/**
+ * Continue at time t the run of another engine, whose processes stand as in
+ * where, starting with a free CPU.
+ */
+static void adopt_fcfs(process_t* procs, const ckpt_proc_t* where,
+                       ready_t** guesses, int n_slots, queue_t* Q_event,
+                       queue_t* Q_ready, sim_time_t t) {
+	// In place of the arrivals of a fresh run.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+	for (int i = 0; i < n_slots; ++i) {
+		const ckpt_proc_t* w = &where[i];
+		if (w->where == CKPT_GONE) continue;
+		*guesses[i] = (ready_t){.id = procs[i].id, .burst = w->burst};
+		if (w->where == CKPT_READY) {
+			procs[i].cpu_bursts[w->burst] = w->left;
+			guesses[i]->arrival = w->t;
+			guesses[i]->t_join = w->t;
+			queue_push(Q_ready, guesses[i]);
+			continue;
+		}
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = w->t,
+		               .id = procs[i].id,
+		               .type = w->where == CKPT_IO ? EV_PROC_IO_STOP
+		                                           : EV_PROC_ARRIVAL,
+		               .burst = w->burst};
+		queue_push(Q_event, e);
+	}
+	event_t* e_out = malloc(sizeof(event_t));
+	*e_out = (event_t){.time = t, .type = EV_PROC_CS_OUT};
+	queue_push(Q_event, e_out);
+}
+
 algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 	algo_stat_t fcfs_stats = {0}, fcfs_counts = {0};
 
@@ -88,8 +191,17 @@ algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 	queue_set_cmp(Q_event, Q_event_cmp_fcfs);
 	queue_set_cmp(Q_ready, Q_ready_cmp_fcfs);
 
-	ready_t* guesses = calloc(args->n, sizeof(ready_t));
-	for (int i = 0; i < args->n; ++i) {
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
 		event_t* e = malloc(sizeof(event_t));
 		*e = (event_t){.time = procs[i].arrival_time,
 		               .id = procs[i].id,
@@ -97,42 +209,118 @@ algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 		               .burst = 0};
 		queue_push(Q_event, e);
 
-		guesses[i].id = procs[i].id;
-		guesses[i].burst = 0;
+		guesses[i]->id = procs[i].id;
+		guesses[i]->burst = 0;
 	}
 
-	unsigned int t = 0;
-	print_event(t, 1, "Simulator started for FCFS", Q_ready);
+	sim_time_t t = 0;
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for FCFS", Q_ready);
 
-	enum cpu_mode { CM_IDLE = 0, CM_CS, CM_BURST } cpu_mode = CM_IDLE;
+	enum cpu_mode cpu_mode = CM_IDLE;
 
+	sim_time_t t_begin = 0;
+	// Checkpoint first at the end of the warm-up, which later runs can
+	// continue from, then every args->checkpoint_every ms.
+	sim_time_t t_ckpt = args->warmup ? args->warmup : args->checkpoint_every;
 	int fcfs_error = 0;
-	while (fcfs_error == 0 && queue_peek(Q_event)) {
+	if (args->restore) {
+		ckpt_t ck;
+		ckpt_proc_t* where = NULL;
+		if (ckpt_restore(&ck, args->restore, "FCFS", args) != 0) {
+			fcfs_error = 1;
+		} else {
+			ckpt_state_fcfs(&ck, &procs, &where, &guesses, &n_slots, Q_event,
+			                Q_ready, &os, &cv, &fcfs_stats, &fcfs_counts, &t,
+			                &t_begin, &cpu_mode);
+			fcfs_error = ckpt_close(&ck) != 0;
+		}
+		if (fcfs_error == 0 && !ck.same) {
+			// Another policy's run is measured from here on.
+			adopt_fcfs(procs, where, guesses, n_slots, Q_event, Q_ready, t);
+			t_begin = t;
+		}
+		free(where);
+		if (fcfs_error == 0)
+			printf_event(t, 1, OBS_OTHER, 0, 0,
+			             "Simulator restored for FCFS from %s",
+			             Q_ready, args->restore);
+		t_ckpt = args->checkpoint_every ? (t / args->checkpoint_every + 1) *
+		                                      args->checkpoint_every
+		                                : SIM_TIME_MAX;
+	}
+	while (fcfs_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		sim_time_t t_next = ((event_t*) queue_peek(Q_event))->time;
+		if (args->checkpoint && t_next >= t_ckpt && ckpt_wanted(args, "FCFS")) {
+			ckpt_t ck;
+			if (ckpt_save(&ck, args->checkpoint, "FCFS", args) == 0) {
+				ckpt_proc_t* where =
+				    where_fcfs(procs, guesses, n_slots, Q_event, Q_ready, t);
+				ckpt_state_fcfs(&ck, &procs, &where, &guesses, &n_slots,
+				                Q_event, Q_ready, &os, &cv, &fcfs_stats,
+				                &fcfs_counts, &t, &t_begin, &cpu_mode);
+				free(where);
+				ckpt_close(&ck);
+			}
+			t_ckpt = args->checkpoint_every
+			             ? (t_next / args->checkpoint_every + 1) *
+			                   args->checkpoint_every
+			             : SIM_TIME_MAX;
+		}
+
 		event_t* e = queue_pop(Q_event);
 
 		t = e->time;
+		stat_warmup(&fcfs_stats, &fcfs_counts, args->warmup, t, &t_begin);
 
 		switch (e->type) {
 		case EV_PROC_CPU_STOP: {
 			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
 			if (bursts_left == 0) {
-				printf_event(t, 1, "Process %c terminated", Q_ready, e->id);
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
 				free(e);
 			} else {
-				printf_event(t, 0,
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
 				             "Process %c completed a CPU burst; %d "
 				             "burst%s to go",
 				             Q_ready, e->id, bursts_left, bursts_left == 1 ? "" : "s");
 
-				// Requeue IO burst completion.
-				e->time = t + args->Tcs / 2 + procs[e->id - 'A'].io_bursts[e->burst];
+				// Requeue IO burst completion once its device takes it.
 				e->type = EV_PROC_IO_STOP;
-				queue_push(Q_event, e);
-
-				printf_event(t, 0,
-				             "Process %c switching out of CPU; blocking on I/O"
-				             " until time %ums",
-				             Q_ready, e->id, e->time);
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
 			}
 
 			// Simulate context switch.
@@ -150,7 +338,7 @@ algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 		}
 		case EV_PROC_CPU_START: {
 			unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
-			printf_event(t, 0,
+			printf_event(t, 0, OBS_START, e->id, burst_len,
 			             "Process %c started using the CPU "
 			             "for %ums burst",
 			             Q_ready, e->id, burst_len);
@@ -166,18 +354,29 @@ algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 			// Update statistics.
 			stat_avg_add(&fcfs_stats.t_burst, &fcfs_counts.t_burst, burst_len,
 			             procs[e->id - 'A'].cpu_bound);
-			stat_avg_add(&fcfs_stats.t_turn, &fcfs_counts.t_turn,
-			             t - guesses[e->id - 'A'].t_join + burst_len + args->Tcs / 2,
+			double t_turn =
+			    t - guesses[e->id - 'A']->t_join + burst_len + args->Tcs / 2;
+			stat_avg_add(&fcfs_stats.t_turn, &fcfs_counts.t_turn, t_turn,
 			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
 			break;
 		}
 		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
 			// Add to ready queue.
-			guesses[e->id - 'A'].arrival = t;
-			guesses[e->id - 'A'].burst = e->burst + 1;
-			guesses[e->id - 'A'].t_join = t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0,
+			guesses[e->id - 'A']->arrival = t;
+			guesses[e->id - 'A']->burst = e->burst + 1;
+			guesses[e->id - 'A']->t_join = t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
 			             "Process %c completed I/O; "
 			             "added to ready queue",
 			             Q_ready, e->id);
@@ -186,12 +385,13 @@ algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 		}
 		case EV_PROC_ARRIVAL: {
 			// Add to ready queue.
-			guesses[e->id - 'A'].arrival = t;
-			guesses[e->id - 'A'].burst = 0;
-			guesses[e->id - 'A'].t_join = t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0, "Process %c arrived; added to ready queue", Q_ready,
-			             e->id);
+			guesses[e->id - 'A']->arrival = t;
+			guesses[e->id - 'A']->burst = 0;
+			guesses[e->id - 'A']->t_join = t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c arrived; added to ready queue",
+			             Q_ready, e->id);
 			free(e);
 			break;
 		}
@@ -215,19 +415,30 @@ algo_stat_t algo_fcfs(const args_t* args, process_t* procs) {
 
 				stat_avg_add(&fcfs_stats.t_wait, &fcfs_counts.t_wait, t - r->t_join,
 				             procs[r->id - 'A'].cpu_bound);
+				conv_add(&cv, CONV_WAIT, t - r->t_join, CONV_NEW);
 
 				stat_cs_inc(&fcfs_stats, procs[r->id - 'A'].cpu_bound);
 			}
 		}
 	}
 
-	print_event(t, 1, "Simulator ended for FCFS", Q_ready);
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for FCFS", Q_ready);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
 
 	free_queue(&Q_ready);
 	free_queue(&Q_event);
-	free(guesses);
+	open_sys_free_state((void**) guesses, n_slots);
 
-	stat_calc_final(&fcfs_stats, &fcfs_counts, t);
+	stat_calc_final(&fcfs_stats, &fcfs_counts, t - t_begin);
+	fcfs_stats.arrived = os.arrived;
+	fcfs_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &fcfs_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &fcfs_stats.conv);
 
+	fcfs_stats.error = fcfs_error;
 	return fcfs_stats;
 }
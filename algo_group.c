@@ -0,0 +1,571 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "hist.h"
+#include "open_sys.h"
+#include "queue.h"
+
+/*
+Hierarchical group scheduling with CPU bandwidth control, after Linux cgroups
+(cpu.weight and cpu.max). Each process belongs to a group from the workload.
+
+- Groups share the CPU fairly by weight (args->group_shares): each group has
+  a virtual runtime, its CPU time scaled by 1024 / shares, and the runnable
+  group with the smallest one goes next.
+- Within the group, processes share its time fairly by nice level the same
+  way, and the one with the smallest vruntime runs for up to args->Tslice.
+- At the end of the slice the choice is made again; the running process
+  keeps the CPU if it would be picked.
+- A group with a quota (args->group_quota) may use that much CPU time per
+  args->group_period. Once it runs out, the group is throttled: its running
+  process is switched out and none of its processes run until the budget is
+  refilled at the start of the next period.
+- A group or process that becomes runnable again starts no lower than the
+  last one dispatched, so sleeping earns no credit.
+
+A refill is handled before any other event at the same time.
+*/
+
+enum event_type {
+	EV_GROUP_REFILL = 0,
+	EV_PROC_CPU_STOP,
+	EV_PROC_CPU_PREEMPTION,
+	EV_PROC_CPU_START,
+	EV_PROC_CPU_CS,
+	EV_PROC_IO_STOP,
+	EV_PROC_ARRIVAL,
+};
+
+typedef struct {
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
+	enum event_type type; // Event type.
+	int burst;            // Current burst ID associated with event.
+} event_t;
+
+int Q_event_cmp_group(const void* lhs, const void* rhs) {
+	const event_t *lhe = lhs, *rhe = rhs;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
+	int d_type = (int) lhe->type - (int) rhe->type;
+	int d_id = lhe->id - rhe->id;
+	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
+}
+
+typedef struct {
+	int id;           // Ready queue process id.
+	int group;        // Group index.
+	int weight;       // Load weight from the nice level.
+	double vruntime;  // Virtual runtime within the group.
+	int burst;        // Current burst ID.
+	int remaining;    // CPU time left in the current burst.
+	int started;      // Whether the current burst has used the CPU yet.
+	sim_time_t t_join;  // When the current burst became ready. (turnaround)
+	sim_time_t p_join;  // When this process joined the ready queue. (wait)
+	long wait_obs;      // Its observation of the wait (conv_add()).
+} ready_t;
+
+typedef struct {
+	queue_t* ready;      // Ready processes, by vruntime.
+	int shares;          // Weight among groups.
+	double vruntime;     // Group virtual runtime.
+	double min_vruntime; // Floor for processes becoming runnable.
+	int nr_run;          // Runnable processes, ready or running.
+	long quota;          // CPU time per period; 0 = unlimited.
+	long runtime;        // Quota left in this period.
+	int throttled;       // Whether it is waiting for a refill.
+	sim_time_t t_throttle; // When it was throttled.
+	double received;     // CPU time used.
+	hist_t lat;          // CPU burst turnaround times.
+} group_t;
+
+#define GROUP_NICE_0_WEIGHT 1024
+
+// Load weight of nice levels -20 to 19, as in Linux.
+static const int group_weights[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,    36,    29,    23,    18,    15,
+};
+
+int Q_ready_cmp_group(const void* lhs, const void* rhs) {
+	const ready_t *lhg = lhs, *rhg = rhs;
+	if (lhg->vruntime != rhg->vruntime)
+		return lhg->vruntime < rhg->vruntime ? -1 : 1;
+	return lhg->id - rhg->id;
+}
+
+void print_ready_queue_group(FILE* out, const void* Q, int n_grp) {
+	const group_t* grp = Q;
+	fprintf(out, "[Q");
+	int empty = 1;
+	for (int k = 0; k < n_grp; ++k) {
+		queue_t* q2 = make_queue();
+		queue_copy(q2, grp[k].ready);
+		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
+			fprintf(out, " %c", g->id);
+			empty = 0;
+		}
+		free_queue(&q2);
+	}
+	if (empty) fprintf(out, " <empty>");
+	fprintf(out, "]");
+}
+
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_group, Q, n_grp, str); \
+	} while (0)
+
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_group, Q, n_grp, fmt, __VA_ARGS__); \
+	} while (0)
+
+/**
+ * @return The process that would run next: the head of the unthrottled group
+ * with ready processes and the smallest vruntime. NULL if there is none.
+ */
+ready_t* pick_group(const group_t* grp, int n_grp) {
+	int best = -1;
+	for (int k = 0; k < n_grp; ++k) {
+		if (grp[k].throttled || queue_peek(grp[k].ready) == NULL) continue;
+		if (best < 0 || grp[k].vruntime < grp[best].vruntime) best = k;
+	}
+	return best < 0 ? NULL : queue_peek(grp[best].ready);
+}
+
+/**
+ * @return Whether running process g would be picked over ready process r.
+ */
+int keeps_cpu_group(const group_t* grp, const ready_t* g, const ready_t* r) {
+	if (grp[g->group].throttled) return 0;
+	if (r == NULL) return 1;
+	if (r->group != g->group) return grp[g->group].vruntime <= grp[r->group].vruntime;
+	return g->vruntime <= r->vruntime;
+}
+
+/**
+ * Charge g and its group for the CPU time since run_start.
+ */
+void account_group(group_t* grp, ready_t* g, sim_time_t t, sim_time_t run_start) {
+	unsigned ran = t - run_start;
+	group_t* k = &grp[g->group];
+	g->remaining -= ran;
+	g->vruntime += (double) ran * GROUP_NICE_0_WEIGHT / g->weight;
+	k->vruntime += (double) ran * GROUP_NICE_0_WEIGHT / k->shares;
+	k->received += ran;
+	if (k->quota) k->runtime -= ran;
+}
+
+/**
+ * Set e to the end of the running process's slice, its burst or its group's
+ * budget, whichever is soonest.
+ */
+void schedule_run_group(event_t* e, const group_t* grp, const ready_t* g,
+                        const args_t* args, sim_time_t t) {
+	unsigned long slice = args->Tslice;
+	const group_t* k = &grp[g->group];
+	if (k->quota && (unsigned long) k->runtime < slice) slice = k->runtime;
+	if ((unsigned) g->remaining <= slice) {
+		e->time = t + g->remaining;
+		e->type = EV_PROC_CPU_STOP;
+	} else {
+		e->time = t + slice;
+		e->type = EV_PROC_CPU_PREEMPTION;
+	}
+}
+
+/**
+ * Make g runnable: add it to its group's ready queue, no lower than the
+ * group's floor, and wake the group no lower than g_min.
+ */
+void enqueue_group(group_t* grp, ready_t* g, double g_min, sim_time_t t) {
+	group_t* k = &grp[g->group];
+	if (k->nr_run++ == 0 && k->vruntime < g_min) k->vruntime = g_min;
+	if (g->vruntime < k->min_vruntime) g->vruntime = k->min_vruntime;
+	g->p_join = t;
+	queue_push(k->ready, g);
+}
+
+algo_stat_t algo_group(const args_t* args, process_t* procs) {
+	algo_stat_t group_stats = {0}, group_counts = {0};
+
+	queue_t* Q_event = make_queue();
+	queue_set_cmp(Q_event, Q_event_cmp_group);
+
+	int n_grp = args->groups ? args->groups : 2;
+	group_t* grp = calloc(n_grp, sizeof(group_t));
+	int bandwidth = 0;
+	for (int k = 0; k < n_grp; ++k) {
+		grp[k].ready = make_queue();
+		queue_set_cmp(grp[k].ready, Q_ready_cmp_group);
+		grp[k].shares = args->group_shares[k];
+		grp[k].quota = args->group_quota[k];
+		grp[k].runtime = grp[k].quota;
+		if (grp[k].quota) bandwidth = 1;
+	}
+
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = procs[i].arrival_time,
+		               .id = procs[i].id,
+		               .type = EV_PROC_ARRIVAL,
+		               .burst = 0};
+		queue_push(Q_event, e);
+
+		guesses[i]->id = procs[i].id;
+	}
+
+	if (bandwidth) {
+		event_t* e_refill = malloc(sizeof(event_t));
+		*e_refill = (event_t){.time = args->group_period, .id = '#', .type = EV_GROUP_REFILL};
+		queue_push(Q_event, e_refill);
+	}
+
+	sim_time_t t = 0;
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for GROUP", grp);
+
+	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+
+	// The pending stop or slice expiry of the running process.
+	event_t* e_run = NULL;
+	sim_time_t run_start = 0;
+
+	// Floor for groups becoming runnable.
+	double g_min = 0.0;
+
+	sim_time_t t_begin = 0, t_group = 0;
+	int group_error = 0;
+	while (group_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		event_t* e = queue_pop(Q_event);
+
+		// Nothing left to refill: no other events, and no throttled processes
+		// waiting for this one.
+		int waiting = 0;
+		for (int k = 0; k < n_grp; ++k) waiting += grp[k].nr_run;
+		if (e->type == EV_GROUP_REFILL && queue_peek(Q_event) == NULL &&
+		    !open_sys_pending(&os) && waiting == 0) {
+			free(e);
+			break;
+		}
+
+		t = e->time;
+		stat_warmup(&group_stats, &group_counts, args->warmup, t, &t_begin);
+
+		if (t_group != t_begin) {
+			// Warm-up over: measure the groups from here.
+			for (int k = 0; k < n_grp; ++k) {
+				grp[k].received = 0.0;
+				grp[k].lat = (hist_t){0};
+			}
+			t_group = t_begin;
+		}
+
+		switch (e->type) {
+		case EV_PROC_CPU_STOP: {
+			ready_t* g = guesses[e->id - 'A'];
+			group_t* k = &grp[g->group];
+			account_group(grp, g, t, run_start);
+			e_run = NULL;
+			--k->nr_run;
+
+			double t_turn = t - g->t_join + args->Tcs / 2;
+			stat_avg_add(&group_stats.t_turn, &group_counts.t_turn, t_turn,
+			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+			hist_add(&k->lat, t_turn);
+
+			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
+			if (bursts_left == 0) {
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             grp, e->id);
+				open_sys_retire(&os, e->id - 'A');
+				free(e);
+			} else {
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+				             "Process %c (group %d) completed a CPU burst; %d "
+				             "burst%s to go",
+				             grp, e->id, g->group, bursts_left,
+				             bursts_left == 1 ? "" : "s");
+
+				// Requeue IO burst completion once its device takes it.
+				e->type = EV_PROC_IO_STOP;
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             grp, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             grp, e->id, procs[e->id - 'A'].io_dev);
+				}
+			}
+
+			if (k->quota && k->runtime <= 0) {
+				k->throttled = 1;
+				k->t_throttle = t;
+				++group_stats.group.throttles[g->group];
+				printf_event(t, 0, OBS_OTHER, 0, 0,
+				             "Group %d used its quota; throttled",
+				             grp, g->group);
+			}
+
+			// Simulate context switch.
+			cpu_mode = CM_CS;
+			event_t* e_out = malloc(sizeof(event_t));
+			*e_out = (event_t){.id = '#', .time = t + args->Tcs / 2, .type = EV_PROC_CPU_CS};
+			queue_push(Q_event, e_out);
+
+			break;
+		}
+		case EV_PROC_CPU_PREEMPTION: {
+			// Slice or group budget expired.
+			ready_t* g = guesses[e->id - 'A'];
+			group_t* k = &grp[g->group];
+			account_group(grp, g, t, run_start);
+
+			if (k->quota && k->runtime <= 0) {
+				k->throttled = 1;
+				k->t_throttle = t;
+				++group_stats.group.throttles[g->group];
+				printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+				             "Group %d used its quota; throttling process %c with %dms remaining",
+				             grp, g->group, e->id, g->remaining);
+			}
+
+			if (keeps_cpu_group(grp, g, pick_group(grp, n_grp))) {
+				printf_event(t, 0, OBS_OTHER, e->id, 0,
+				             "Time slice expired; no preemption because process %c would run next",
+				             grp, e->id);
+				run_start = t;
+				schedule_run_group(e, grp, g, args, t);
+				queue_push(Q_event, e);
+			} else {
+				if (!k->throttled) {
+					printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+					             "Time slice expired; preempting process %c with %dms remaining",
+					             grp, e->id, g->remaining);
+				}
+				stat_pre_inc(&group_stats, procs[e->id - 'A'].cpu_bound);
+				e_run = NULL;
+				cpu_mode = CM_CS;
+				e->time = t + args->Tcs / 2;
+				e->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e);
+			}
+			break;
+		}
+		case EV_PROC_CPU_START: {
+			ready_t* g = guesses[e->id - 'A'];
+			int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+			if (g->remaining != burst_len) {
+				printf_event(t, 0, OBS_START, e->id, g->remaining,
+				             "Process %c (group %d) started using the CPU for "
+				             "remaining %dms of %dms burst",
+				             grp, e->id, g->group, g->remaining, burst_len);
+			} else {
+				printf_event(t, 0, OBS_START, e->id, burst_len,
+				             "Process %c (group %d) started using the CPU for %dms "
+				             "burst",
+				             grp, e->id, g->group, burst_len);
+			}
+
+			cpu_mode = CM_BURST;
+			run_start = t;
+			schedule_run_group(e, grp, g, args, t);
+			queue_push(Q_event, e);
+			e_run = e;
+
+			stat_cs_inc(&group_stats, procs[e->id - 'A'].cpu_bound);
+			break;
+		}
+		case EV_PROC_CPU_CS: {
+			// Switch out done; a preempted process rejoins its group's queue.
+			if (e->id != '#') {
+				ready_t* g = guesses[e->id - 'A'];
+				g->p_join = t;
+				queue_push(grp[g->group].ready, g);
+			}
+
+			cpu_mode = CM_IDLE;
+			free(e);
+			break;
+		}
+		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			ready_t* g = guesses[e->id - 'A'];
+			g->burst = e->burst + 1;
+			g->remaining = procs[e->id - 'A'].cpu_bursts[g->burst];
+			g->started = 0;
+			g->t_join = t;
+			stat_avg_add(&group_stats.t_burst, &group_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			enqueue_group(grp, g, g_min, t);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
+			             "Process %c (group %d) completed I/O; added to ready queue",
+			             grp, e->id, g->group);
+			free(e);
+			break;
+		}
+		case EV_PROC_ARRIVAL: {
+			ready_t* g = guesses[e->id - 'A'];
+			int group = procs[e->id - 'A'].group;
+			if (group >= n_grp) group = n_grp - 1;
+			*g = (ready_t){.id = e->id,
+			               .group = group,
+			               .weight = group_weights[procs[e->id - 'A'].nice + 20],
+			               .remaining = procs[e->id - 'A'].cpu_bursts[0],
+			               .t_join = t};
+			stat_avg_add(&group_stats.t_burst, &group_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			enqueue_group(grp, g, g_min, t);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (group %d) arrived; added to ready queue",
+			             grp, e->id, g->group);
+			free(e);
+			break;
+		}
+		case EV_GROUP_REFILL: {
+			// Charge the running process so far; its group's budget restarts.
+			if (e_run) account_group(grp, guesses[e_run->id - 'A'], t, run_start);
+
+			for (int k = 0; k < n_grp; ++k) {
+				if (grp[k].throttled) {
+					sim_time_t from = grp[k].t_throttle > t_begin ? grp[k].t_throttle : t_begin;
+					group_stats.group.throttled[k] += t - from;
+					grp[k].throttled = 0;
+					printf_event(t, 0, OBS_OTHER, 0, 0,
+					             "Group %d quota refilled; unthrottled",
+					             grp, k);
+				}
+				grp[k].runtime = grp[k].quota;
+			}
+
+			if (e_run) {
+				queue_delete(Q_event, queue_search(Q_event, e_run));
+				run_start = t;
+				schedule_run_group(e_run, grp, guesses[e_run->id - 'A'], args, t);
+				queue_push(Q_event, e_run);
+			}
+
+			e->time = t + args->group_period;
+			queue_push(Q_event, e);
+			break;
+		}
+		default:
+			fprintf(stderr, "ERROR: invalid event type %d.\n", e->type);
+			group_error = 1;
+			free(e);
+			break;
+		}
+
+		if (cpu_mode == CM_IDLE) {
+			// Context switch in the next process of the group furthest behind.
+			ready_t* r = pick_group(grp, n_grp);
+			if (r) {
+				group_t* k = &grp[r->group];
+				queue_pop(k->ready);
+				if (k->vruntime > g_min) g_min = k->vruntime;
+				if (r->vruntime > k->min_vruntime) k->min_vruntime = r->vruntime;
+
+				event_t* e_start = malloc(sizeof(event_t));
+				*e_start = (event_t){.time = t + args->Tcs / 2,
+				                     .id = r->id,
+				                     .type = EV_PROC_CPU_START,
+				                     .burst = r->burst};
+				queue_push(Q_event, e_start);
+				cpu_mode = CM_CS;
+
+				// A preempted burst's later waits add to its first.
+				stat_avg_add(&group_stats.t_wait, r->started ? NULL : &group_counts.t_wait,
+				             t - r->p_join, procs[r->id - 'A'].cpu_bound);
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->started ? r->wait_obs : CONV_NEW);
+				r->started = 1;
+			}
+		}
+	}
+
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for GROUP", grp);
+
+	// Events left behind by an early stop, and the final refill.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+
+	stat_calc_final(&group_stats, &group_counts, t - t_begin);
+	group_stat_t* s = &group_stats.group;
+	s->n = n_grp;
+	for (int k = 0; k < n_grp; ++k) {
+		if (grp[k].throttled) {
+			sim_time_t from = grp[k].t_throttle > t_begin ? grp[k].t_throttle : t_begin;
+			s->throttled[k] += t - from;
+		}
+		s->util[k] = t > t_begin ? grp[k].received * 100.0 / (t - t_begin) : 0.0;
+		s->lat_p50[k] = hist_percentile(&grp[k].lat, 50);
+		s->lat_p95[k] = hist_percentile(&grp[k].lat, 95);
+		s->lat_p99[k] = hist_percentile(&grp[k].lat, 99);
+		free_queue(&grp[k].ready);
+	}
+	free(grp);
+	free_queue(&Q_event);
+	open_sys_free_state((void**) guesses, n_slots);
+
+	group_stats.arrived = os.arrived;
+	group_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &group_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &group_stats.conv);
+
+	group_stats.error = group_error;
+	return group_stats;
+}
@@ -0,0 +1,472 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "exp_rand.h"
+#include "fenwick.h"
+#include "open_sys.h"
+#include "queue.h"
+
+/*
+Lottery scheduling. Each ready process holds tickets from the workload and
+the next process to run is drawn at random with probability proportional to
+its tickets. Winners run for a quantum of args->Tslice.
+
+- The ready processes' tickets are kept in a Fenwick tree indexed by process,
+  so a draw costs O(log n) however many processes there are.
+- When its quantum expires, the running process enters the lottery again
+  with the ready processes and keeps the CPU if it wins.
+- A process that blocks after using only a fraction f of its quantum gets
+  compensation tickets, 1/f times its tickets, until it next wins, so
+  I/O-bound processes are not shortchanged.
+
+Draws come from their own stream, seeded from args->seed, so the workload is
+unchanged.
+
+Shares are measured against the ticket-weighted fair share: while runnable,
+each process is entitled to its tickets' fraction of the time.
+
+Ties between events are broken in the same order as RR.
+*/
+
+enum event_type {
+	EV_PROC_CPU_STOP = 0,
+	EV_PROC_CPU_PREEMPTION,
+	EV_PROC_CPU_START,
+	EV_PROC_CPU_CS,
+	EV_PROC_IO_STOP,
+	EV_PROC_ARRIVAL,
+};
+
+typedef struct {
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
+	enum event_type type; // Event type.
+	int burst;            // Current burst ID associated with event.
+} event_t;
+
+int Q_event_cmp_lottery(const void* lhs, const void* rhs) {
+	const event_t *lhe = lhs, *rhe = rhs;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
+	int d_type = (int) lhe->type - (int) rhe->type;
+	int d_id = lhe->id - rhe->id;
+	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
+}
+
+typedef struct {
+	int id;          // Process id.
+	int tickets;     // Tickets from the workload.
+	long held;       // Tickets held in the lottery, with compensation.
+	int burst;       // Current burst ID.
+	int remaining;   // CPU time left in the current burst.
+	int started;     // Whether the current burst has used the CPU yet.
+	sim_time_t t_join; // When the current burst became ready. (turnaround)
+	sim_time_t p_join; // When this process joined the ready set. (wait)
+	long wait_obs;     // Its observation of the wait (conv_add()).
+	int runnable;    // Whether it is ready or running rather than blocked.
+	double v_join;   // Fair-share clock when it last became runnable.
+	sim_time_t r_join; // When it last became runnable.
+} ready_t;
+
+void print_ready_queue_lottery(FILE* out, const void* Q, int n) {
+	const fenwick_t* f = Q;
+	fprintf(out, "[Q");
+	if (fenwick_total(f) == 0) {
+		fprintf(out, " <empty>");
+	} else {
+		for (int i = 0; i < fenwick_size(f); ++i) {
+			if (fenwick_get(f, i) > 0) fprintf(out, " %c", 'A' + i);
+		}
+	}
+	fprintf(out, "]");
+}
+
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_lottery, Q, 0, str); \
+	} while (0)
+
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_lottery, Q, 0, fmt, __VA_ARGS__); \
+	} while (0)
+
+/**
+ * Add g to the ready set, holding its tickets (plus any compensation).
+ */
+void join_lottery(fenwick_t* f, ready_t* g, sim_time_t t) {
+	g->p_join = t;
+	fenwick_add(f, g->id - 'A', g->held);
+}
+
+/**
+ * Draw a winner from the ready set and remove it.
+ * @return Its index, or -1 if the ready set is empty.
+ */
+int draw_lottery(fenwick_t* f, exp_rng_t* rng) {
+	long total = fenwick_total(f);
+	if (total == 0) return -1;
+	int i = fenwick_find(f, (long) (next_unif_r(rng) * total));
+	if (i < 0) i = fenwick_find(f, total - 1); // u rounded up to 1
+	fenwick_add(f, i, -fenwick_get(f, i));
+	return i;
+}
+
+/**
+ * Set e to the end of the running process's quantum or burst, whichever is
+ * sooner.
+ */
+void schedule_run_lottery(event_t* e, const ready_t* g, const args_t* args,
+                          sim_time_t t) {
+	if ((unsigned) g->remaining <= args->Tslice) {
+		e->time = t + g->remaining;
+		e->type = EV_PROC_CPU_STOP;
+	} else {
+		e->time = t + args->Tslice;
+		e->type = EV_PROC_CPU_PREEMPTION;
+	}
+}
+
+algo_stat_t algo_lottery(const args_t* args, process_t* procs) {
+	algo_stat_t lottery_stats = {0}, lottery_counts = {0};
+
+	queue_t* Q_event = make_queue();
+	queue_set_cmp(Q_event, Q_event_cmp_lottery);
+	fenwick_t* Q_ready = make_fenwick(args->n);
+
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	// A stream apart from the workload's.
+	exp_rng_t rng;
+	seed_exp_r(&rng, ~args->seed);
+	rng.antithetic = args->antithetic;
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = procs[i].arrival_time,
+		               .id = procs[i].id,
+		               .type = EV_PROC_ARRIVAL,
+		               .burst = 0};
+		queue_push(Q_event, e);
+
+		guesses[i]->id = procs[i].id;
+	}
+
+	// CPU time received and entitled, and time runnable, per process (open
+	// system: per slot).
+	double* received = calloc(n_slots, sizeof(double));
+	double* entitled = calloc(n_slots, sizeof(double));
+	double* runnable = calloc(n_slots, sizeof(double));
+
+	sim_time_t t = 0;
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for LOTTERY",
+	            Q_ready);
+
+	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+
+	sim_time_t run_start = 0;
+	int winner = -1; // Drawn when a quantum expired, waiting for the CPU.
+	long w_run = 0; // Tickets of runnable processes.
+
+	// Fair-share clock: advances by dt / w_run, so a process with w tickets
+	// is entitled to w * (v_fair - v_join) ms of CPU.
+	double v_fair = 0.0;
+	sim_time_t t_prev = 0;
+
+	sim_time_t t_begin = 0, t_fair = 0;
+	int lottery_error = 0;
+	while (lottery_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				received = open_sys_grow(&os, received, n_slots, sizeof(double));
+				entitled = open_sys_grow(&os, entitled, n_slots, sizeof(double));
+				runnable = open_sys_grow(&os, runnable, n_slots, sizeof(double));
+				fenwick_grow(Q_ready, os.slots);
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		event_t* e = queue_pop(Q_event);
+
+		t = e->time;
+		stat_warmup(&lottery_stats, &lottery_counts, args->warmup, t, &t_begin);
+
+		if (w_run > 0) v_fair += (double) (t - t_prev) / w_run;
+		t_prev = t;
+		if (t_fair != t_begin) {
+			// Warm-up over: measure shares from here.
+			for (int i = 0; i < n_slots; ++i) {
+				received[i] = entitled[i] = runnable[i] = 0.0;
+				guesses[i]->v_join = v_fair;
+				guesses[i]->r_join = t;
+			}
+			t_fair = t_begin;
+		}
+
+		switch (e->type) {
+		case EV_PROC_CPU_STOP: {
+			ready_t* g = guesses[e->id - 'A'];
+			unsigned ran = t - run_start;
+			received[e->id - 'A'] += ran;
+
+			// Blocks until the next burst is ready.
+			g->runnable = 0;
+			entitled[e->id - 'A'] += g->tickets * (v_fair - g->v_join);
+			runnable[e->id - 'A'] += t - g->r_join;
+			w_run -= g->tickets;
+
+			// Compensate for the unused part of the quantum.
+			g->held = g->tickets;
+			if (ran > 0 && ran < args->Tslice)
+				g->held = ceil((double) g->tickets * args->Tslice / ran);
+
+			double t_turn = t - g->t_join + args->Tcs / 2;
+			stat_avg_add(&lottery_stats.t_turn, &lottery_counts.t_turn, t_turn,
+			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+
+			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
+			if (bursts_left == 0) {
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
+				free(e);
+			} else {
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+				             "Process %c completed a CPU burst; %d burst%s to go",
+				             Q_ready, e->id, bursts_left,
+				             bursts_left == 1 ? "" : "s");
+
+				// Requeue IO burst completion once its device takes it.
+				e->type = EV_PROC_IO_STOP;
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
+			}
+
+			// Simulate context switch.
+			cpu_mode = CM_CS;
+			event_t* e_out = malloc(sizeof(event_t));
+			*e_out = (event_t){.id = '#', .time = t + args->Tcs / 2, .type = EV_PROC_CPU_CS};
+			queue_push(Q_event, e_out);
+
+			break;
+		}
+		case EV_PROC_CPU_PREEMPTION: {
+			// Quantum expired: hold a lottery including the running process.
+			ready_t* g = guesses[e->id - 'A'];
+			g->remaining -= t - run_start;
+			received[e->id - 'A'] += t - run_start;
+
+			long others = fenwick_total(Q_ready);
+			long r = next_unif_r(&rng) * (others + g->tickets);
+			if (r >= others) {
+				printf_event(t, 0, OBS_OTHER, e->id, 0,
+				             "Time slice expired; no preemption because process %c won the lottery",
+				             Q_ready, e->id);
+				run_start = t;
+				schedule_run_lottery(e, g, args, t);
+				queue_push(Q_event, e);
+			} else {
+				// The winner is dispatched once the switch out is done.
+				winner = fenwick_find(Q_ready, r);
+				fenwick_add(Q_ready, winner, -fenwick_get(Q_ready, winner));
+				printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+				             "Time slice expired; preempting process %c with %dms remaining",
+				             Q_ready, e->id, g->remaining);
+				stat_pre_inc(&lottery_stats, procs[e->id - 'A'].cpu_bound);
+				cpu_mode = CM_CS;
+				e->time = t + args->Tcs / 2;
+				e->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e);
+			}
+			break;
+		}
+		case EV_PROC_CPU_START: {
+			ready_t* g = guesses[e->id - 'A'];
+			int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+			if (g->remaining != burst_len) {
+				printf_event(t, 0, OBS_START, e->id, g->remaining,
+				             "Process %c started using the CPU for remaining %dms of "
+				             "%dms burst",
+				             Q_ready, e->id, g->remaining, burst_len);
+			} else {
+				printf_event(t, 0, OBS_START, e->id, burst_len,
+				             "Process %c started using the CPU for %dms burst",
+				             Q_ready, e->id, burst_len);
+			}
+
+			cpu_mode = CM_BURST;
+			run_start = t;
+			schedule_run_lottery(e, g, args, t);
+			queue_push(Q_event, e);
+
+			stat_cs_inc(&lottery_stats, procs[e->id - 'A'].cpu_bound);
+			break;
+		}
+		case EV_PROC_CPU_CS: {
+			// Switch out done; a preempted process rejoins the lottery.
+			if (e->id != '#') join_lottery(Q_ready, guesses[e->id - 'A'], t);
+
+			cpu_mode = CM_IDLE;
+			free(e);
+			break;
+		}
+		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			ready_t* g = guesses[e->id - 'A'];
+			g->burst = e->burst + 1;
+			g->remaining = procs[e->id - 'A'].cpu_bursts[g->burst];
+			g->started = 0;
+			g->t_join = t;
+			stat_avg_add(&lottery_stats.t_burst, &lottery_counts.t_burst,
+			             g->remaining, procs[e->id - 'A'].cpu_bound);
+
+			g->runnable = 1;
+			g->v_join = v_fair;
+			g->r_join = t;
+			w_run += g->tickets;
+
+			join_lottery(Q_ready, g, t);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
+			             "Process %c (%ld tickets) completed I/O; added to ready "
+			             "queue",
+			             Q_ready, e->id, g->held);
+			free(e);
+			break;
+		}
+		case EV_PROC_ARRIVAL: {
+			ready_t* g = guesses[e->id - 'A'];
+			*g = (ready_t){.id = e->id,
+			               .tickets = procs[e->id - 'A'].tickets,
+			               .held = procs[e->id - 'A'].tickets,
+			               .remaining = procs[e->id - 'A'].cpu_bursts[0],
+			               .t_join = t,
+			               .runnable = 1,
+			               .v_join = v_fair,
+			               .r_join = t};
+			w_run += g->tickets;
+			stat_avg_add(&lottery_stats.t_burst, &lottery_counts.t_burst,
+			             g->remaining, procs[e->id - 'A'].cpu_bound);
+
+			join_lottery(Q_ready, g, t);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (%d tickets) arrived; added to ready queue",
+			             Q_ready, e->id, g->tickets);
+			free(e);
+			break;
+		}
+		default:
+			fprintf(stderr, "ERROR: invalid event type %d.\n", e->type);
+			lottery_error = 1;
+			free(e);
+			break;
+		}
+
+		if (cpu_mode == CM_IDLE) {
+			// Context switch in the lottery winner.
+			int i = winner >= 0 ? winner : draw_lottery(Q_ready, &rng);
+			winner = -1;
+			if (i >= 0) {
+				ready_t* r = guesses[i];
+				r->held = r->tickets;
+				event_t* e_start = malloc(sizeof(event_t));
+				*e_start = (event_t){.time = t + args->Tcs / 2,
+				                     .id = r->id,
+				                     .type = EV_PROC_CPU_START,
+				                     .burst = r->burst};
+				queue_push(Q_event, e_start);
+				cpu_mode = CM_CS;
+
+				// A preempted burst's later waits add to its first.
+				stat_avg_add(&lottery_stats.t_wait,
+				             r->started ? NULL : &lottery_counts.t_wait,
+				             t - r->p_join, procs[r->id - 'A'].cpu_bound);
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->started ? r->wait_obs : CONV_NEW);
+				r->started = 1;
+			}
+		}
+	}
+
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for LOTTERY", Q_ready);
+
+	// Processes cut off by an early stop or the end of an open-system run.
+	char* ids = malloc(n_slots);
+	for (int i = 0; i < n_slots; ++i) {
+		ready_t* g = guesses[i];
+		if (g->runnable) {
+			entitled[i] += g->tickets * (v_fair - g->v_join);
+			runnable[i] += t - g->r_join;
+		}
+		ids[i] = 'A' + i;
+	}
+	stat_share(&lottery_stats.share, ids, received, entitled, runnable,
+	           n_slots);
+	free(ids);
+	free(received);
+	free(entitled);
+	free(runnable);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+
+	free_fenwick(&Q_ready);
+	free_queue(&Q_event);
+	open_sys_free_state((void**) guesses, n_slots);
+
+	stat_calc_final(&lottery_stats, &lottery_counts, t - t_begin);
+	lottery_stats.arrived = os.arrived;
+	lottery_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &lottery_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &lottery_stats.conv);
+
+	lottery_stats.error = lottery_error;
+	return lottery_stats;
+}
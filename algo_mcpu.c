@@ -0,0 +1,779 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "open_sys.h"
+#include "queue.h"
+
+/*
+Multi-CPU scheduling. There are args->cpus CPUs sharing one ready queue; CPU
+c runs args->cpu_speed[c] times as fast as the single CPU of the other
+algorithms, so a CPU burst of b ms takes ceil(b / speed) ms of wall time
+there. Each CPU switches processes in and out on its own.
+
+The ready queue is ordered by one of:
+- MC-FCFS: order of joining the queue.
+- MC-SJF: predicted burst time tau, as in SJF.
+- MC-RR: order of joining the queue, with a time slice of args->Tslice;
+  when it expires the process is preempted if the ready queue is not empty.
+
+Whenever there are ready processes and idle CPUs, the head of the ready queue
+is placed on an idle CPU chosen by args->placement (enum placement). The
+capacity-aware policy uses tau to predict the burst.
+
+With --cache-penalty, switching a process in also reloads its cache, which
+takes up to args->cache_penalty ms more when the cache is cold. The cache is
+warm only on the CPU the process last ran on, and its warmth
+  exp(-(time off the CPU) / cache_decay) * (1 - cache_evict)^(others run)
+falls with the time since the process left and with the switch-ins of other
+processes on that CPU meanwhile; the reload takes penalty * (1 - warmth).
+The -AFF variants keep a process on its last CPU whenever that CPU is idle.
+Per-CPU queues (below) always do so, so the -AFF variants run only with
+the shared queue.
+
+With --balance other than shared, each CPU has its own ready queue instead
+and runs only what is queued there. A process that becomes ready goes to an
+idle CPU (its last one first), else back to its last CPU, else to the least
+loaded one; a preempted process stays on its CPU. Load is a CPU's queue
+length plus one if it is busy. Queues drift apart unless rebalanced:
+- push: every args->balance_period ms, move processes from the back of the
+  most loaded queue to the least loaded until loads are less than 2 apart.
+- steal: a CPU that goes idle with an empty queue takes the back half of
+  the longest queue.
+A process switching in on another CPU than it last ran on pays
+args->migrate_cost ms more, on top of any cache reload.
+
+Ties between events are broken in the same order as RR, then by CPU.
+*/
+
+enum event_type {
+	EV_PROC_CPU_STOP = 0,
+	EV_PROC_CPU_PREEMPTION,
+	EV_PROC_CPU_START,
+	EV_PROC_CPU_CS,
+	EV_PROC_IO_STOP,
+	EV_PROC_ARRIVAL,
+	EV_BALANCE,
+};
+
+typedef struct {
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
+	enum event_type type; // Event type.
+	int burst;            // Current burst ID associated with event.
+	int cpu;              // CPU associated with event.
+} event_t;
+
+int Q_event_cmp_mcpu(const void* lhs, const void* rhs) {
+	const event_t *lhe = lhs, *rhe = rhs;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
+	int d_type = (int) lhe->type - (int) rhe->type;
+	int d_id = lhe->id - rhe->id;
+	int d_cpu = lhe->cpu - rhe->cpu;
+	return d_time != 0 ? d_time
+	                   : (d_type != 0 ? d_type : (d_id != 0 ? d_id : d_cpu));
+}
+
+typedef struct {
+	int id;           // Ready queue process id.
+	unsigned tau;     // Predicted burst time.
+	long seq;         // Order of joining the ready queue.
+	int burst;        // Current burst ID.
+	double remaining; // Work left in the current burst, in ms at speed 1.
+	int started;      // Whether the current burst has used a CPU yet.
+	sim_time_t t_join;  // When the current burst became ready. (turnaround)
+	sim_time_t p_join;  // When this process joined the ready queue. (wait)
+	long wait_obs;      // Its observation of the wait (conv_add()).
+	int last_cpu;     // CPU it last ran on, or -1.
+	sim_time_t t_left;  // When it last left that CPU.
+	long runs_at;     // Switch-ins on that CPU by then.
+} ready_t;
+
+int Q_ready_cmp_mcpu_fifo(const void* lhs, const void* rhs) {
+	const ready_t *lhg = lhs, *rhg = rhs;
+	return lhg->seq < rhg->seq ? -1 : (lhg->seq > rhg->seq);
+}
+
+int Q_ready_cmp_mcpu_sjf(const void* lhs, const void* rhs) {
+	const ready_t *lhg = lhs, *rhg = rhs;
+	if (lhg->tau != rhg->tau) return lhg->tau < rhg->tau ? -1 : 1;
+	return lhg->id - rhg->id;
+}
+
+enum mcpu_policy { MC_FCFS = 0, MC_SJF, MC_RR };
+
+static const char* mcpu_names[2][3] = {
+    {"MC-FCFS", "MC-SJF", "MC-RR"},
+    {"MC-FCFS-AFF", "MC-SJF-AFF", "MC-RR-AFF"},
+};
+
+enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS };
+
+typedef struct {
+	double speed;       // Relative speed.
+	enum cpu_mode mode; // What it is doing.
+	event_t* e_run;     // Pending stop or slice expiry of its process.
+	sim_time_t run_start; // When its process last started running.
+	double busy;        // Time spent running bursts.
+	double turn;        // Turnaround of the bursts that ended here.
+	int bursts;         // Bursts that ended here.
+	long runs;          // Switch-ins so far.
+	queue_t* Q;         // Its ready queue (one for all with a shared queue).
+	double idle_waiting; // Time idle while other queues had work.
+} core_t;
+
+void print_ready_queue_mcpu(FILE* out, const void* Q, int n) {
+	const core_t* cpus = Q;
+	int shared = n == 1 || cpus[0].Q == cpus[1].Q;
+	for (int k = 0; k < (shared ? 1 : n); ++k) {
+		queue_t* q2 = make_queue();
+		queue_copy(q2, cpus[k].Q);
+		if (shared) {
+			fprintf(out, "[Q");
+		} else {
+			fprintf(out, "%s[Q%d", k > 0 ? " " : "", k);
+		}
+		if (queue_peek(q2) == NULL) {
+			fprintf(out, " <empty>");
+		} else {
+			for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
+				fprintf(out, " %c", g->id);
+			}
+		}
+		fprintf(out, "]");
+		free_queue(&q2);
+	}
+}
+
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_mcpu, Q, args->cpus, str); \
+	} while (0)
+
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_mcpu, Q, args->cpus, fmt, __VA_ARGS__); \
+	} while (0)
+
+// An event the per-event output does not describe.
+#define observe_event(t, kind, id, arg) \
+	do { \
+		if (obs_wants(args->obs, kind)) obs_emit(args->obs, kind, t, id, arg); \
+	} while (0)
+
+/**
+ * @return Wall time for work ms of a burst at the given speed.
+ */
+unsigned wall_mcpu(double work, double speed) {
+	return ceil(work / speed - 1e-9);
+}
+
+/**
+ * @return How much of r's cache is still warm on CPU k at time t, from 0 to 1.
+ */
+double warmth_mcpu(const args_t* args, const core_t* cpus, const ready_t* r,
+                   int k, sim_time_t t) {
+	if (r->last_cpu != k) return 0.0;
+	return exp(-(double) (t - r->t_left) / args->cache_decay) *
+	       pow(1.0 - args->cache_evict, cpus[k].runs - r->runs_at);
+}
+
+/**
+ * Choose the idle CPU for ready process r under the placement policy, or its
+ * last CPU if affinity is set and that CPU is idle.
+ * @return The CPU, or -1 if none is idle.
+ */
+int place_mcpu(const args_t* args, const core_t* cpus, const ready_t* r,
+               const process_t* p, int affinity) {
+	if (affinity && r->last_cpu >= 0 && cpus[r->last_cpu].mode == CM_IDLE)
+		return r->last_cpu;
+
+	int fast = -1, slow = -1, fit = -1;
+	for (int c = 0; c < args->cpus; ++c) {
+		if (cpus[c].mode != CM_IDLE) continue;
+		if (fast < 0 || cpus[c].speed > cpus[fast].speed) fast = c;
+		if (slow < 0 || cpus[c].speed < cpus[slow].speed) slow = c;
+		if (wall_mcpu(r->tau, cpus[c].speed) <= args->Tslice &&
+		    (fit < 0 || cpus[c].speed < cpus[fit].speed))
+			fit = c;
+	}
+
+	switch (args->placement) {
+	case PLACE_CAPACITY:
+		return fit >= 0 ? fit : fast;
+	case PLACE_CPU_BOUND_BIG:
+		return p->cpu_bound ? fast : slow;
+	default:
+		return fast;
+	}
+}
+
+/**
+ * @return The load of CPU k: its queue length, plus one if it is busy.
+ */
+int load_mcpu(const core_t* cpus, int k) {
+	return queue_size(cpus[k].Q) + (cpus[k].mode != CM_IDLE);
+}
+
+/**
+ * Choose the queue of a process becoming ready with per-CPU queues.
+ */
+int wake_mcpu(const args_t* args, const core_t* cpus, const ready_t* r,
+              const process_t* p) {
+	int k = place_mcpu(args, cpus, r, p, 1);
+	if (k >= 0) return k;
+	if (r->last_cpu >= 0) return r->last_cpu;
+	k = 0;
+	for (int c = 1; c < args->cpus; ++c) {
+		if (load_mcpu(cpus, c) < load_mcpu(cpus, k)) k = c;
+	}
+	return k;
+}
+
+/**
+ * Remove the process that would run last from ready queue q.
+ * @return The process, or NULL if q is empty.
+ */
+ready_t* take_last_mcpu(queue_t* q) {
+	queue_t* q2 = make_queue();
+	queue_copy(q2, q);
+	ready_t* last = NULL;
+	for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) last = g;
+	free_queue(&q2);
+	if (last) queue_delete(q, queue_search(q, last));
+	return last;
+}
+
+/**
+ * Push processes from the most to the least loaded CPU until their loads
+ * are less than 2 apart.
+ * @return The number of processes moved.
+ */
+int push_mcpu(const args_t* args, core_t* cpus, sim_time_t t) {
+	int moved = 0;
+	for (;;) {
+		int hi = 0, lo = 0;
+		for (int c = 1; c < args->cpus; ++c) {
+			if (load_mcpu(cpus, c) > load_mcpu(cpus, hi)) hi = c;
+			if (load_mcpu(cpus, c) < load_mcpu(cpus, lo)) lo = c;
+		}
+		if (load_mcpu(cpus, hi) - load_mcpu(cpus, lo) < 2) break;
+
+		ready_t* g = take_last_mcpu(cpus[hi].Q);
+		queue_push(cpus[lo].Q, g);
+		++moved;
+		printf_event(t, 0, OBS_OTHER, g->id, 0,
+		             "Balancer moved process %c from CPU %d to CPU %d",
+		             cpus, g->id, hi, lo);
+	}
+	return moved;
+}
+
+/**
+ * Let idle CPU k with an empty queue steal the back half of the longest one.
+ * @return The number of processes moved.
+ */
+int steal_mcpu(const args_t* args, core_t* cpus, int k, sim_time_t t) {
+	int v = -1;
+	for (int c = 0; c < args->cpus; ++c) {
+		if (c != k && queue_size(cpus[c].Q) > 0 &&
+		    (v < 0 || queue_size(cpus[c].Q) > queue_size(cpus[v].Q)))
+			v = c;
+	}
+	if (v < 0) return 0;
+
+	int moved = (queue_size(cpus[v].Q) + 1) / 2;
+	for (int i = 0; i < moved; ++i) {
+		ready_t* g = take_last_mcpu(cpus[v].Q);
+		queue_push(cpus[k].Q, g);
+		printf_event(t, 0, OBS_OTHER, g->id, 0,
+		             "CPU %d stole process %c from CPU %d",
+		             cpus, k, g->id, v);
+	}
+	return moved;
+}
+
+/**
+ * Set e to the end of the next stretch of process g on CPU c: its burst
+ * completes or, under RR, its time slice expires.
+ */
+void schedule_run_mcpu(const args_t* args, event_t* e, const ready_t* g,
+                       const core_t* c, enum mcpu_policy policy, sim_time_t t) {
+	unsigned wall = wall_mcpu(g->remaining, c->speed);
+	if (policy == MC_RR && wall > args->Tslice) {
+		e->time = t + args->Tslice;
+		e->type = EV_PROC_CPU_PREEMPTION;
+	} else {
+		e->time = t + wall;
+		e->type = EV_PROC_CPU_STOP;
+	}
+}
+
+algo_stat_t run_mcpu(const args_t* args, process_t* procs,
+                     enum mcpu_policy policy, int affinity) {
+	const char* name = mcpu_names[affinity][policy];
+	algo_stat_t mcpu_stats = {0}, mcpu_counts = {0};
+
+	queue_t *Q_event = make_queue(), *Q_ready = make_queue();
+	queue_set_cmp(Q_event, Q_event_cmp_mcpu);
+	queue_set_cmp(Q_ready,
+	              policy == MC_SJF ? Q_ready_cmp_mcpu_sjf : Q_ready_cmp_mcpu_fifo);
+
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	int queues = args->balance != BAL_SHARED;
+	int push = args->balance == BAL_PUSH || args->balance == BAL_PUSH_STEAL;
+	int steal = args->balance == BAL_STEAL || args->balance == BAL_PUSH_STEAL;
+	core_t* cpus = calloc(args->cpus, sizeof(core_t));
+	for (int c = 0; c < args->cpus; ++c) {
+		cpus[c].speed = args->cpu_speed[c];
+		if (queues) {
+			cpus[c].Q = make_queue();
+			queue_set_cmp(cpus[c].Q, policy == MC_SJF ? Q_ready_cmp_mcpu_sjf
+			                                          : Q_ready_cmp_mcpu_fifo);
+		} else {
+			cpus[c].Q = Q_ready;
+		}
+	}
+	if (push) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = args->balance_period, .id = '#', .type = EV_BALANCE};
+		queue_push(Q_event, e);
+	}
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = procs[i].arrival_time,
+		               .id = procs[i].id,
+		               .type = EV_PROC_ARRIVAL,
+		               .burst = 0};
+		queue_push(Q_event, e);
+
+		guesses[i]->id = procs[i].id;
+	}
+
+	sim_time_t t = 0;
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for %s", cpus, name);
+
+	long seq = 0;
+	double reload = 0.0, warmth = 0.0;
+	int switches = 0, migrations = 0;
+	int moved = 0, imbalance_max = 0;
+	double imbalance = 0.0, imbalanced = 0.0;
+	sim_time_t t_begin = 0, t_cpus = 0, t_last = 0;
+	int mcpu_error = 0;
+	while (mcpu_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		event_t* e = queue_pop(Q_event);
+
+		t = e->time;
+		stat_warmup(&mcpu_stats, &mcpu_counts, args->warmup, t, &t_begin);
+
+		if (t_cpus != t_begin) {
+			// Warm-up over: measure the CPUs from here.
+			for (int c = 0; c < args->cpus; ++c) {
+				cpus[c].busy = cpus[c].turn = 0.0;
+				cpus[c].bursts = 0;
+				cpus[c].idle_waiting = 0.0;
+				if (cpus[c].mode == CM_BURST && cpus[c].run_start < t_begin)
+					cpus[c].busy -= t_begin - cpus[c].run_start;
+			}
+			reload = warmth = 0.0;
+			switches = migrations = moved = imbalance_max = 0;
+			imbalance = imbalanced = 0.0;
+			t_cpus = t_begin;
+		}
+
+		if (queues && t > t_last && t > t_begin) {
+			// Loads since the last event.
+			sim_time_t dt = t - (t_last > t_begin ? t_last : t_begin);
+			int hi = 0, lo = INT_MAX, waiting = 0;
+			for (int k = 0; k < args->cpus; ++k) {
+				int load = load_mcpu(cpus, k);
+				if (load > hi) hi = load;
+				if (load < lo) lo = load;
+				waiting += queue_size(cpus[k].Q);
+			}
+			imbalance += (double) (hi - lo) * dt;
+			if (hi - lo >= 2) imbalanced += dt;
+			if (hi - lo > imbalance_max) imbalance_max = hi - lo;
+			for (int k = 0; k < args->cpus; ++k) {
+				if (cpus[k].mode == CM_IDLE && waiting > 0) cpus[k].idle_waiting += dt;
+			}
+		}
+		t_last = t;
+
+		core_t* c = &cpus[e->cpu];
+		switch (e->type) {
+		case EV_PROC_CPU_STOP: {
+			ready_t* g = guesses[e->id - 'A'];
+			c->busy += t - c->run_start;
+			c->e_run = NULL;
+			g->remaining = 0;
+			g->last_cpu = e->cpu;
+			g->t_left = t;
+			g->runs_at = c->runs;
+
+			double t_turn = t - g->t_join + args->Tcs / 2;
+			stat_avg_add(&mcpu_stats.t_turn, &mcpu_counts.t_turn, t_turn,
+			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+			c->turn += t_turn;
+			++c->bursts;
+
+			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
+			if (bursts_left == 0) {
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated on CPU %d",
+				             cpus, e->id, e->cpu);
+				open_sys_retire(&os, e->id - 'A');
+				free(e);
+			} else {
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+				             "Process %c completed a CPU burst on CPU %d; %d "
+				             "burst%s to go",
+				             cpus, e->id, e->cpu, bursts_left,
+				             bursts_left == 1 ? "" : "s");
+
+				int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+				g->tau = exp_avg_tau(args->alpha, burst_len, g->tau);
+				observe_event(t, OBS_TAU, e->id, g->tau);
+
+				// Requeue IO burst completion once its device takes it.
+				e->type = EV_PROC_IO_STOP;
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU %d; blocking on I/O"
+					             " until time %llums",
+					             cpus, e->id, e->cpu, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU %d; waiting for I/O device %d",
+					             cpus, e->id, e->cpu, procs[e->id - 'A'].io_dev);
+				}
+			}
+
+			// Simulate context switch.
+			c->mode = CM_CS;
+			event_t* e_out = malloc(sizeof(event_t));
+			*e_out = (event_t){.id = '#',
+			                   .time = t + args->Tcs / 2,
+			                   .type = EV_PROC_CPU_CS,
+			                   .cpu = c - cpus};
+			queue_push(Q_event, e_out);
+
+			break;
+		}
+		case EV_PROC_CPU_PREEMPTION: {
+			// RR time slice expired.
+			ready_t* g = guesses[e->id - 'A'];
+			c->busy += t - c->run_start;
+			g->remaining -= (t - c->run_start) * c->speed;
+
+			if (queue_peek(c->Q) == NULL) {
+				print_event(t, 0, OBS_OTHER, 0, 0,
+				            "Time slice expired; no preemption because ready queue is empty",
+				            cpus);
+				c->run_start = t;
+				schedule_run_mcpu(args, e, g, c, policy, t);
+				queue_push(Q_event, e);
+			} else {
+				printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+				             "Time slice expired; preempting process %c on CPU %d with %.0fms remaining",
+				             cpus, e->id, e->cpu, g->remaining);
+				stat_pre_inc(&mcpu_stats, procs[e->id - 'A'].cpu_bound);
+				c->e_run = NULL;
+				c->mode = CM_CS;
+				g->last_cpu = e->cpu;
+				g->t_left = t;
+				g->runs_at = c->runs;
+				e->time = t + args->Tcs / 2;
+				e->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e);
+			}
+			break;
+		}
+		case EV_PROC_CPU_START: {
+			ready_t* g = guesses[e->id - 'A'];
+			int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+			if (g->remaining != burst_len) {
+				printf_event(t, 0, OBS_START, e->id, g->remaining,
+				             "Process %c started using CPU %d for remaining %.0fms of "
+				             "%dms burst",
+				             cpus, e->id, e->cpu, g->remaining, burst_len);
+			} else {
+				printf_event(t, 0, OBS_START, e->id, burst_len,
+				             "Process %c started using CPU %d for %dms burst",
+				             cpus, e->id, e->cpu, burst_len);
+			}
+
+			c->mode = CM_BURST;
+			c->run_start = t;
+			schedule_run_mcpu(args, e, g, c, policy, t);
+			queue_push(Q_event, e);
+			c->e_run = e;
+
+			stat_cs_inc(&mcpu_stats, procs[e->id - 'A'].cpu_bound);
+			break;
+		}
+		case EV_PROC_CPU_CS: {
+			// Switch out done; a preempted process rejoins the ready queue.
+			if (e->id != '#') {
+				ready_t* g = guesses[e->id - 'A'];
+				g->p_join = t;
+				g->seq = seq++;
+				queue_push(c->Q, g);
+			}
+
+			c->mode = CM_IDLE;
+			free(e);
+			break;
+		}
+		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			ready_t* g = guesses[e->id - 'A'];
+			g->burst = e->burst + 1;
+			g->remaining = procs[e->id - 'A'].cpu_bursts[g->burst];
+			g->started = 0;
+			g->t_join = t;
+			g->p_join = t;
+			g->seq = seq++;
+			stat_avg_add(&mcpu_stats.t_burst, &mcpu_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			int k = queues ? wake_mcpu(args, cpus, g, &procs[e->id - 'A']) : 0;
+			queue_push(cpus[k].Q, g);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
+			             "Process %c (tau %ums) completed I/O; added to ready queue",
+			             cpus, e->id, g->tau);
+			free(e);
+			break;
+		}
+		case EV_PROC_ARRIVAL: {
+			ready_t* g = guesses[e->id - 'A'];
+			*g = (ready_t){.id = e->id,
+			               .tau = ceil(1 / args->lambda),
+			               .seq = seq++,
+			               .remaining = procs[e->id - 'A'].cpu_bursts[0],
+			               .t_join = t,
+			               .p_join = t,
+			               .last_cpu = -1};
+			stat_avg_add(&mcpu_stats.t_burst, &mcpu_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			int k = queues ? wake_mcpu(args, cpus, g, &procs[e->id - 'A']) : 0;
+			queue_push(cpus[k].Q, g);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (tau %ums) arrived; added to ready queue",
+			             cpus, e->id, g->tau);
+			observe_event(t, OBS_TAU, e->id, g->tau);
+			free(e);
+			break;
+		}
+		case EV_BALANCE: {
+			moved += push_mcpu(args, cpus, t);
+
+			// Stop balancing once nothing else will happen.
+			if (queue_peek(Q_event) || open_sys_pending(&os)) {
+				e->time = t + args->balance_period;
+				queue_push(Q_event, e);
+			} else {
+				free(e);
+			}
+			break;
+		}
+		default:
+			fprintf(stderr, "ERROR: invalid event type %d.\n", e->type);
+			mcpu_error = 1;
+			free(e);
+			break;
+		}
+
+		// Place ready processes on idle CPUs.
+		for (;;) {
+			ready_t* r = NULL;
+			int k = -1;
+			if (queues) {
+				for (int c = 0; k < 0 && c < args->cpus; ++c) {
+					if (cpus[c].mode != CM_IDLE) continue;
+					if (steal && queue_peek(cpus[c].Q) == NULL)
+						moved += steal_mcpu(args, cpus, c, t);
+					if (queue_peek(cpus[c].Q)) k = c;
+				}
+				if (k < 0) break;
+				r = queue_pop(cpus[k].Q);
+			} else {
+				r = queue_peek(Q_ready);
+				if (r == NULL) break;
+				k = place_mcpu(args, cpus, r, &procs[r->id - 'A'], affinity);
+				if (k < 0) break;
+				queue_pop(Q_ready);
+			}
+
+			// Reload whatever part of its cache went cold.
+			double w = warmth_mcpu(args, cpus, r, k, t);
+			unsigned t_reload = ceil(args->cache_penalty * (1.0 - w) - 1e-9);
+			reload += t_reload;
+			warmth += w;
+			++switches;
+			if (r->last_cpu >= 0 && r->last_cpu != k) {
+				++migrations;
+				t_reload += args->migrate_cost;
+			}
+			++cpus[k].runs;
+
+			event_t* e_start = malloc(sizeof(event_t));
+			*e_start = (event_t){.time = t + args->Tcs / 2 + t_reload,
+			                     .id = r->id,
+			                     .type = EV_PROC_CPU_START,
+			                     .burst = r->burst,
+			                     .cpu = k};
+			queue_push(Q_event, e_start);
+			cpus[k].mode = CM_CS;
+
+			// A preempted burst's later waits add to its first.
+			stat_avg_add(&mcpu_stats.t_wait, r->started ? NULL : &mcpu_counts.t_wait,
+			             t - r->p_join, procs[r->id - 'A'].cpu_bound);
+			r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+			                       r->started ? r->wait_obs : CONV_NEW);
+			r->started = 1;
+		}
+	}
+
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for %s", cpus, name);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+
+	stat_calc_final(&mcpu_stats, &mcpu_counts, t - t_begin);
+
+	// Utilization is over all CPUs; then by class of CPU speed, fastest first.
+	mcpu_stat_t* m = &mcpu_stats.mcpu;
+	m->n = args->cpus;
+	double busy = 0.0;
+	for (int k = 0; k < args->cpus; ++k) {
+		// Bursts cut off by an early stop.
+		if (cpus[k].mode == CM_BURST) cpus[k].busy += t - cpus[k].run_start;
+		busy += cpus[k].busy;
+	}
+	mcpu_stats.cpu_util = busy / ((double) (t - t_begin) * args->cpus) * 100.0;
+	for (int k = 0; k < args->cpus; ++k) {
+		int l = 0;
+		while (l < m->classes && m->speed[l] != cpus[k].speed) ++l;
+		if (l == m->classes) {
+			// Insert the new speed in order.
+			while (l > 0 && m->speed[l - 1] < cpus[k].speed) {
+				m->speed[l] = m->speed[l - 1];
+				m->cpus[l] = m->cpus[l - 1];
+				m->util[l] = m->util[l - 1];
+				m->turn[l] = m->turn[l - 1];
+				m->bursts[l] = m->bursts[l - 1];
+				--l;
+			}
+			m->speed[l] = cpus[k].speed;
+			m->cpus[l] = m->util[l] = m->turn[l] = m->bursts[l] = 0;
+			++m->classes;
+		}
+		++m->cpus[l];
+		m->util[l] += cpus[k].busy;
+		m->turn[l] += cpus[k].turn;
+		m->bursts[l] += cpus[k].bursts;
+	}
+	for (int l = 0; l < m->classes; ++l) {
+		m->util[l] = m->util[l] / ((double) (t - t_begin) * m->cpus[l]) * 100.0;
+		if (m->bursts[l] > 0) m->turn[l] /= m->bursts[l];
+	}
+	m->cache = args->cache_penalty > 0;
+	m->reload = reload;
+	m->reload_pct = reload / ((double) (t - t_begin) * args->cpus) * 100.0;
+	m->warmth = switches > 0 ? warmth / switches : 0.0;
+	m->switches = switches;
+	m->migrations = migrations;
+	m->queues = queues;
+	m->moved = moved;
+	m->imbalance = imbalance / (t - t_begin);
+	m->imbalance_max = imbalance_max;
+	m->imbalanced_pct = imbalanced / (t - t_begin) * 100.0;
+	for (int k = 0; k < args->cpus; ++k) m->idle_waiting[k] = cpus[k].idle_waiting;
+
+	free_queue(&Q_ready);
+	free_queue(&Q_event);
+	open_sys_free_state((void**) guesses, n_slots);
+	for (int k = 0; queues && k < args->cpus; ++k) free_queue(&cpus[k].Q);
+	free(cpus);
+
+	mcpu_stats.arrived = os.arrived;
+	mcpu_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &mcpu_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &mcpu_stats.conv);
+
+	mcpu_stats.error = mcpu_error;
+	return mcpu_stats;
+}
+
+algo_stat_t algo_mc_fcfs(const args_t* args, process_t* procs) {
+	return run_mcpu(args, procs, MC_FCFS, 0);
+}
+
+algo_stat_t algo_mc_sjf(const args_t* args, process_t* procs) {
+	return run_mcpu(args, procs, MC_SJF, 0);
+}
+
+algo_stat_t algo_mc_rr(const args_t* args, process_t* procs) {
+	return run_mcpu(args, procs, MC_RR, 0);
+}
+
+algo_stat_t algo_mc_fcfs_aff(const args_t* args, process_t* procs) {
+	return run_mcpu(args, procs, MC_FCFS, 1);
+}
+
+algo_stat_t algo_mc_sjf_aff(const args_t* args, process_t* procs) {
+	return run_mcpu(args, procs, MC_SJF, 1);
+}
+
+algo_stat_t algo_mc_rr_aff(const args_t* args, process_t* procs) {
+	return run_mcpu(args, procs, MC_RR, 1);
+}
@@ -0,0 +1,481 @@
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "bqueue.h"
+#include "open_sys.h"
+#include "queue.h"
+
+/*
+Multi-level feedback queue. There are args->mlfq_levels priority levels, each
+a FIFO; level 0 is the highest priority and level k has an allotment of
+Tslice * 2^k milliseconds.
+
+- A process at a higher level always runs before one at a lower level, and
+  preempts it on arrival or I/O completion.
+- Processes at the same level take turns in round-robin order.
+- New processes start at level 0.
+- Once a process has used its allotment at a level, whether in one stretch or
+  across several bursts, it is demoted one level. Giving up the CPU early does
+  not reset the allotment.
+- Every args->mlfq_boost milliseconds, all processes move back to level 0.
+
+Ties between events are broken in the same order as RR.
+*/
+
+enum event_type {
+	EV_PROC_CPU_STOP = 0,
+	EV_PROC_CPU_PREEMPTION,
+	EV_PROC_CPU_START,
+	EV_PROC_CPU_CS,
+	EV_PROC_IO_STOP,
+	EV_PROC_ARRIVAL,
+	EV_MLFQ_BOOST,
+};
+
+typedef struct {
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
+	enum event_type type; // Event type.
+	int burst;            // Current burst ID associated with event.
+} event_t;
+
+int Q_event_cmp_mlfq(const void* lhs, const void* rhs) {
+	const event_t *lhe = lhs, *rhe = rhs;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
+	int d_type = (int) lhe->type - (int) rhe->type;
+	int d_id = lhe->id - rhe->id;
+	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
+}
+
+typedef struct {
+	int id;          // Ready queue process id.
+	int level;       // Priority level, 0 is the highest.
+	unsigned allot;  // CPU time used at this level.
+	int burst;       // Current burst ID.
+	int remaining;   // CPU time left in the current burst.
+	int started;     // Whether the current burst has used the CPU yet.
+	sim_time_t t_join; // When the current burst became ready. (turnaround)
+	sim_time_t p_join; // When this process joined the ready queue. (wait)
+	long wait_obs;     // Its observation of the wait (conv_add()).
+} ready_t;
+
+unsigned mlfq_slice(const args_t* args, int level) {
+	return args->Tslice << level;
+}
+
+void print_ready_queue_mlfq(FILE* out, const void* Q, int n) {
+	bqueue_t* q = (bqueue_t*) Q;
+	fprintf(out, "[Q");
+	if (bqueue_peek(q) == NULL) {
+		fprintf(out, " <empty>");
+	} else {
+		for (int l = 0; l < bqueue_levels(q); ++l) {
+			for (size_t i = 0; i < bqueue_size(q, l); ++i) {
+				fprintf(out, " %c", ((ready_t*) bqueue_at(q, l, i))->id);
+			}
+		}
+	}
+	fprintf(out, "]");
+}
+
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_mlfq, Q, 0, str); \
+	} while (0)
+
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_mlfq, Q, 0, fmt, __VA_ARGS__); \
+	} while (0)
+
+/**
+ * Set e to the end of the running process's next stretch on the CPU: either
+ * its burst completes or its allotment at this level runs out.
+ */
+void schedule_run_mlfq(const args_t* args, event_t* e, const ready_t* g,
+                       sim_time_t t) {
+	unsigned left = mlfq_slice(args, g->level) - g->allot;
+	if ((unsigned) g->remaining <= left) {
+		e->time = t + g->remaining;
+		e->type = EV_PROC_CPU_STOP;
+	} else {
+		e->time = t + left;
+		e->type = EV_PROC_CPU_PREEMPTION;
+	}
+}
+
+/**
+ * Charge g for ran milliseconds on the CPU.
+ * @return Whether g used up its allotment and was demoted.
+ */
+int charge_mlfq(const args_t* args, ready_t* g, unsigned ran) {
+	g->remaining -= ran;
+	g->allot += ran;
+	if (g->allot < mlfq_slice(args, g->level)) return 0;
+
+	g->allot = 0;
+	if (g->level == args->mlfq_levels - 1) return 0;
+	++g->level;
+	return 1;
+}
+
+algo_stat_t algo_mlfq(const args_t* args, process_t* procs) {
+	algo_stat_t mlfq_stats = {0}, mlfq_counts = {0};
+
+	queue_t* Q_event = make_queue();
+	queue_set_cmp(Q_event, Q_event_cmp_mlfq);
+	bqueue_t* Q_ready = make_bqueue(args->mlfq_levels);
+
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = procs[i].arrival_time,
+		               .id = procs[i].id,
+		               .type = EV_PROC_ARRIVAL,
+		               .burst = 0};
+		queue_push(Q_event, e);
+
+		guesses[i]->id = procs[i].id;
+	}
+
+	event_t* e_boost = malloc(sizeof(event_t));
+	*e_boost = (event_t){.time = args->mlfq_boost, .id = '#', .type = EV_MLFQ_BOOST};
+	queue_push(Q_event, e_boost);
+
+	sim_time_t t = 0;
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for MLFQ", Q_ready);
+
+	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+
+	// The pending stop or allotment expiry of the running process.
+	event_t* e_run = NULL;
+	sim_time_t run_start = 0;
+
+	sim_time_t t_begin = 0;
+	int mlfq_error = 0;
+	while (mlfq_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		event_t* e = queue_pop(Q_event);
+
+		// Nothing left to boost.
+		if (e->type == EV_MLFQ_BOOST && queue_peek(Q_event) == NULL &&
+		    !open_sys_pending(&os)) {
+			free(e);
+			break;
+		}
+
+		t = e->time;
+		stat_warmup(&mlfq_stats, &mlfq_counts, args->warmup, t, &t_begin);
+
+		switch (e->type) {
+		case EV_PROC_CPU_STOP: {
+			ready_t* g = guesses[e->id - 'A'];
+			charge_mlfq(args, g, t - run_start);
+			e_run = NULL;
+
+			double t_turn = t - g->t_join + args->Tcs / 2;
+			stat_avg_add(&mlfq_stats.t_turn, &mlfq_counts.t_turn, t_turn,
+			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+
+			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
+			if (bursts_left == 0) {
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
+				free(e);
+			} else {
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
+				             "Process %c (level %d) completed a CPU burst; %d "
+				             "burst%s to go",
+				             Q_ready, e->id, g->level, bursts_left,
+				             bursts_left == 1 ? "" : "s");
+
+				// Requeue IO burst completion once its device takes it.
+				e->type = EV_PROC_IO_STOP;
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
+			}
+
+			// Simulate context switch.
+			cpu_mode = CM_CS;
+			event_t* e_out = malloc(sizeof(event_t));
+			*e_out = (event_t){.id = '#', .time = t + args->Tcs / 2, .type = EV_PROC_CPU_CS};
+			queue_push(Q_event, e_out);
+
+			break;
+		}
+		case EV_PROC_CPU_PREEMPTION: {
+			// The running process used up its allotment at this level.
+			ready_t* g = guesses[e->id - 'A'];
+			if (charge_mlfq(args, g, t - run_start)) {
+				printf_event(t, 0, OBS_OTHER, e->id, 0,
+				             "Process %c used its time slice; demoted to level %d",
+				             Q_ready, e->id, g->level);
+			}
+
+			int top = bqueue_top(Q_ready);
+			if (top < 0 || top > g->level) {
+				if (top < 0) {
+					print_event(t, 0, OBS_OTHER, 0, 0,
+					            "Time slice expired; no preemption because ready queue is empty",
+					            Q_ready);
+				} else {
+					printf_event(t, 0, OBS_OTHER, e->id, 0,
+					             "Time slice expired; no preemption because process %c has the highest priority",
+					             Q_ready, e->id);
+				}
+				run_start = t;
+				schedule_run_mlfq(args, e, g, t);
+				queue_push(Q_event, e);
+			} else {
+				printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+				             "Time slice expired; preempting process %c with %dms remaining",
+				             Q_ready, e->id, g->remaining);
+				stat_pre_inc(&mlfq_stats, procs[e->id - 'A'].cpu_bound);
+				e_run = NULL;
+				cpu_mode = CM_CS;
+				e->time = t + args->Tcs / 2;
+				e->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e);
+			}
+			break;
+		}
+		case EV_PROC_CPU_START: {
+			ready_t* g = guesses[e->id - 'A'];
+			int top = bqueue_top(Q_ready);
+			if (top >= 0 && top < g->level) {
+				// A higher-priority process became ready while switching in.
+				printf_event(t, 0, OBS_PREEMPT, e->id, g->remaining,
+				             "Process %c (level %d) will preempt %c",
+				             Q_ready, ((ready_t*) bqueue_peek(Q_ready))->id,
+				             top, e->id);
+				stat_pre_inc(&mlfq_stats, procs[e->id - 'A'].cpu_bound);
+				cpu_mode = CM_CS;
+				e->time = t + args->Tcs / 2;
+				e->type = EV_PROC_CPU_CS;
+				queue_push(Q_event, e);
+				break;
+			}
+
+			int burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
+			if (g->remaining != burst_len) {
+				printf_event(t, 0, OBS_START, e->id, g->remaining,
+				             "Process %c (level %d) started using the CPU "
+				             "for remaining %dms of %dms burst",
+				             Q_ready, e->id, g->level, g->remaining, burst_len);
+			} else {
+				printf_event(t, 0, OBS_START, e->id, burst_len,
+				             "Process %c (level %d) started using the CPU "
+				             "for %dms burst",
+				             Q_ready, e->id, g->level, burst_len);
+			}
+
+			cpu_mode = CM_BURST;
+			run_start = t;
+			schedule_run_mlfq(args, e, g, t);
+			queue_push(Q_event, e);
+			e_run = e;
+
+			stat_cs_inc(&mlfq_stats, procs[e->id - 'A'].cpu_bound);
+			break;
+		}
+		case EV_PROC_CPU_CS: {
+			// Switch out done; a preempted process rejoins its level.
+			if (e->id != '#') {
+				ready_t* g = guesses[e->id - 'A'];
+				g->p_join = t;
+				bqueue_push(Q_ready, g->level, g);
+			}
+
+			cpu_mode = CM_IDLE;
+			free(e);
+			break;
+		}
+		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			ready_t* g = guesses[e->id - 'A'];
+			g->burst = e->burst + 1;
+			g->remaining = procs[e->id - 'A'].cpu_bursts[g->burst];
+			g->started = 0;
+			g->t_join = t;
+			g->p_join = t;
+			stat_avg_add(&mlfq_stats.t_burst, &mlfq_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			bqueue_push(Q_ready, g->level, g);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
+			             "Process %c (level %d) completed I/O; "
+			             "added to ready queue",
+			             Q_ready, e->id, g->level);
+			free(e);
+			break;
+		}
+		case EV_PROC_ARRIVAL: {
+			ready_t* g = guesses[e->id - 'A'];
+			*g = (ready_t){.id = e->id,
+			               .remaining = procs[e->id - 'A'].cpu_bursts[0],
+			               .t_join = t,
+			               .p_join = t};
+			stat_avg_add(&mlfq_stats.t_burst, &mlfq_counts.t_burst, g->remaining,
+			             procs[e->id - 'A'].cpu_bound);
+
+			bqueue_push(Q_ready, g->level, g);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (level %d) arrived; added to ready queue",
+			             Q_ready, e->id, g->level);
+			free(e);
+			break;
+		}
+		case EV_MLFQ_BOOST: {
+			// Charge the running process so far, then restart its stretch at
+			// level 0 below.
+			if (e_run) charge_mlfq(args, guesses[e_run->id - 'A'], t - run_start);
+
+			for (int l = 1; l < args->mlfq_levels; ++l) {
+				for (void* v = bqueue_pop_level(Q_ready, l); v;
+				     v = bqueue_pop_level(Q_ready, l)) {
+					bqueue_push(Q_ready, 0, v);
+				}
+			}
+			for (int i = 0; i < n_slots; ++i) {
+				guesses[i]->level = 0;
+				guesses[i]->allot = 0;
+			}
+
+			if (e_run) {
+				queue_delete(Q_event, queue_search(Q_event, e_run));
+				run_start = t;
+				schedule_run_mlfq(args, e_run, guesses[e_run->id - 'A'], t);
+				queue_push(Q_event, e_run);
+			}
+
+			print_event(t, 0, OBS_OTHER, 0, 0,
+			            "Priority boost; all processes moved to level 0",
+			            Q_ready);
+			e->time = t + args->mlfq_boost;
+			queue_push(Q_event, e);
+			break;
+		}
+		default:
+			fprintf(stderr, "ERROR: invalid event type %d.\n", e->type);
+			mlfq_error = 1;
+			free(e);
+			break;
+		}
+
+		// A process that became ready at a higher level preempts the running one.
+		int top = bqueue_top(Q_ready);
+		if (cpu_mode == CM_BURST && top >= 0 &&
+		    top < guesses[e_run->id - 'A']->level) {
+			ready_t* g = guesses[e_run->id - 'A'];
+			charge_mlfq(args, g, t - run_start);
+			queue_delete(Q_event, queue_search(Q_event, e_run));
+			printf_event(t, 0, OBS_PREEMPT, e_run->id, g->remaining,
+			             "Process %c (level %d) preempting %c with %dms remaining",
+			             Q_ready, ((ready_t*) bqueue_peek(Q_ready))->id, top,
+			             e_run->id, g->remaining);
+			stat_pre_inc(&mlfq_stats, procs[e_run->id - 'A'].cpu_bound);
+
+			cpu_mode = CM_CS;
+			e_run->time = t + args->Tcs / 2;
+			e_run->type = EV_PROC_CPU_CS;
+			queue_push(Q_event, e_run);
+			e_run = NULL;
+		}
+
+		if (cpu_mode == CM_IDLE) {
+			// Context switch in the head of the highest non-empty level.
+			ready_t* r = bqueue_pop(Q_ready);
+			if (r) {
+				event_t* e_start = malloc(sizeof(event_t));
+				*e_start = (event_t){.time = t + args->Tcs / 2,
+				                     .id = r->id,
+				                     .type = EV_PROC_CPU_START,
+				                     .burst = r->burst};
+				queue_push(Q_event, e_start);
+				cpu_mode = CM_CS;
+
+				// A preempted burst's later waits add to its first.
+				stat_avg_add(&mlfq_stats.t_wait, r->started ? NULL : &mlfq_counts.t_wait,
+				             t - r->p_join, procs[r->id - 'A'].cpu_bound);
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->started ? r->wait_obs : CONV_NEW);
+				r->started = 1;
+			}
+		}
+	}
+
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for MLFQ", Q_ready);
+
+	// Events left behind by an early stop, and the final boost.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+
+	free_bqueue(&Q_ready);
+	free_queue(&Q_event);
+	open_sys_free_state((void**) guesses, n_slots);
+
+	stat_calc_final(&mlfq_stats, &mlfq_counts, t - t_begin);
+	mlfq_stats.arrived = os.arrived;
+	mlfq_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &mlfq_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &mlfq_stats.conv);
+
+	mlfq_stats.error = mlfq_error;
+	return mlfq_stats;
+}
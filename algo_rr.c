@@ -1,7 +1,10 @@
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include "algo.h"
+#include "ckpt.h"
+#include "open_sys.h"
 #include "queue.h"
 
 enum event_type {
@@ -14,8 +17,8 @@ enum event_type {
 };
 
 typedef struct {
-	unsigned time;        // Event time.
-	char id;              // Process id associated with event.
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
 	enum event_type type; // Event type.
 	int burst;            // Current burst ID associated with event.
 	int time_slice;		  // Time slice
@@ -23,70 +26,171 @@ typedef struct {
 
 int Q_event_cmp_rr(const void* lhs, const void* rhs) {
 	const event_t *lhe = lhs, *rhe = rhs;
-	int d_time = lhe->time - rhe->time;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
 	int d_type = (int) lhe->type - (int) rhe->type;
 	int d_id = lhe->id - rhe->id;
 	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
 }
 
 typedef struct {
-	char id; 		 // Ready queue process id.
-	unsigned arrival;
+	int id; 		 // Ready queue process id.
+	sim_time_t arrival;
 	enum event_type type;
 	int burst;       // Next burst ID.
-	unsigned t_join; // When this process joined the ready queue. (turnaround)
-	unsigned p_join; // When this process joined the ready queue. (wait)
+	sim_time_t t_join; // When this process joined the ready queue. (turnaround)
+	sim_time_t p_join; // When this process joined the ready queue. (wait)
+	long wait_obs;     // Its observation of the wait (conv_add()).
 	int time_spent;	 // Record time spent in CPU
 } ready_t;
 
 int Q_ready_cmp_rr(const void* lhs, const void* rhs) {
 	const ready_t *lhg = lhs, *rhg = rhs;
-	int d_arrival = lhg->arrival - rhg->arrival;
+	int d_arrival = SIM_TIME_CMP(lhg->arrival, rhg->arrival);
 	int d_type = (int) lhg->type - (int) rhg->type;
 	int d_id = lhg->id - rhg->id;
 
 	return d_arrival != 0 ? d_arrival : (d_type != 0 ? d_type : d_id);
 }
 
-void print_ready_queue_rr(queue_t* q) {
+void print_ready_queue_rr(FILE* out, const void* q, int n) {
 	queue_t* q2 = make_queue();
 	queue_copy(q2, q);
-	printf("[Q");
+	fprintf(out, "[Q");
 	if (queue_peek(q2) == NULL) {
-		printf(" <empty>");
+		fprintf(out, " <empty>");
 	} else {
 		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
-			printf(" %c", g->id);
+			fprintf(out, " %c", g->id);
 		}
 	}
-	printf("]");
+	fprintf(out, "]");
 	free_queue(&q2);
 }
 
-#ifdef DEBUG_MODE
-#define DALWAYS_PRINT 1
-#else
-#define DALWAYS_PRINT 0
-#endif
-
-#define print_event(t, always_print, str, Q) \
+#define print_event(t, always_print, kind, id, arg, str, Q) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " str " ", t); \
-			print_ready_queue_rr(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_rr, Q, 0, str); \
 	} while (0)
 
-#define printf_event(t, always_print, fmt, Q, ...) \
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " fmt " ", t, __VA_ARGS__); \
-			print_ready_queue_rr(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_rr, Q, 0, fmt, __VA_ARGS__); \
 	} while (0)
 
+enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS };
+
+/**
+ * Write or read the state of an RR run between two events: the state every
+ * engine shares, then, unless restoring another engine's checkpoint, RR's.
+ */
+static void ckpt_state_rr(ckpt_t* ck, process_t** procs, ckpt_proc_t** where,
+                          ready_t*** guesses, int* n_slots, queue_t* Q_event,
+                          queue_t* Q_ready, open_sys_t* os, conv_t* cv,
+                          algo_stat_t* stats, algo_stat_t* counts,
+                          sim_time_t* t, sim_time_t* t_begin,
+                          enum cpu_mode* cpu_mode) {
+	ckpt_common(ck, t, os, procs, where);
+	if (ck->error) return;
+	if (os->slots > *n_slots) {
+		*guesses = (ready_t**) open_sys_grow_state(os, (void**) *guesses,
+		                                           *n_slots, sizeof(ready_t));
+		*n_slots = os->slots;
+	}
+	if (ck->restoring && !ck->same) return;
+	ckpt_data(ck, t_begin, sizeof(*t_begin));
+	ckpt_data(ck, cpu_mode, sizeof(*cpu_mode));
+	ckpt_data(ck, stats, sizeof(*stats));
+	ckpt_data(ck, counts, sizeof(*counts));
+	for (int i = 0; i < *n_slots; ++i)
+		ckpt_data(ck, (*guesses)[i], sizeof(ready_t));
+	ckpt_items(ck, Q_event, sizeof(event_t));
+	ckpt_refs(ck, Q_ready, (void**) *guesses, *n_slots);
+	ckpt_conv(ck, cv);
+}
+
+/**
+ * Where each process of an RR run stands at time t, for ckpt_common().
+ */
+static ckpt_proc_t* where_rr(process_t* procs, ready_t** guesses, int n_slots,
+                             queue_t* Q_event, queue_t* Q_ready, sim_time_t t) {
+	ckpt_proc_t* where = calloc(n_slots, sizeof(ckpt_proc_t));
+	queue_t* q = make_queue();
+	queue_copy(q, Q_event);
+	for (event_t* e = queue_pop(q); e; e = queue_pop(q)) {
+		if (e->id == '#') continue;
+		ckpt_proc_t* w = &where[e->id - 'A'];
+		int left = procs[e->id - 'A'].cpu_bursts[e->burst];
+		switch (e->type) {
+		case EV_PROC_ARRIVAL:
+			*w = (ckpt_proc_t){.where = CKPT_ARRIVING, .t = e->time};
+			break;
+		case EV_PROC_IO_STOP:
+			*w = (ckpt_proc_t){
+			    .where = CKPT_IO, .burst = e->burst, .t = e->time};
+			break;
+		default:
+			// A running slice is taken off the burst when it starts.
+			if (e->type == EV_PROC_CPU_STOP ||
+			    e->type == EV_PROC_CPU_PREEMPTION)
+				left += e->time - t;
+			*w = (ckpt_proc_t){.where = CKPT_READY,
+			                   .burst = e->burst,
+			                   .left = left,
+			                   .t = guesses[e->id - 'A']->t_join};
+			break;
+		}
+	}
+	queue_copy(q, Q_ready);
+	for (ready_t* r = queue_pop(q); r; r = queue_pop(q)) {
+		where[r->id - 'A'] =
+		    (ckpt_proc_t){.where = CKPT_READY,
+		                  .burst = r->burst,
+		                  .left = procs[r->id - 'A'].cpu_bursts[r->burst],
+		                  .t = r->t_join};
+	}
+	free_queue(&q);
+	return where;
+}
+
+/**
+ * Continue at time t the run of another engine, whose processes stand as in
+ * where, starting with a free CPU.
+ */
+static void adopt_rr(process_t* procs, const ckpt_proc_t* where,
+                     ready_t** guesses, int n_slots, queue_t* Q_event,
+                     queue_t* Q_ready, sim_time_t t) {
+	// In place of the arrivals of a fresh run.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+	for (int i = 0; i < n_slots; ++i) {
+		const ckpt_proc_t* w = &where[i];
+		if (w->where == CKPT_GONE) continue;
+		*guesses[i] = (ready_t){.id = procs[i].id, .burst = w->burst};
+		if (w->where == CKPT_READY) {
+			procs[i].cpu_bursts[w->burst] = w->left;
+			guesses[i]->arrival = w->t;
+			guesses[i]->type = EV_PROC_CPU_CS;
+			guesses[i]->t_join = w->t;
+			guesses[i]->p_join = t;
+			queue_push(Q_ready, guesses[i]);
+			continue;
+		}
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = w->t,
+		               .id = procs[i].id,
+		               .type = w->where == CKPT_IO ? EV_PROC_IO_STOP
+		                                           : EV_PROC_ARRIVAL,
+		               .burst = w->burst};
+		queue_push(Q_event, e);
+	}
+	event_t* e_out = malloc(sizeof(event_t));
+	*e_out = (event_t){.id = '#', .time = t, .type = EV_PROC_CPU_CS};
+	queue_push(Q_event, e_out);
+}
+
 algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 	algo_stat_t rr_stats = {0}, rr_counts = {0};
 
@@ -94,11 +198,17 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 	queue_set_cmp(Q_event, Q_event_cmp_rr);
 	queue_set_cmp(Q_ready, Q_ready_cmp_rr);
 
-	ready_t* guesses = calloc(args->n, sizeof(ready_t));
-	for (int i = 0; i < args->n; ++i) {
-		for (int j = 0; j < procs[i].cpu_burst_ct; ++j){
-			stat_avg_add(&rr_stats.t_burst, &rr_counts.t_burst, procs[i].cpu_bursts[j], procs[i].cpu_bound);
-		}
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
 		event_t* e = malloc(sizeof(event_t));
 		*e = (event_t){.time = procs[i].arrival_time,
 		               .id = procs[i].id,
@@ -106,46 +216,122 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 		               .burst = 0};
 		queue_push(Q_event, e);
 
-		guesses[i].id = procs[i].id;
-		guesses[i].burst = 0;
+		guesses[i]->id = procs[i].id;
+		guesses[i]->burst = 0;
 	}
 
-	unsigned int t = 0;
-	print_event(t, 1, "Simulator started for RR", Q_ready);
+	sim_time_t t = 0;
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for RR", Q_ready);
 
-	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+	enum cpu_mode cpu_mode = CM_IDLE;
 
+	sim_time_t t_begin = 0;
+	// Checkpoint first at the end of the warm-up, which later runs can
+	// continue from, then every args->checkpoint_every ms.
+	sim_time_t t_ckpt = args->warmup ? args->warmup : args->checkpoint_every;
 	int rr_error = 0;
-	while (rr_error == 0 && queue_peek(Q_event)) {
+	if (args->restore) {
+		ckpt_t ck;
+		ckpt_proc_t* where = NULL;
+		if (ckpt_restore(&ck, args->restore, "RR", args) != 0) {
+			rr_error = 1;
+		} else {
+			ckpt_state_rr(&ck, &procs, &where, &guesses, &n_slots, Q_event,
+			              Q_ready, &os, &cv, &rr_stats, &rr_counts, &t,
+			              &t_begin, &cpu_mode);
+			rr_error = ckpt_close(&ck) != 0;
+		}
+		if (rr_error == 0 && !ck.same) {
+			// Another policy's run is measured from here on.
+			adopt_rr(procs, where, guesses, n_slots, Q_event, Q_ready, t);
+			t_begin = t;
+		}
+		free(where);
+		if (rr_error == 0)
+			printf_event(t, 1, OBS_OTHER, 0, 0,
+			             "Simulator restored for RR from %s",
+			             Q_ready, args->restore);
+		t_ckpt = args->checkpoint_every ? (t / args->checkpoint_every + 1) *
+		                                      args->checkpoint_every
+		                                : SIM_TIME_MAX;
+	}
+	while (rr_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		sim_time_t t_next = ((event_t*) queue_peek(Q_event))->time;
+		if (args->checkpoint && t_next >= t_ckpt && ckpt_wanted(args, "RR")) {
+			ckpt_t ck;
+			if (ckpt_save(&ck, args->checkpoint, "RR", args) == 0) {
+				ckpt_proc_t* where =
+				    where_rr(procs, guesses, n_slots, Q_event, Q_ready, t);
+				ckpt_state_rr(&ck, &procs, &where, &guesses, &n_slots, Q_event,
+				              Q_ready, &os, &cv, &rr_stats, &rr_counts, &t,
+				              &t_begin, &cpu_mode);
+				free(where);
+				ckpt_close(&ck);
+			}
+			t_ckpt = args->checkpoint_every ? (t_next / args->checkpoint_every + 1) *
+			                                      args->checkpoint_every
+			                                : SIM_TIME_MAX;
+		}
+
 		event_t* e = queue_pop(Q_event);
 
 		t = e->time;
+		stat_warmup(&rr_stats, &rr_counts, args->warmup, t, &t_begin);
 
 		switch (e->type) {
 		case EV_PROC_CPU_STOP: {
-			stat_avg_add(&rr_stats.t_turn, &rr_counts.t_turn,
-			        t - guesses[e->id - 'A'].t_join + args->Tcs / 2,
+			double t_turn = t - guesses[e->id - 'A']->t_join + args->Tcs / 2;
+			stat_avg_add(&rr_stats.t_turn, &rr_counts.t_turn, t_turn,
 			        procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
 			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
 			if (bursts_left == 0) {
-				printf_event(t, 1, "Process %c terminated", Q_ready, e->id);
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
 				free(e);
 			} else {
-				printf_event(t, 0,
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
 				             "Process %c completed a CPU burst; %d "
 				             "burst%s to go",
 				             Q_ready, e->id, bursts_left, bursts_left == 1 ? "" : "s");
 
-				// Requeue IO burst completion.
-				guesses[e->id - 'A'].time_spent = 0;
-				e->time = t + args->Tcs / 2 + procs[e->id - 'A'].io_bursts[e->burst];
+				// Requeue IO burst completion once its device takes it.
+				guesses[e->id - 'A']->time_spent = 0;
 				e->type = EV_PROC_IO_STOP;
-				queue_push(Q_event, e);
-
-				printf_event(t, 0,
-				             "Process %c switching out of CPU; blocking on I/O"
-				             " until time %ums",
-				             Q_ready, e->id, e->time);
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
 			}
 
 			// Simulate context switch.
@@ -159,10 +345,12 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 		case EV_PROC_CPU_PREEMPTION: {
 			if (queue_peek(Q_ready) != NULL) {
 				unsigned bursts_len = procs[e->id - 'A'].cpu_bursts[e->burst];
-				guesses[e->id - 'A'].time_spent += args->Tslice;
+				guesses[e->id - 'A']->time_spent += args->Tslice;
 
-				printf_event(t, 0, "Time slice expired; preempting process %c with %dms remaining", Q_ready, e->id, bursts_len);
-				// queue_push(Q_ready, &guesses[e->id - 'A']);
+				printf_event(t, 0, OBS_PREEMPT, e->id, bursts_len,
+				             "Time slice expired; preempting process %c with %dms remaining",
+				             Q_ready, e->id, bursts_len);
+				// queue_push(Q_ready, guesses[e->id - 'A']);
 				
 
 				stat_pre_inc(&rr_stats, procs[e->id - 'A'].cpu_bound);
@@ -172,8 +360,10 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 
 				queue_push(Q_event, e);
 			} else {
-				print_event(t, 0, "Time slice expired; no preemption because ready queue is empty", Q_ready);
-				guesses[e->id - 'A'].time_spent += args->Tslice; 
+				print_event(t, 0, OBS_OTHER, 0, 0,
+				            "Time slice expired; no preemption because ready queue is empty",
+				            Q_ready);
+				guesses[e->id - 'A']->time_spent += args->Tslice; 
 				unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
 
 				if (burst_len > args->Tslice) {
@@ -193,15 +383,15 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 		case EV_PROC_CPU_START: {
 			unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
 
-			if (guesses[e->id - 'A'].time_spent != 0) {
-					printf_event(t, 0,
+			if (guesses[e->id - 'A']->time_spent != 0) {
+					printf_event(t, 0, OBS_START, e->id, burst_len,
 					             "Process %c started using the "
 					             "CPU "
 					             "for remaining %ums of %ums burst",
 					             Q_ready, e->id, burst_len,
-					             burst_len + guesses[e->id - 'A'].time_spent);
+					             burst_len + guesses[e->id - 'A']->time_spent);
 				} else {
-					printf_event(t, 0,
+					printf_event(t, 0, OBS_START, e->id, burst_len,
 					             "Process %c started "
 					             "using the CPU "
 					             "for %ums burst",
@@ -231,14 +421,28 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 			break;
 		}
 		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			// Bursts are counted once, when they first become ready.
+			stat_avg_add(&rr_stats.t_burst, &rr_counts.t_burst,
+			             procs[e->id - 'A'].cpu_bursts[e->burst + 1],
+			             procs[e->id - 'A'].cpu_bound);
+
 			// Add to ready queue.
-			guesses[e->id - 'A'].arrival = t;
-			guesses[e->id - 'A'].type = e->type;
-			guesses[e->id - 'A'].burst = e->burst + 1;
-			guesses[e->id - 'A'].t_join = t;
-			guesses[e->id - 'A'].p_join = t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0,
+			guesses[e->id - 'A']->arrival = t;
+			guesses[e->id - 'A']->type = e->type;
+			guesses[e->id - 'A']->burst = e->burst + 1;
+			guesses[e->id - 'A']->t_join = t;
+			guesses[e->id - 'A']->p_join = t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
 			             "Process %c completed I/O; "
 			             "added to ready queue",
 			             Q_ready, e->id);
@@ -248,10 +452,10 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 		case EV_PROC_CPU_CS: {
 
 			if (e->id != '#') {
-				guesses[e->id - 'A'].arrival = t;
-				guesses[e->id - 'A'].type = e->type;
-				guesses[e->id - 'A'].p_join = t;
-				queue_push(Q_ready, &guesses[e->id - 'A']);
+				guesses[e->id - 'A']->arrival = t;
+				guesses[e->id - 'A']->type = e->type;
+				guesses[e->id - 'A']->p_join = t;
+				queue_push(Q_ready, guesses[e->id - 'A']);
 			}
 
 			cpu_mode = CM_IDLE;
@@ -261,15 +465,20 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 			break;
 		}
 		case EV_PROC_ARRIVAL: {
+			stat_avg_add(&rr_stats.t_burst, &rr_counts.t_burst,
+			             procs[e->id - 'A'].cpu_bursts[0],
+			             procs[e->id - 'A'].cpu_bound);
+
 			// Add to ready queue.
-			guesses[e->id - 'A'].arrival = t;
-			guesses[e->id - 'A'].type = e->type;
-			guesses[e->id - 'A'].burst = 0;
-			guesses[e->id - 'A'].t_join = t;
-			guesses[e->id - 'A'].p_join = t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0, "Process %c arrived; added to ready queue", Q_ready,
-			             e->id);
+			guesses[e->id - 'A']->arrival = t;
+			guesses[e->id - 'A']->type = e->type;
+			guesses[e->id - 'A']->burst = 0;
+			guesses[e->id - 'A']->t_join = t;
+			guesses[e->id - 'A']->p_join = t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c arrived; added to ready queue",
+			             Q_ready, e->id);
 			free(e);
 			break;
 		}
@@ -298,17 +507,29 @@ algo_stat_t algo_rr(const args_t* args, process_t* procs) {
 					stat_avg_add(&rr_stats.t_wait, &rr_counts.t_wait, t - r->p_join,
 				             procs[r->id - 'A'].cpu_bound);
 				}
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->time_spent ? r->wait_obs : CONV_NEW);
 			}
 		}
 	}
 
-	print_event(t, 1, "Simulator ended for RR", Q_ready);
+	print_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for RR", Q_ready);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
 
 	free_queue(&Q_ready);
 	free_queue(&Q_event);
-	free(guesses);
+	open_sys_free_state((void**) guesses, n_slots);
 
-	stat_calc_final(&rr_stats, &rr_counts, t);
+	stat_calc_final(&rr_stats, &rr_counts, t - t_begin);
+	rr_stats.arrived = os.arrived;
+	rr_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &rr_stats.io);
+	io_sys_free(&io);
+	conv_finish(&cv, t, &rr_stats.conv);
 
+	rr_stats.error = rr_error;
 	return rr_stats;
 }
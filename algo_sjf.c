@@ -1,7 +1,10 @@
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include "algo.h"
+#include "ckpt.h"
+#include "open_sys.h"
 #include "queue.h"
 
 enum event_type {
@@ -13,25 +16,26 @@ enum event_type {
 };
 
 typedef struct {
-	unsigned time;        // Event time.
-	char id;              // Process id associated with event.
+	sim_time_t time;        // Event time.
+	int id;               // Process id associated with event.
 	enum event_type type; // Event type.
 	int burst;            // Current burst ID associated with event.
 } event_t;
 
 int Q_event_cmp(const void* lhs, const void* rhs) {
 	const event_t *lhe = lhs, *rhe = rhs;
-	int d_time = (int) lhe->time - (int) rhe->time;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
 	int d_type = (int) lhe->type - (int) rhe->type;
 	int d_id = (int) lhe->id - (int) rhe->id;
 	return d_time != 0 ? d_time : (d_type != 0 ? d_type : d_id);
 }
 
 typedef struct {
-	char id;         // Ready queue process id.
+	int id;          // Ready queue process id.
 	unsigned tau;    // Estimated job time.
+	pred_t pred;     // Predictor state behind tau.
 	int burst;       // Next burst ID.
-	unsigned t_join; // Time when this process joined the ready queue.
+	sim_time_t t_join; // Time when this process joined the ready queue.
 } ready_t;
 
 int Q_ready_cmp(const void* lhs, const void* rhs) {
@@ -40,53 +44,190 @@ int Q_ready_cmp(const void* lhs, const void* rhs) {
 	return d_tau == 0 ? lhg->id - rhg->id : d_tau;
 }
 
-void print_ready_queue(queue_t* q) {
+void print_ready_queue(FILE* out, const void* q, int n) {
 	queue_t* q2 = make_queue();
 	queue_copy(q2, q);
-	printf("[Q");
+	fprintf(out, "[Q");
 	if (queue_peek(q2) == NULL) {
-		printf(" <empty>");
+		fprintf(out, " <empty>");
 	} else {
 		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
-			printf(" %c", g->id);
+			fprintf(out, " %c", g->id);
 		}
 	}
-	printf("]");
+	fprintf(out, "]");
 	free_queue(&q2);
 }
 
-#ifdef DEBUG_MODE
-#define DALWAYS_PRINT 1
-#else
-#define DALWAYS_PRINT 0
-#endif
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue, Q, 0, str); \
+	} while (0)
 
-#define print_event(t, always_print, str, Q) \
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " str " ", t); \
-			print_ready_queue(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue, Q, 0, fmt, __VA_ARGS__); \
 	} while (0)
 
-#define printf_event(t, always_print, fmt, Q, ...) \
+// An event the per-event output does not describe.
+#define observe_event(t, kind, id, arg) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " fmt " ", t, __VA_ARGS__); \
-			print_ready_queue(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) obs_emit(args->obs, kind, t, id, arg); \
 	} while (0)
 
-algo_stat_t algo_sjf(const args_t* args, process_t* procs) {
+enum cpu_mode { CM_IDLE = 0, CM_CS, CM_BURST };
+
+/**
+ * Write or read the state of an SJF run between two events: the state every
+ * engine shares, then, unless restoring another engine's checkpoint, SJF's.
+ */
+static void ckpt_state_sjf(ckpt_t* ck, process_t** procs, ckpt_proc_t** where,
+                           ready_t*** guesses, int* n_slots, queue_t* Q_event,
+                           queue_t* Q_ready, open_sys_t* os, predict_t* pr,
+                           conv_t* cv, algo_stat_t* stats, algo_stat_t* counts,
+                           sim_time_t* t, sim_time_t* t_begin,
+                           enum cpu_mode* cpu_mode) {
+	ckpt_common(ck, t, os, procs, where);
+	if (ck->error) return;
+	if (os->slots > *n_slots) {
+		*guesses = (ready_t**) open_sys_grow_state(os, (void**) *guesses,
+		                                           *n_slots, sizeof(ready_t));
+		*n_slots = os->slots;
+	}
+	if (ck->restoring && !ck->same) return;
+	ckpt_data(ck, t_begin, sizeof(*t_begin));
+	ckpt_data(ck, cpu_mode, sizeof(*cpu_mode));
+	ckpt_data(ck, stats, sizeof(*stats));
+	ckpt_data(ck, counts, sizeof(*counts));
+	ckpt_data(ck, pr->class_sum, sizeof(pr->class_sum));
+	ckpt_data(ck, pr->class_n, sizeof(pr->class_n));
+	for (int i = 0; i < *n_slots; ++i)
+		ckpt_data(ck, (*guesses)[i], sizeof(ready_t));
+	ckpt_items(ck, Q_event, sizeof(event_t));
+	ckpt_refs(ck, Q_ready, (void**) *guesses, *n_slots);
+	ckpt_conv(ck, cv);
+}
+
+/**
+ * Where each process of an SJF run stands at time t, for ckpt_common(). The
+ * oracle's taus are no predictions.
+ */
+static ckpt_proc_t* where_sjf(process_t* procs, ready_t** guesses,
+                              int n_slots, queue_t* Q_event, queue_t* Q_ready,
+                              sim_time_t t, int oracle) {
+	ckpt_proc_t* where = calloc(n_slots, sizeof(ckpt_proc_t));
+	queue_t* q = make_queue();
+	queue_copy(q, Q_event);
+	for (event_t* e = queue_pop(q); e; e = queue_pop(q)) {
+		if (e->type == EV_PROC_CS_OUT) continue;
+		ckpt_proc_t* w = &where[e->id - 'A'];
+		switch (e->type) {
+		case EV_PROC_ARRIVAL:
+			*w = (ckpt_proc_t){.where = CKPT_ARRIVING, .t = e->time};
+			continue;
+		case EV_PROC_IO_STOP:
+			*w = (ckpt_proc_t){
+			    .where = CKPT_IO, .burst = e->burst, .t = e->time};
+			break;
+		default:
+			*w = (ckpt_proc_t){
+			    .where = CKPT_READY,
+			    .burst = e->burst,
+			    .left = e->type == EV_PROC_CPU_STOP
+			                ? (int) (e->time - t)
+			                : procs[e->id - 'A'].cpu_bursts[e->burst],
+			    .t = guesses[e->id - 'A']->t_join};
+			break;
+		}
+		if (!oracle) {
+			w->tau = guesses[e->id - 'A']->tau;
+			w->pred = guesses[e->id - 'A']->pred;
+		}
+	}
+	queue_copy(q, Q_ready);
+	for (ready_t* r = queue_pop(q); r; r = queue_pop(q)) {
+		where[r->id - 'A'] =
+		    (ckpt_proc_t){.where = CKPT_READY,
+		                  .burst = r->burst,
+		                  .left = procs[r->id - 'A'].cpu_bursts[r->burst],
+		                  .t = r->t_join,
+		                  .tau = oracle ? 0 : r->tau,
+		                  .pred = r->pred};
+	}
+	free_queue(&q);
+	return where;
+}
+
+/**
+ * Continue at time t the run of another engine, whose processes stand as in
+ * where, starting with a free CPU. Processes it made no predictions for
+ * start over as new ones.
+ */
+static void adopt_sjf(process_t* procs, const ckpt_proc_t* where,
+                      ready_t** guesses, int n_slots, queue_t* Q_event,
+                      queue_t* Q_ready, predict_t* pr, sim_time_t t,
+                      int oracle) {
+	// In place of the arrivals of a fresh run.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+	for (int i = 0; i < n_slots; ++i) {
+		const ckpt_proc_t* w = &where[i];
+		if (w->where == CKPT_GONE) continue;
+		*guesses[i] = (ready_t){.id = procs[i].id,
+		                        .tau = w->tau,
+		                        .pred = w->pred,
+		                        .burst = w->burst};
+		if (w->where == CKPT_READY) procs[i].cpu_bursts[w->burst] = w->left;
+		if (w->where != CKPT_ARRIVING && (oracle || w->tau == 0)) {
+			int next = w->burst + (w->where == CKPT_IO);
+			guesses[i]->tau = oracle ? (unsigned) procs[i].cpu_bursts[next]
+			                         : predict_first(pr, &guesses[i]->pred,
+			                                         procs[i].cpu_bound);
+		}
+		if (w->where == CKPT_READY) {
+			guesses[i]->t_join = w->t;
+			queue_push(Q_ready, guesses[i]);
+			continue;
+		}
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = w->t,
+		               .id = procs[i].id,
+		               .type = w->where == CKPT_IO ? EV_PROC_IO_STOP
+		                                           : EV_PROC_ARRIVAL,
+		               .burst = w->burst};
+		queue_push(Q_event, e);
+	}
+	event_t* e_out = malloc(sizeof(event_t));
+	*e_out = (event_t){.time = t, .type = EV_PROC_CS_OUT};
+	queue_push(Q_event, e_out);
+}
+
+/**
+ * SJF ordered by predicted bursts or, for the oracle, by the true bursts.
+ */
+algo_stat_t run_sjf(const args_t* args, process_t* procs, int oracle) {
+	const char* name = oracle ? "SJF-ORACLE" : "SJF";
 	algo_stat_t sjf_stats = {0}, sjf_counts = {0};
 	queue_t *Q_event = make_queue(), *Q_ready = make_queue();
 	queue_set_cmp(Q_event, Q_event_cmp);
 	queue_set_cmp(Q_ready, Q_ready_cmp);
 
-	ready_t* guesses = calloc(args->n, sizeof(ready_t));
-	for (int i = 0; i < args->n; ++i) {
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	predict_t pr;
+	predict_init(&pr, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
+
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
 		event_t* e = malloc(sizeof(event_t));
 		*e = (event_t){.time = procs[i].arrival_time,
 		               .id = procs[i].id,
@@ -94,53 +235,135 @@ algo_stat_t algo_sjf(const args_t* args, process_t* procs) {
 		               .burst = 0};
 		queue_push(Q_event, e);
 
-		guesses[i].id = procs[i].id;
-		guesses[i].tau = ceil(1 / args->lambda);
-		guesses[i].burst = 0;
+		guesses[i]->id = procs[i].id;
+		guesses[i]->tau = ceil(1 / args->lambda);
+		guesses[i]->burst = 0;
 	}
 
-	unsigned int t = 0;
-	print_event(t, 1, "Simulator started for SJF", Q_ready);
+	sim_time_t t = 0;
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for %s", Q_ready,
+	             name);
 
-	enum cpu_mode { CM_IDLE = 0, CM_CS, CM_BURST } cpu_mode = CM_IDLE;
+	enum cpu_mode cpu_mode = CM_IDLE;
 
+	sim_time_t t_begin = 0;
+	// Checkpoint first at the end of the warm-up, which later runs can
+	// continue from, then every args->checkpoint_every ms.
+	sim_time_t t_ckpt = args->warmup ? args->warmup : args->checkpoint_every;
 	int sjf_error = 0;
-	while (sjf_error == 0 && queue_peek(Q_event)) {
+	if (args->restore) {
+		ckpt_t ck;
+		ckpt_proc_t* where = NULL;
+		if (ckpt_restore(&ck, args->restore, name, args) != 0) {
+			sjf_error = 1;
+		} else {
+			ckpt_state_sjf(&ck, &procs, &where, &guesses, &n_slots, Q_event,
+			               Q_ready, &os, &pr, &cv, &sjf_stats, &sjf_counts, &t,
+			               &t_begin, &cpu_mode);
+			sjf_error = ckpt_close(&ck) != 0;
+		}
+		if (sjf_error == 0 && !ck.same) {
+			// Another policy's run is measured from here on.
+			adopt_sjf(procs, where, guesses, n_slots, Q_event, Q_ready, &pr, t,
+			          oracle);
+			t_begin = t;
+		}
+		free(where);
+		if (sjf_error == 0)
+			printf_event(t, 1, OBS_OTHER, 0, 0,
+			             "Simulator restored for %s from %s",
+			             Q_ready, name, args->restore);
+		t_ckpt = args->checkpoint_every ? (t / args->checkpoint_every + 1) *
+		                                      args->checkpoint_every
+		                                : SIM_TIME_MAX;
+	}
+	while (sjf_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id, .tau = ceil(1 / args->lambda)};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		sim_time_t t_next = ((event_t*) queue_peek(Q_event))->time;
+		if (args->checkpoint && t_next >= t_ckpt && ckpt_wanted(args, name)) {
+			ckpt_t ck;
+			if (ckpt_save(&ck, args->checkpoint, name, args) == 0) {
+				ckpt_proc_t* where = where_sjf(procs, guesses, n_slots, Q_event,
+				                               Q_ready, t, oracle);
+				ckpt_state_sjf(&ck, &procs, &where, &guesses, &n_slots,
+				               Q_event, Q_ready, &os, &pr, &cv, &sjf_stats,
+				               &sjf_counts, &t, &t_begin, &cpu_mode);
+				free(where);
+				ckpt_close(&ck);
+			}
+			t_ckpt = args->checkpoint_every
+			             ? (t_next / args->checkpoint_every + 1) *
+			                   args->checkpoint_every
+			             : SIM_TIME_MAX;
+		}
+
 		event_t* e = queue_pop(Q_event);
 
 		assert(e->time >= t);
 		t = e->time;
+		stat_warmup(&sjf_stats, &sjf_counts, args->warmup, t, &t_begin);
 
 		switch (e->type) {
 		case EV_PROC_CPU_STOP: {
 			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
 			if (bursts_left == 0) {
-				printf_event(t, 1, "Process %c terminated", Q_ready, e->id);
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
 				free(e);
 			} else {
-				unsigned tau_n = guesses[e->id - 'A'].tau;
+				unsigned tau_n = guesses[e->id - 'A']->tau;
 				unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
-				printf_event(t, 0,
+				unsigned b_next = procs[e->id - 'A'].cpu_bursts[e->burst + 1];
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
 				             "Process %c (tau %ums) completed a CPU burst; %d "
 				             "burst%s to go",
 				             Q_ready, e->id, tau_n, bursts_left,
 				             bursts_left == 1 ? "" : "s");
-				guesses[e->id - 'A'].tau = exp_avg_tau(args->alpha, burst_len, tau_n);
-				printf_event(t, 0,
+				guesses[e->id - 'A']->tau =
+				    oracle ? b_next
+				           : predict_update(&pr, &guesses[e->id - 'A']->pred, tau_n,
+				                            burst_len, procs[e->id - 'A'].cpu_bound,
+				                            &sjf_stats.pred);
+				printf_event(t, 0, OBS_TAU, e->id, guesses[e->id - 'A']->tau,
 				             "Recalculating tau for process %c: old tau %ums"
 				             " ==> new tau %ums",
-				             Q_ready, e->id, tau_n, guesses[e->id - 'A'].tau);
-
-				// Requeue IO burst completion.
-				e->time = t + args->Tcs / 2 + procs[e->id - 'A'].io_bursts[e->burst];
+				             Q_ready, e->id, tau_n, guesses[e->id - 'A']->tau);
 
+				// Requeue IO burst completion once its device takes it.
 				e->type = EV_PROC_IO_STOP;
-				queue_push(Q_event, e);
-
-				printf_event(t, 0,
-				             "Process %c switching out of CPU; blocking on I/O"
-				             " until time %ums",
-				             Q_ready, e->id, e->time);
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
 			}
 
 			// Simulate context switch.
@@ -160,10 +383,10 @@ algo_stat_t algo_sjf(const args_t* args, process_t* procs) {
 		case EV_PROC_CPU_START: {
 			unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
 			// Print Process C (tau 1000ms) started using the CPU for 2920ms burst
-			printf_event(t, 0,
+			printf_event(t, 0, OBS_START, e->id, burst_len,
 			             "Process %c (tau %ums) started using the CPU "
 			             "for %ums burst",
-			             Q_ready, e->id, guesses[e->id - 'A'].tau, burst_len);
+			             Q_ready, e->id, guesses[e->id - 'A']->tau, burst_len);
 
 			// Set CPU_mode.
 			cpu_mode = CM_BURST;
@@ -180,31 +403,47 @@ algo_stat_t algo_sjf(const args_t* args, process_t* procs) {
 			// At this time, we have done the context switch in, so turnaround is wait
 			// time + burst + switch out.
 			double t_turn =
-			    t - guesses[e->id - 'A'].t_join + burst_len + args->Tcs / 2;
+			    t - guesses[e->id - 'A']->t_join + burst_len + args->Tcs / 2;
 			stat_avg_add(&sjf_stats.t_turn, &sjf_counts.t_turn, t_turn,
 			             procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
 
 			break;
 		}
 		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
 			// Add to ready queue.
-			guesses[e->id - 'A'].burst = e->burst + 1;
-			guesses[e->id - 'A'].t_join = t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0,
+			guesses[e->id - 'A']->burst = e->burst + 1;
+			guesses[e->id - 'A']->t_join = t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
 			             "Process %c (tau %ums) completed I/O; "
 			             "added to ready queue",
-			             Q_ready, e->id, guesses[e->id - 'A'].tau);
+			             Q_ready, e->id, guesses[e->id - 'A']->tau);
 			free(e);
 			break;
 		}
 		case EV_PROC_ARRIVAL: {
 			// Add to ready queue.
-			guesses[e->id - 'A'].burst = 0;
-			guesses[e->id - 'A'].t_join = t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0, "Process %c (tau %ums) arrived; added to ready queue",
-			             Q_ready, e->id, guesses[e->id - 'A'].tau);
+			guesses[e->id - 'A']->tau =
+			    oracle ? (unsigned) procs[e->id - 'A'].cpu_bursts[0]
+			           : predict_first(&pr, &guesses[e->id - 'A']->pred,
+			                           procs[e->id - 'A'].cpu_bound);
+			guesses[e->id - 'A']->burst = 0;
+			guesses[e->id - 'A']->t_join = t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (tau %ums) arrived; added to ready queue",
+			             Q_ready, e->id, guesses[e->id - 'A']->tau);
+			observe_event(t, OBS_TAU, e->id, guesses[e->id - 'A']->tau);
 			free(e);
 			break;
 		}
@@ -228,19 +467,40 @@ algo_stat_t algo_sjf(const args_t* args, process_t* procs) {
 
 				stat_avg_add(&sjf_stats.t_wait, &sjf_counts.t_wait, t - r->t_join,
 				             procs[r->id - 'A'].cpu_bound);
+				conv_add(&cv, CONV_WAIT, t - r->t_join, CONV_NEW);
 
 				stat_cs_inc(&sjf_stats, procs[r->id - 'A'].cpu_bound);
 			}
 		}
 	}
 
-	print_event(t, 1, "Simulator ended for SJF", Q_ready);
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for %s", Q_ready,
+	             name);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
 
 	free_queue(&Q_ready);
 	free_queue(&Q_event);
-	free(guesses);
+	open_sys_free_state((void**) guesses, n_slots);
+
+	stat_calc_final(&sjf_stats, &sjf_counts, t - t_begin);
+	sjf_stats.arrived = os.arrived;
+	sjf_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &sjf_stats.io);
+	io_sys_free(&io);
+	if (!oracle) predict_finish(&pr, &sjf_stats.pred);
+	conv_finish(&cv, t, &sjf_stats.conv);
+
+	sjf_stats.error = sjf_error;
+	return sjf_stats;
+}
 
-	stat_calc_final(&sjf_stats, &sjf_counts, t);
+algo_stat_t algo_sjf(const args_t* args, process_t* procs) {
+	return run_sjf(args, procs, 0);
+}
 
-	return sjf_stats;
+algo_stat_t algo_sjf_oracle(const args_t* args, process_t* procs) {
+	return run_sjf(args, procs, 1);
 }
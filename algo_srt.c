@@ -1,7 +1,10 @@
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include "algo.h"
+#include "ckpt.h"
+#include "open_sys.h"
 #include "queue.h"
 
 /*
@@ -54,15 +57,15 @@ enum event_type {
 };
 
 typedef struct {
-	unsigned time;
-	char id;
+	sim_time_t time;
+	int id;
 	enum event_type type;
 	int burst;
 } event_t;
 
 int Q_event_cmp_srt(const void* lhs, const void* rhs) {
 	const event_t *lhe = lhs, *rhe = rhs;
-	int d_time = lhe->time - rhe->time;
+	int d_time = SIM_TIME_CMP(lhe->time, rhe->time);
 	int d_type = (int) lhe->type - (int) rhe->type;
 	int d_id = lhe->id - rhe->id;
 
@@ -70,12 +73,14 @@ int Q_event_cmp_srt(const void* lhs, const void* rhs) {
 }
 
 typedef struct {
-	char id;
+	int id;
 	unsigned tau;
+	pred_t pred; // Predictor state behind tau.
 	int burst;
 	int spent;
-	unsigned t_join;
-	unsigned p_join;
+	sim_time_t t_join;
+	sim_time_t p_join;
+	long wait_obs;
 } ready_t;
 
 int Q_ready_cmp_srt(const void* lhs, const void* rhs) {
@@ -85,59 +90,54 @@ int Q_ready_cmp_srt(const void* lhs, const void* rhs) {
 }
 
 
-void print_ready_queue_srt(queue_t* q) {
+void print_ready_queue_srt(FILE* out, const void* q, int n) {
 	queue_t* q2 = make_queue();
 	queue_copy(q2, q);
-	printf("[Q");
+	fprintf(out, "[Q");
 	if (queue_peek(q2) == NULL) {
-		printf(" <empty>");
+		fprintf(out, " <empty>");
 	} else {
 		for (ready_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
-			printf(" %c", g->id);
+			fprintf(out, " %c", g->id);
 		}
 	}
-	printf("]");
+	fprintf(out, "]");
 	free_queue(&q2);
 }
 
-void print_event_queue_srt(queue_t* q) {
+void print_event_queue_srt(FILE* out, queue_t* q) {
 	queue_t* q2 = make_queue();
 	queue_copy(q2, q);
-	printf("[Q");
+	fprintf(out, "[Q");
 	if (queue_peek(q2) == NULL) {
-		printf(" <empty>");
+		fprintf(out, " <empty>");
 	} else {
 		for (event_t* g = queue_pop(q2); g; g = queue_pop(q2)) {
-			printf(" %c, %d", g->id, g->type);
+			fprintf(out, " %c, %d", g->id, g->type);
 		}
 	}
-	printf("]");
+	fprintf(out, "]");
 	free_queue(&q2);
 }
 
-#ifdef DEBUG_MODE
-#define DALWAYS_PRINT 1
-#else
-#define DALWAYS_PRINT 0
-#endif
-
+#define print_event(t, always_print, kind, id, arg, str, Q) \
+	do { \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_srt, Q, 0, str); \
+	} while (0)
 
-#define print_event(t, always_print, str, Q) \
+#define printf_event(t, always_print, kind, id, arg, fmt, Q, ...) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " str " ", t); \
-			print_ready_queue_srt(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) \
+			obs_emitf(args->obs, kind, t, id, arg, always_print, \
+			          print_ready_queue_srt, Q, 0, fmt, __VA_ARGS__); \
 	} while (0)
 
-#define printf_event(t, always_print, fmt, Q, ...) \
+// An event the per-event output does not describe.
+#define observe_event(t, kind, id, arg) \
 	do { \
-		if (DALWAYS_PRINT || always_print || t < 10000) { \
-			printf("time %ums: " fmt " ", t, __VA_ARGS__); \
-			print_ready_queue_srt(Q); \
-			printf("\n"); \
-		} \
+		if (obs_wants(args->obs, kind)) obs_emit(args->obs, kind, t, id, arg); \
 	} while (0)
 
 void add_stat_srt(sim_stat_t* sum, sim_stat_t* ct, double val, int cpu_bound) {
@@ -159,19 +159,173 @@ void add_stat_preemt(algo_stat_t *srt_stats,int cpu_bound) {
 	}
 }
 
-algo_stat_t algo_srt(const args_t* args, process_t* procs) {
+enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS };
+
+/**
+ * Write or read the state of an SRT run between two events: the state every
+ * engine shares, then, unless restoring another engine's checkpoint, SRT's.
+ * The burst on the CPU, currburst, is written by value and its completion
+ * event, currstop, found again among the events.
+ */
+static void ckpt_state_srt(ckpt_t* ck, process_t** procs, ckpt_proc_t** where,
+                           ready_t*** guesses, int* n_slots, queue_t* Q_event,
+                           queue_t* Q_ready, open_sys_t* os, predict_t* pr,
+                           conv_t* cv, algo_stat_t* stats, algo_stat_t* counts,
+                           sim_time_t* t, sim_time_t* t_begin,
+                           enum cpu_mode* cpu_mode, event_t* currburst,
+                           event_t** currstop) {
+	ckpt_common(ck, t, os, procs, where);
+	if (ck->error) return;
+	if (os->slots > *n_slots) {
+		*guesses = (ready_t**) open_sys_grow_state(os, (void**) *guesses,
+		                                           *n_slots, sizeof(ready_t));
+		*n_slots = os->slots;
+	}
+	if (ck->restoring && !ck->same) return;
+	ckpt_data(ck, t_begin, sizeof(*t_begin));
+	ckpt_data(ck, cpu_mode, sizeof(*cpu_mode));
+	ckpt_data(ck, stats, sizeof(*stats));
+	ckpt_data(ck, counts, sizeof(*counts));
+	ckpt_data(ck, pr->class_sum, sizeof(pr->class_sum));
+	ckpt_data(ck, pr->class_n, sizeof(pr->class_n));
+	for (int i = 0; i < *n_slots; ++i)
+		ckpt_data(ck, (*guesses)[i], sizeof(ready_t));
+	ckpt_items(ck, Q_event, sizeof(event_t));
+	ckpt_refs(ck, Q_ready, (void**) *guesses, *n_slots);
+	ckpt_conv(ck, cv);
+	ckpt_data(ck, currburst, sizeof(*currburst));
+	if (!ck->restoring || ck->error || currburst->id == '#') return;
+
+	queue_t* q = make_queue();
+	queue_copy(q, Q_event);
+	for (event_t* e = queue_pop(q); e; e = queue_pop(q)) {
+		if (e->type == EV_PROC_CPU_STOP && e->id == currburst->id)
+			*currstop = e;
+	}
+	free_queue(&q);
+}
+
+/**
+ * Where each process of an SRT run stands at time t, for ckpt_common(). The
+ * oracle's taus are no predictions.
+ */
+static ckpt_proc_t* where_srt(process_t* procs, ready_t** guesses,
+                              int n_slots, queue_t* Q_event, queue_t* Q_ready,
+                              sim_time_t t, int oracle) {
+	ckpt_proc_t* where = calloc(n_slots, sizeof(ckpt_proc_t));
+	queue_t* q = make_queue();
+	queue_copy(q, Q_event);
+	for (event_t* e = queue_pop(q); e; e = queue_pop(q)) {
+		// Switching out, the process is already ready or doing I/O.
+		if (e->type == EV_PROC_CPU_CS) continue;
+		ckpt_proc_t* w = &where[e->id - 'A'];
+		switch (e->type) {
+		case EV_PROC_ARRIVAL:
+			*w = (ckpt_proc_t){.where = CKPT_ARRIVING, .t = e->time};
+			continue;
+		case EV_PROC_IO_STOP:
+			*w = (ckpt_proc_t){
+			    .where = CKPT_IO, .burst = e->burst, .t = e->time};
+			break;
+		default:
+			// Preemptions take what has run off the burst.
+			*w = (ckpt_proc_t){
+			    .where = CKPT_READY,
+			    .burst = e->burst,
+			    .left = e->type == EV_PROC_CPU_STOP
+			                ? (int) (e->time - t)
+			                : procs[e->id - 'A'].cpu_bursts[e->burst],
+			    .t = guesses[e->id - 'A']->t_join};
+			break;
+		}
+		if (!oracle) {
+			w->tau = guesses[e->id - 'A']->tau;
+			w->pred = guesses[e->id - 'A']->pred;
+		}
+	}
+	queue_copy(q, Q_ready);
+	for (ready_t* r = queue_pop(q); r; r = queue_pop(q)) {
+		where[r->id - 'A'] =
+		    (ckpt_proc_t){.where = CKPT_READY,
+		                  .burst = r->burst,
+		                  .left = procs[r->id - 'A'].cpu_bursts[r->burst],
+		                  .t = r->t_join,
+		                  .tau = oracle ? 0 : r->tau,
+		                  .pred = r->pred};
+	}
+	free_queue(&q);
+	return where;
+}
+
+/**
+ * Continue at time t the run of another engine, whose processes stand as in
+ * where, starting with a free CPU. Processes it made no predictions for
+ * start over as new ones.
+ */
+static void adopt_srt(process_t* procs, const ckpt_proc_t* where,
+                      ready_t** guesses, int n_slots, queue_t* Q_event,
+                      queue_t* Q_ready, predict_t* pr, sim_time_t t,
+                      int oracle) {
+	// In place of the arrivals of a fresh run.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
+	for (int i = 0; i < n_slots; ++i) {
+		const ckpt_proc_t* w = &where[i];
+		if (w->where == CKPT_GONE) continue;
+		*guesses[i] = (ready_t){.id = procs[i].id,
+		                        .tau = w->tau,
+		                        .pred = w->pred,
+		                        .burst = w->burst};
+		if (w->where == CKPT_READY) procs[i].cpu_bursts[w->burst] = w->left;
+		if (w->where != CKPT_ARRIVING && (oracle || w->tau == 0)) {
+			int next = w->burst + (w->where == CKPT_IO);
+			guesses[i]->tau = oracle ? (unsigned) procs[i].cpu_bursts[next]
+			                         : predict_first(pr, &guesses[i]->pred,
+			                                         procs[i].cpu_bound);
+		}
+		if (w->where == CKPT_READY) {
+			guesses[i]->t_join = w->t;
+			guesses[i]->p_join = t;
+			queue_push(Q_ready, guesses[i]);
+			continue;
+		}
+		event_t* e = malloc(sizeof(event_t));
+		*e = (event_t){.time = w->t,
+		               .id = procs[i].id,
+		               .type = w->where == CKPT_IO ? EV_PROC_IO_STOP
+		                                           : EV_PROC_ARRIVAL,
+		               .burst = w->burst};
+		queue_push(Q_event, e);
+	}
+	event_t* e_out = malloc(sizeof(event_t));
+	*e_out = (event_t){.time = t, .id = '#', .type = EV_PROC_CPU_CS};
+	queue_push(Q_event, e_out);
+}
+
+/**
+ * SRT ordered by predicted bursts or, for the oracle, by the true bursts.
+ */
+algo_stat_t run_srt(const args_t* args, process_t* procs, int oracle) {
+	const char* name = oracle ? "SRT-ORACLE" : "SRT";
 	algo_stat_t srt_stats = {0}, srt_counts = {0};
 
 	queue_t *Q_event = make_queue(), *Q_ready = make_queue();
 	queue_set_cmp(Q_event, Q_event_cmp_srt);
 	queue_set_cmp(Q_ready, Q_ready_cmp_srt);
 
-	ready_t* guesses = calloc(args->n, sizeof(ready_t));
+	open_sys_t os;
+	open_sys_init(&os, args);
+	io_sys_t io;
+	io_sys_init(&io, args);
+	predict_t pr;
+	predict_init(&pr, args);
+	conv_t cv;
+	conv_init(&cv, args, procs);
 
-	for (int i = 0; i < args->n; ++i) {
-		for (int j = 0; j < procs[i].cpu_burst_ct; ++j){
-			add_stat_srt(&srt_stats.t_burst, &srt_counts.t_burst, procs[i].cpu_bursts[j], procs[i].cpu_bound);
-		}
+	ready_t** guesses =
+	    (ready_t**) open_sys_grow_state(&os, NULL, 0, sizeof(ready_t));
+	int n_slots = os.slots;
+
+	for (int i = 0; !os.enabled && i < args->n; ++i) {
 		event_t* e = malloc(sizeof(event_t));
 		*e = (event_t){.time = procs[i].arrival_time,
 		               .id = procs[i].id,
@@ -180,18 +334,19 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 
 		queue_push(Q_event, e);
 
-		guesses[i].id = procs[i].id;
-		guesses[i].tau = ceil(1 / args->lambda);
-		guesses[i].burst = 0;
-		guesses[i].spent = 0;
+		guesses[i]->id = procs[i].id;
+		guesses[i]->tau = ceil(1 / args->lambda);
+		guesses[i]->burst = 0;
+		guesses[i]->spent = 0;
 	}
 
 	// Exponential averaging: tau_n+1=alpha(b_n+tau_n) where b are burst times.
 
-	unsigned int t = 0;
-	print_event(t, 1, "Simulator started for SRT", Q_ready);
+	sim_time_t t = 0;
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator started for %s", Q_ready,
+	             name);
 
-	enum cpu_mode { CM_IDLE = 0, CM_BURST, CM_CS } cpu_mode = CM_IDLE;
+	enum cpu_mode cpu_mode = CM_IDLE;
 
 	// FIXME: track measurements.
 	event_t* currburst = malloc(sizeof(event_t));
@@ -199,27 +354,104 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 	currburst->id = '#';
 
 
+	sim_time_t t_begin = 0;
+	// Checkpoint first at the end of the warm-up, which later runs can
+	// continue from, then every args->checkpoint_every ms.
+	sim_time_t t_ckpt = args->warmup ? args->warmup : args->checkpoint_every;
 	int srt_error = 0;
-	while (srt_error == 0 && queue_peek(Q_event)) {
+	if (args->restore) {
+		ckpt_t ck;
+		ckpt_proc_t* where = NULL;
+		if (ckpt_restore(&ck, args->restore, name, args) != 0) {
+			srt_error = 1;
+		} else {
+			ckpt_state_srt(&ck, &procs, &where, &guesses, &n_slots, Q_event,
+			               Q_ready, &os, &pr, &cv, &srt_stats, &srt_counts, &t,
+			               &t_begin, &cpu_mode, currburst, &currstop);
+			srt_error = ckpt_close(&ck) != 0;
+		}
+		if (srt_error == 0 && !ck.same) {
+			// Another policy's run is measured from here on.
+			adopt_srt(procs, where, guesses, n_slots, Q_event, Q_ready, &pr, t,
+			          oracle);
+			t_begin = t;
+		}
+		free(where);
+		if (srt_error == 0)
+			printf_event(t, 1, OBS_OTHER, 0, 0,
+			             "Simulator restored for %s from %s",
+			             Q_ready, name, args->restore);
+		t_ckpt = args->checkpoint_every ? (t / args->checkpoint_every + 1) *
+		                                      args->checkpoint_every
+		                                : SIM_TIME_MAX;
+	}
+	while (srt_error == 0 && (queue_peek(Q_event) || open_sys_pending(&os))) {
+		// Admit open-system arrivals due by the next event.
+		for (event_t* h = queue_peek(Q_event);; h = queue_peek(Q_event)) {
+			int i = open_sys_admit(&os, h ? h->time : SIM_TIME_MAX);
+			if (i < 0) break;
+			procs = os.procs;
+			if (os.slots > n_slots) {
+				guesses = (ready_t**) open_sys_grow_state(
+				    &os, (void**) guesses, n_slots, sizeof(ready_t));
+				n_slots = os.slots;
+			}
+			*guesses[i] = (ready_t){.id = procs[i].id, .tau = ceil(1 / args->lambda)};
+			event_t* e = malloc(sizeof(event_t));
+			*e = (event_t){.time = procs[i].arrival_time,
+			               .id = procs[i].id,
+			               .type = EV_PROC_ARRIVAL,
+			               .burst = 0};
+			queue_push(Q_event, e);
+		}
+		if (queue_peek(Q_event) == NULL || conv_done(&cv)) break;
+
+		sim_time_t t_next = ((event_t*) queue_peek(Q_event))->time;
+		if (args->checkpoint && t_next >= t_ckpt && ckpt_wanted(args, name)) {
+			ckpt_t ck;
+			if (ckpt_save(&ck, args->checkpoint, name, args) == 0) {
+				ckpt_proc_t* where = where_srt(procs, guesses, n_slots, Q_event,
+				                               Q_ready, t, oracle);
+				ckpt_state_srt(&ck, &procs, &where, &guesses, &n_slots,
+				               Q_event, Q_ready, &os, &pr, &cv, &srt_stats,
+				               &srt_counts, &t, &t_begin, &cpu_mode, currburst,
+				               &currstop);
+				free(where);
+				ckpt_close(&ck);
+			}
+			t_ckpt = args->checkpoint_every
+			             ? (t_next / args->checkpoint_every + 1) *
+			                   args->checkpoint_every
+			             : SIM_TIME_MAX;
+		}
+
 		event_t* e = queue_pop(Q_event);
 
 
 		t = e->time;
+		stat_warmup(&srt_stats, &srt_counts, args->warmup, t, &t_begin);
 
 		switch (e->type) {
 		case EV_PROC_CPU_STOP: {
 
-			add_stat_srt(&srt_stats.t_turn, &srt_counts.t_turn, t + args->Tcs / 2 - guesses[e->id - 'A'].t_join, procs[e->id - 'A'].cpu_bound);
-			char idd = e->id;
+			double t_turn = t + args->Tcs / 2 - guesses[e->id - 'A']->t_join;
+			add_stat_srt(&srt_stats.t_turn, &srt_counts.t_turn, t_turn, procs[e->id - 'A'].cpu_bound);
+			conv_add(&cv, CONV_TURN, t_turn, CONV_NEW);
+			int idd = e->id;
 			int bursts_left = procs[e->id - 'A'].cpu_burst_ct - 1 - e->burst;
 			if (bursts_left == 0) {
-				printf_event(t, 1, "Process %c terminated", Q_ready, e->id);
+				printf_event(t, 1, OBS_TERMINATE, e->id, 0,
+				             "Process %c terminated",
+				             Q_ready, e->id);
+				open_sys_retire(&os, e->id - 'A');
+				currburst->id = '#';
 				free(e);
 
 			} else {
-				unsigned tau_n = guesses[e->id - 'A'].tau;
+				unsigned tau_n = guesses[e->id - 'A']->tau;
 				unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
-				printf_event(t, 0,
+				unsigned b_next = procs[e->id - 'A'].cpu_bursts[e->burst + 1];
+				printf_event(t, 0, OBS_STOP, e->id, bursts_left,
 				             "Process %c (tau %ums) completed a CPU burst; %d "
 				             "burst%s to go",
 				             Q_ready, e->id, tau_n, bursts_left,
@@ -227,24 +459,34 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 
 
 
-				guesses[e->id - 'A'].tau = exp_avg_tau(args->alpha, (burst_len + guesses[e->id - 'A'].spent), tau_n);
+				guesses[e->id - 'A']->tau =
+				    oracle ? b_next
+				           : predict_update(&pr, &guesses[e->id - 'A']->pred, tau_n,
+				                            burst_len + guesses[e->id - 'A']->spent,
+				                            procs[e->id - 'A'].cpu_bound,
+				                            &srt_stats.pred);
 
-				printf_event(t, 0,
+				printf_event(t, 0, OBS_TAU, e->id, guesses[e->id - 'A']->tau,
 				             "Recalculating tau for process %c: old tau %ums"
 				             " ==> new tau %ums",
-				             Q_ready, e->id, tau_n, guesses[e->id - 'A'].tau);
+				             Q_ready, e->id, tau_n, guesses[e->id - 'A']->tau);
 
-				// Requeue IO burst completion.
-				e->time = t + (args->Tcs / 2 + procs[e->id - 'A'].io_bursts[e->burst]);
+				// Requeue IO burst completion once its device takes it.
 				e->type = EV_PROC_IO_STOP;
-				queue_push(Q_event, e);
-
-				printf_event(t, 0,
-				             "Process %c switching out of CPU; blocking on I/O"
-				             " until time %ums",
-				             Q_ready, e->id, e->time);
+				if (io_sys_submit(&io, procs[e->id - 'A'].io_dev, e, t + args->Tcs / 2,
+				                  procs[e->id - 'A'].io_bursts[e->burst], &e->time)) {
+					queue_push(Q_event, e);
+					printf_event(t, 0, OBS_IO_START, e->id, e->time,
+					             "Process %c switching out of CPU; blocking on I/O"
+					             " until time %llums",
+					             Q_ready, e->id, e->time);
+				} else {
+					printf_event(t, 0, OBS_IO_START, e->id, -1,
+					             "Process %c switching out of CPU; waiting for I/O device %d",
+					             Q_ready, e->id, procs[e->id - 'A'].io_dev);
+				}
 				currburst->id = '#';
-				guesses[e->id - 'A'].spent = 0;
+				guesses[e->id - 'A']->spent = 0;
 			}
 			
 			// Simulate context switch.
@@ -264,29 +506,31 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 			if (cpu_mode != CM_BURST) {
 				unsigned burst_len = procs[e->id - 'A'].cpu_bursts[e->burst];
 
-				if (guesses[e->id - 'A'].spent != 0) {
-					printf_event(t, 0,
+				if (guesses[e->id - 'A']->spent != 0) {
+					printf_event(t, 0, OBS_START, e->id, burst_len,
 					             "Process %c (tau %ums) started using the "
 					             "CPU "
 					             "for remaining %ums of %ums burst",
-					             Q_ready, e->id, guesses[e->id - 'A'].tau, burst_len,
-					             burst_len + guesses[e->id - 'A'].spent);
+					             Q_ready, e->id, guesses[e->id - 'A']->tau, burst_len,
+					             burst_len + guesses[e->id - 'A']->spent);
 				} else {
 
-					printf_event(t, 0,
+					printf_event(t, 0, OBS_START, e->id, burst_len,
 					             "Process %c (tau %ums) started "
 					             "using the CPU "
 					             "for %ums burst",
-					             Q_ready, e->id, guesses[e->id - 'A'].tau, burst_len);
+					             Q_ready, e->id, guesses[e->id - 'A']->tau, burst_len);
 				}
 
 				if (queue_peek(Q_ready) != NULL) {
 					ready_t* r = queue_peek(Q_ready);
-					int left = guesses[e->id - 'A'].tau - guesses[e->id - 'A'].spent;
-					int tau = (guesses[r->id - 'A'].tau - guesses[r->id - 'A'].spent);
+					int left = guesses[e->id - 'A']->tau - guesses[e->id - 'A']->spent;
+					int tau = (guesses[r->id - 'A']->tau - guesses[r->id - 'A']->spent);
 					if (left > tau) {
-						printf_event(t, 0, "Process %c (tau %ums) will preempt %c", Q_ready,
-						             r->id, guesses[r->id - 'A'].tau, e->id);
+						printf_event(t, 0, OBS_PREEMPT, e->id, burst_len,
+						             "Process %c (tau %ums) will preempt %c",
+						             Q_ready, r->id, guesses[r->id - 'A']->tau,
+						             e->id);
 					
 					
 					cpu_mode = CM_CS;
@@ -322,28 +566,44 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 			break;
 		}
 		case EV_PROC_IO_STOP: {
+			// Its device can start the next waiting request.
+			sim_time_t t_io;
+			event_t* e_io =
+			    io_sys_complete(&io, procs[e->id - 'A'].io_dev, e, t, &t_io);
+			if (e_io) {
+				e_io->time = t_io;
+				queue_push(Q_event, e_io);
+			}
+
+			// Bursts are counted once, when they first become ready.
+			add_stat_srt(&srt_stats.t_burst, &srt_counts.t_burst,
+			             procs[e->id - 'A'].cpu_bursts[e->burst + 1],
+			             procs[e->id - 'A'].cpu_bound);
 
-			guesses[e->id - 'A'].burst = e->burst + 1;
-			guesses[e->id - 'A'].p_join=t;
-			guesses[e->id - 'A'].t_join = t;
+			guesses[e->id - 'A']->burst = e->burst + 1;
+			guesses[e->id - 'A']->p_join=t;
+			guesses[e->id - 'A']->t_join = t;
 			if (currburst->id != '#') {
-				int left = (guesses[currburst->id - 'A'].tau - (t - currburst->time) -
-				            guesses[currburst->id - 'A'].spent);
-				int tau = guesses[e->id - 'A'].tau; // TODO: may need add - spent
+				int left = (guesses[currburst->id - 'A']->tau - (t - currburst->time) -
+				            guesses[currburst->id - 'A']->spent);
+				int tau = guesses[e->id - 'A']->tau; // TODO: may need add - spent
 
 				if (left > tau) { // if the current burst has less estimated tie
 
 					e->time = t;
 				
-					queue_push(Q_ready, &guesses[e->id - 'A']);
+					queue_push(Q_ready, guesses[e->id - 'A']);
 
-					printf_event(t, 0,
+					printf_event(t, 0, OBS_IO_DONE, e->id, 0,
 					             "Process %c (tau %ums) completed I/O; preempting %c",
-					             Q_ready, e->id, guesses[e->id - 'A'].tau, currburst->id);
+					             Q_ready, e->id, guesses[e->id - 'A']->tau, currburst->id);
 
-					guesses[currburst->id - 'A'].spent += e->time - currburst->time;
+					guesses[currburst->id - 'A']->spent += e->time - currburst->time;
 					procs[currburst->id - 'A'].cpu_bursts[currburst->burst] -=
 					    e->time - currburst->time;
+					observe_event(
+					    t, OBS_PREEMPT, currburst->id,
+					    procs[currburst->id - 'A'].cpu_bursts[currburst->burst]);
 
 
 
@@ -370,36 +630,50 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 			}
 			// if the new arrival has less estimated time
 		
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0,
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_IO_DONE, e->id, 0,
 			             "Process %c (tau %ums) completed I/O; "
 			             "added to ready queue",
-			             Q_ready, e->id, guesses[e->id - 'A'].tau);
+			             Q_ready, e->id, guesses[e->id - 'A']->tau);
 
 
 			free(e);
 			break;
 		}
 		case EV_PROC_ARRIVAL: {
+			add_stat_srt(&srt_stats.t_burst, &srt_counts.t_burst,
+			             procs[e->id - 'A'].cpu_bursts[0],
+			             procs[e->id - 'A'].cpu_bound);
+
 			// Add to ready queue.
-			guesses[e->id - 'A'].burst = 0;
-			guesses[e->id - 'A'].t_join = t;
-			guesses[e->id - 'A'].p_join = t;
+			guesses[e->id - 'A']->tau =
+			    oracle ? (unsigned) procs[e->id - 'A'].cpu_bursts[0]
+			           : predict_first(&pr, &guesses[e->id - 'A']->pred,
+			                           procs[e->id - 'A'].cpu_bound);
+			guesses[e->id - 'A']->burst = 0;
+			guesses[e->id - 'A']->t_join = t;
+			guesses[e->id - 'A']->p_join = t;
 			if (currburst->id != '#') {
-				int left = (guesses[currburst->id - 'A'].tau - (t - currburst->time) -
-				            guesses[currburst->id - 'A'].spent);
-				int tau = guesses[e->id - 'A'].tau; // TODO: may need add - spent
+				int left = (guesses[currburst->id - 'A']->tau - (t - currburst->time) -
+				            guesses[currburst->id - 'A']->spent);
+				int tau = guesses[e->id - 'A']->tau; // TODO: may need add - spent
 				if (left > tau) { // if the current burst has less estimated time
 
 					e->time = t;
 
 				   
-					queue_push(Q_ready, &guesses[e->id - 'A']);
+					queue_push(Q_ready, guesses[e->id - 'A']);
+					observe_event(t, OBS_ARRIVAL, e->id,
+					              procs[e->id - 'A'].cpu_bound);
+					observe_event(t, OBS_TAU, e->id, guesses[e->id - 'A']->tau);
 
 
 					procs[currburst->id - 'A'].cpu_bursts[currburst->burst] -=
 					    e->time - currburst->time;
-					guesses[currburst->id - 'A'].spent = e->time - currburst->time;
+					observe_event(
+					    t, OBS_PREEMPT, currburst->id,
+					    procs[currburst->id - 'A'].cpu_bursts[currburst->burst]);
+					guesses[currburst->id - 'A']->spent = e->time - currburst->time;
 
 
 
@@ -415,7 +689,8 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 
 					size_t place = queue_search(Q_event, currstop);
 					if (place != (size_t) -1) {
-						queue_delete(Q_event, queue_search(Q_event, currstop));
+						queue_delete(Q_event, place);
+						free(currstop);
 					}
 
 
@@ -425,9 +700,11 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 			}
 			// if the new arrival has less estimated time
 			
-			queue_push(Q_ready, &guesses[e->id - 'A']);
-			printf_event(t, 0, "Process %c (tau %ums) arrived; added to ready queue",
-			             Q_ready, e->id, guesses[e->id - 'A'].tau);
+			queue_push(Q_ready, guesses[e->id - 'A']);
+			printf_event(t, 0, OBS_ARRIVAL, e->id, procs[e->id - 'A'].cpu_bound,
+			             "Process %c (tau %ums) arrived; added to ready queue",
+			             Q_ready, e->id, guesses[e->id - 'A']->tau);
+			observe_event(t, OBS_TAU, e->id, guesses[e->id - 'A']->tau);
 
 			free(e);
 
@@ -435,8 +712,8 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 		}
 		case EV_PROC_CPU_PREEMPTION: {
 
-			guesses[e->id - 'A'].p_join=t;
-			queue_push(Q_ready, &guesses[e->id - 'A']);
+			guesses[e->id - 'A']->p_join=t;
+			queue_push(Q_ready, guesses[e->id - 'A']);
 			
 			add_stat_preemt(&srt_stats, procs[e->id - 'A'].cpu_bound);
 			cpu_mode = CM_CS;
@@ -447,6 +724,12 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 		}
 		case EV_PROC_CPU_CS: {
 
+			// Without a process it frees the CPU of a restored run.
+			if (e->id == '#') {
+				cpu_mode = CM_IDLE;
+				free(e);
+				break;
+			}
 			if (procs[e->id - 'A'].cpu_bound) {
 					srt_stats.cs_cpu += 1;
 			} else {
@@ -479,21 +762,43 @@ algo_stat_t algo_srt(const args_t* args, process_t* procs) {
 				cpu_mode = CM_CS;
 				
 				stat_avg_add(&srt_stats.t_wait, &srt_counts.t_wait,t - r->p_join, procs[r->id - 'A'].cpu_bound);
+				r->wait_obs = conv_add(&cv, CONV_WAIT, t - r->p_join,
+				                       r->spent ? r->wait_obs : CONV_NEW);
 				
 			}
 		}
 	}
 
-	print_event(t, 1, "Simulator ended for SRT", Q_ready);
+	printf_event(t, 1, OBS_OTHER, 0, 0, "Simulator ended for %s", Q_ready,
+	             name);
+
+	// Events left behind by an early stop.
+	for (event_t* e = queue_pop(Q_event); e; e = queue_pop(Q_event)) free(e);
 
 	free_queue(&Q_ready);
 	free_queue(&Q_event);
-	free(guesses);
+	open_sys_free_state((void**) guesses, n_slots);
 	free(currburst);
 	srt_counts.t_wait.avg = srt_counts.t_burst.avg;
 	srt_counts.t_wait.cpu_avg = srt_counts.t_burst.cpu_avg;
 	srt_counts.t_wait.io_avg = srt_counts.t_burst.io_avg;
-stat_calc_final(&srt_stats, &srt_counts, t);
-
+	stat_calc_final(&srt_stats, &srt_counts, t - t_begin);
+	srt_stats.arrived = os.arrived;
+	srt_stats.live_max = os.live_max;
+	open_sys_free(&os);
+	io_sys_finish(&io, t, t_begin, &srt_stats.io);
+	io_sys_free(&io);
+	if (!oracle) predict_finish(&pr, &srt_stats.pred);
+	conv_finish(&cv, t, &srt_stats.conv);
+
+	srt_stats.error = srt_error;
 	return srt_stats;
 }
+
+algo_stat_t algo_srt(const args_t* args, process_t* procs) {
+	return run_srt(args, procs, 0);
+}
+
+algo_stat_t algo_srt_oracle(const args_t* args, process_t* procs) {
+	return run_srt(args, procs, 1);
+}
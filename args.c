@@ -1,28 +1,86 @@
 #include "args.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-args_t* parse_args(int argc, char* argv[]) {
-	args_t* args = calloc(1, sizeof(args_t));
+/**
+ * Match argument arg against option "--name=value".
+ * @return The value string, or NULL if arg is not this option.
+ */
+static const char* match_opt(const char* arg, const char* name) {
+	size_t len = strlen(name);
+	if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, len) != 0 ||
+	    arg[2 + len] != '=')
+		return NULL;
+	return arg + 3 + len;
+}
 
-	if (argc != 9) { // All input is required, I didn't see any labeled "optional"
-		fprintf(stderr, "ERROR: Number of arguments must be 8\n");
-		exit(1);
+/**
+ * @return Whether arg is the value-less option "--name".
+ */
+static int match_flag(const char* arg, const char* name) {
+	return strncmp(arg, "--", 2) == 0 && strcmp(arg + 2, name) == 0;
+}
+
+/**
+ * Parse value, a comma-separated list of up to n numbers, into out. Later
+ * entries left out repeat the last one given.
+ * @return The number of entries given, or -1 if value is malformed.
+ */
+static int parse_list(const char* value, double* out, int n) {
+	int k = 0;
+	for (const char* s = value; k < n; ++k) {
+		char* end;
+		out[k] = strtod(s, &end);
+		if (end == s || (*end != ',' && *end != '\0')) return -1;
+		if (*end == '\0') {
+			++k;
+			break;
+		}
+		s = end + 1;
+	}
+	for (int i = k; i < n; ++i) out[i] = out[k - 1];
+	return k;
+}
+
+/**
+ * Report why the options are invalid in err, of size err_len, and fail.
+ */
+#define ARG_ERROR(...) \
+	do { \
+		snprintf(err, err_len, __VA_ARGS__); \
+		return -1; \
+	} while (0)
+
+void args_init(args_t* args) {
+	memset(args, 0, sizeof(*args));
+	args->pred_k = 1.0;
+	args->out = stdout;
+#ifdef DEBUG_MODE
+	args->print_window = SIM_TIME_MAX;
+#else
+	args->print_window = 10000;
+#endif
+}
+
+int parse_args_r(args_t* args, int argc, char* argv[], char* err,
+                 size_t err_len) {
+	args_init(args);
+
+	if (argc < 9) { // The first 8 arguments are required.
+		ARG_ERROR("Number of arguments must be at least 8");
 	}
 
 	if (atoi(argv[1]) > 26 || atoi(argv[1]) < 1) {
-		fprintf(stderr,
-		        "ERROR: Number of Processes must be at most 26 and at least 1\n");
-		exit(1);
+		ARG_ERROR("Number of Processes must be at most 26 and at least 1");
 	} else {
 		args->n = atoi(argv[1]);
 	}
 
 	if (atoi(argv[2]) < 0 || atoi(argv[2]) > args->n) {
-		fprintf(stderr,
-		        "ERROR: Number of CPU-bound Processes must be positive and less "
-		        "then or equal to number of processes\n");
-		exit(1);
+		ARG_ERROR("Number of CPU-bound Processes must be positive and less "
+		          "then or equal to number of processes");
 	} else {
 		args->n_cpu = atoi(argv[2]);
 	}
@@ -32,24 +90,410 @@ args_t* parse_args(int argc, char* argv[]) {
 	args->exp_max = atol(argv[5]); // no restricitons
 
 	if (atoi(argv[6]) < 0 || atoi(argv[6]) % 2 != 0) {
-		fprintf(stderr,
-		        "ERROR: Context Switch Time must be a positive even number\n");
-		exit(1);
+		ARG_ERROR("Context Switch Time must be a positive even number");
 	} else {
 		args->Tcs = atoi(argv[6]);
 	}
 
 	if (atof(argv[7]) < 0) {
-		fprintf(stderr, "ERROR: Alpha must be positive\n");
-		exit(1);
+		ARG_ERROR("Alpha must be positive");
 	} else {
 		args->alpha = atof(argv[7]);
 	}
 	if (atoi(argv[8]) < 0) {
-		fprintf(stderr, "ERROR: Time Slice must be positive\n");
-		exit(1);
+		ARG_ERROR("Time Slice must be positive");
 	} else {
 		args->Tslice = atol(argv[8]);
 	}
+
+	for (int i = 9; i < argc; ++i) {
+		const char* val;
+		if ((val = match_opt(argv[i], "open"))) {
+			args->open_rate = atof(val);
+			if (args->open_rate <= 0) {
+				ARG_ERROR("Open-system arrival rate must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "horizon"))) {
+			args->horizon = strtoull(val, NULL, 10);
+		} else if ((val = match_opt(argv[i], "warmup"))) {
+			args->warmup = strtoull(val, NULL, 10);
+		} else if ((val = match_opt(argv[i], "converge"))) {
+			args->converge = atof(val);
+			if (args->converge <= 0) {
+				ARG_ERROR("Convergence target must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "reps"))) {
+			args->reps = atoi(val);
+			if (args->reps < 2) {
+				ARG_ERROR("A study needs at least 2 replications");
+			}
+		} else if (match_flag(argv[i], "antithetic")) {
+			args->antithetic = 1;
+		} else if (match_flag(argv[i], "quiet")) {
+			args->quiet = 1;
+		} else if ((val = match_opt(argv[i], "print-window"))) {
+			if (strcmp(val, "all") == 0) {
+				args->print_window = SIM_TIME_MAX;
+			} else {
+				char* end;
+				args->print_window = strtoull(val, &end, 10);
+				if (*val == '\0' || *end != '\0') {
+					ARG_ERROR("Print window must be a time in ms or all");
+				}
+			}
+		} else if (match_flag(argv[i], "estimate")) {
+			args->estimate = 1;
+		} else if (match_flag(argv[i], "estimate-only")) {
+			args->estimate = 2;
+		} else if ((val = match_opt(argv[i], "result-cache"))) {
+			if (*val == '\0') {
+				ARG_ERROR("Result cache needs a directory");
+			}
+			args->result_cache = val;
+		} else if ((val = match_opt(argv[i], "workload-cache"))) {
+			if (*val == '\0') {
+				ARG_ERROR("Workload cache needs a directory");
+			}
+			args->workload_cache = val;
+		} else if ((val = match_opt(argv[i], "checkpoint"))) {
+			if (*val == '\0') {
+				ARG_ERROR("Checkpoint needs a file");
+			}
+			args->checkpoint = val;
+		} else if ((val = match_opt(argv[i], "checkpoint-of"))) {
+			if (strcmp(val, "FCFS") != 0 && strcmp(val, "SJF") != 0 &&
+			    strcmp(val, "SRT") != 0 && strcmp(val, "RR") != 0 &&
+			    strcmp(val, "SJF-ORACLE") != 0 &&
+			    strcmp(val, "SRT-ORACLE") != 0) {
+				ARG_ERROR("Only FCFS, SJF, SRT, RR and the SJF and SRT oracles "
+				          "take checkpoints");
+			}
+			args->checkpoint_of = val;
+		} else if ((val = match_opt(argv[i], "checkpoint-every"))) {
+			args->checkpoint_every = strtoull(val, NULL, 10);
+		} else if ((val = match_opt(argv[i], "restore"))) {
+			if (*val == '\0') {
+				ARG_ERROR("Restore needs a checkpoint file");
+			}
+			args->restore = val;
+		} else if ((val = match_opt(argv[i], "burst-log"))) {
+			if (*val == '\0') ARG_ERROR("Burst log needs a file");
+			args->burst_log = val;
+		} else if ((val = match_opt(argv[i], "serve"))) {
+			if (*val == '\0') ARG_ERROR("Server needs a socket path or -");
+			args->serve = val;
+		} else if ((val = match_opt(argv[i], "workers"))) {
+			args->workers = atoi(val);
+			if (args->workers < 1 || args->workers > 256) {
+				ARG_ERROR("Workers must be between 1 and 256");
+			}
+		} else if ((val = match_opt(argv[i], "result-cache-size"))) {
+			args->result_cache_size = atol(val);
+			if (args->result_cache_size < 1) {
+				ARG_ERROR("Result cache size must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "mlfq-levels"))) {
+			args->mlfq_levels = atoi(val);
+			if (args->mlfq_levels < 1 || args->mlfq_levels > 16) {
+				ARG_ERROR("MLFQ levels must be between 1 and 16");
+			}
+		} else if ((val = match_opt(argv[i], "mlfq-boost"))) {
+			args->mlfq_boost = atol(val);
+			if (args->mlfq_boost == 0) {
+				ARG_ERROR("MLFQ boost period must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "nice-cpu"))) {
+			args->nice_cpu = atoi(val);
+		} else if ((val = match_opt(argv[i], "nice-io"))) {
+			args->nice_io = atoi(val);
+		} else if ((val = match_opt(argv[i], "cfs-latency"))) {
+			args->cfs_latency = atol(val);
+		} else if ((val = match_opt(argv[i], "cfs-min-gran"))) {
+			args->cfs_min_gran = atol(val);
+		} else if ((val = match_opt(argv[i], "tickets-cpu"))) {
+			args->tickets_cpu = atoi(val);
+		} else if ((val = match_opt(argv[i], "tickets-io"))) {
+			args->tickets_io = atoi(val);
+		} else if ((val = match_opt(argv[i], "priorities"))) {
+			args->prio_levels = atoi(val);
+			if (args->prio_levels < 1 || args->prio_levels > 16) {
+				ARG_ERROR("Priority levels must be between 1 and 16");
+			}
+		} else if ((val = match_opt(argv[i], "aging"))) {
+			args->prio_aging = atol(val);
+			if (args->prio_aging == 0) {
+				ARG_ERROR("Aging period must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "groups"))) {
+			args->groups = atoi(val);
+			if (args->groups < 1 || args->groups > GROUP_MAX) {
+				ARG_ERROR("Groups must be between 1 and %d", GROUP_MAX);
+			}
+		} else if ((val = match_opt(argv[i], "group-shares"))) {
+			double v[GROUP_MAX];
+			if (parse_list(val, v, GROUP_MAX) < 0) {
+				ARG_ERROR("Group shares must be a list of numbers");
+			}
+			for (int g = 0; g < GROUP_MAX; ++g) {
+				if (v[g] < 1) {
+					ARG_ERROR("Group shares must be positive");
+				}
+				args->group_shares[g] = v[g];
+			}
+		} else if ((val = match_opt(argv[i], "group-quota"))) {
+			double v[GROUP_MAX];
+			if (parse_list(val, v, GROUP_MAX) < 0) {
+				ARG_ERROR("Group quotas must be a list of numbers");
+			}
+			for (int g = 0; g < GROUP_MAX; ++g) {
+				if (v[g] < 0) {
+					ARG_ERROR("Group quotas must not be negative");
+				}
+				args->group_quota[g] = v[g];
+			}
+		} else if ((val = match_opt(argv[i], "group-period"))) {
+			args->group_period = atol(val);
+			if (args->group_period == 0) {
+				ARG_ERROR("Group period must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "cpus"))) {
+			args->cpus = atoi(val);
+			if (args->cpus < 1 || args->cpus > MCPU_MAX) {
+				ARG_ERROR("CPUs must be between 1 and %d", MCPU_MAX);
+			}
+		} else if ((val = match_opt(argv[i], "cpu-speeds"))) {
+			if (parse_list(val, args->cpu_speed, MCPU_MAX) < 0) {
+				ARG_ERROR("CPU speeds must be a list of numbers");
+			}
+			for (int c = 0; c < MCPU_MAX; ++c) {
+				if (args->cpu_speed[c] <= 0) {
+					ARG_ERROR("CPU speeds must be positive");
+				}
+			}
+		} else if ((val = match_opt(argv[i], "placement"))) {
+			if (strcmp(val, "fastest-idle") == 0) {
+				args->placement = PLACE_FASTEST_IDLE;
+			} else if (strcmp(val, "capacity") == 0) {
+				args->placement = PLACE_CAPACITY;
+			} else if (strcmp(val, "cpu-bound-big") == 0) {
+				args->placement = PLACE_CPU_BOUND_BIG;
+			} else {
+				ARG_ERROR("Placement must be fastest-idle, capacity or "
+				          "cpu-bound-big");
+			}
+		} else if ((val = match_opt(argv[i], "cache-penalty"))) {
+			args->cache_penalty = atol(val);
+		} else if ((val = match_opt(argv[i], "cache-decay"))) {
+			args->cache_decay = atol(val);
+			if (args->cache_decay == 0) {
+				ARG_ERROR("Cache decay must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "cache-evict"))) {
+			args->cache_evict = atof(val);
+			if (args->cache_evict <= 0 || args->cache_evict > 1) {
+				ARG_ERROR("Cache eviction must be in (0, 1]");
+			}
+		} else if ((val = match_opt(argv[i], "balance"))) {
+			if (strcmp(val, "shared") == 0) {
+				args->balance = BAL_SHARED;
+			} else if (strcmp(val, "none") == 0) {
+				args->balance = BAL_NONE;
+			} else if (strcmp(val, "push") == 0) {
+				args->balance = BAL_PUSH;
+			} else if (strcmp(val, "steal") == 0) {
+				args->balance = BAL_STEAL;
+			} else if (strcmp(val, "push-steal") == 0) {
+				args->balance = BAL_PUSH_STEAL;
+			} else {
+				ARG_ERROR("Balance must be shared, none, push, steal or "
+				          "push-steal");
+			}
+		} else if ((val = match_opt(argv[i], "balance-period"))) {
+			args->balance_period = atol(val);
+			if (args->balance_period == 0) {
+				ARG_ERROR("Balance period must be positive");
+			}
+		} else if ((val = match_opt(argv[i], "migrate-cost"))) {
+			args->migrate_cost = atol(val);
+		} else if ((val = match_opt(argv[i], "io-devices"))) {
+			args->io_devices = atoi(val);
+			if (args->io_devices < 1 || args->io_devices > IO_DEV_MAX) {
+				ARG_ERROR("I/O devices must be between 1 and %d", IO_DEV_MAX);
+			}
+		} else if ((val = match_opt(argv[i], "io-units"))) {
+			double v[IO_DEV_MAX];
+			if (parse_list(val, v, IO_DEV_MAX) < 0) {
+				ARG_ERROR("I/O units must be a list of numbers");
+			}
+			for (int d = 0; d < IO_DEV_MAX; ++d) {
+				if (v[d] < 1 || v[d] > IO_UNITS_MAX) {
+					ARG_ERROR("I/O units must be between 1 and %d",
+					          IO_UNITS_MAX);
+				}
+				args->io_units[d] = v[d];
+			}
+		} else if ((val = match_opt(argv[i], "io-discipline"))) {
+			int k = 0;
+			for (const char* s = val; k < IO_DEV_MAX; ++k) {
+				size_t len = strcspn(s, ",");
+				if (len == 4 && strncmp(s, "fifo", len) == 0) {
+					args->io_discipline[k] = IO_FIFO;
+				} else if (len == 8 && strncmp(s, "shortest", len) == 0) {
+					args->io_discipline[k] = IO_SHORTEST;
+				} else {
+					ARG_ERROR("I/O discipline must be a list of fifo or "
+					          "shortest");
+				}
+				if (s[len] == '\0') {
+					++k;
+					break;
+				}
+				s += len + 1;
+			}
+			for (int d = k; d < IO_DEV_MAX; ++d)
+				args->io_discipline[d] = args->io_discipline[k - 1];
+		} else if ((val = match_opt(argv[i], "predictor"))) {
+			if (strcmp(val, "exp") == 0) {
+				args->predictor = PRED_EXP;
+			} else if (strcmp(val, "adaptive") == 0) {
+				args->predictor = PRED_ADAPTIVE;
+			} else if (strcmp(val, "ewma-var") == 0) {
+				args->predictor = PRED_EWMA_VAR;
+			} else if (strcmp(val, "median") == 0) {
+				args->predictor = PRED_MEDIAN;
+			} else if (strcmp(val, "class") == 0) {
+				args->predictor = PRED_CLASS;
+			} else {
+				ARG_ERROR("Predictor must be exp, adaptive, ewma-var, median or "
+				          "class");
+			}
+		} else if ((val = match_opt(argv[i], "pred-k"))) {
+			args->pred_k = atof(val);
+			if (args->pred_k < 0) {
+				ARG_ERROR("Predictor k must not be negative");
+			}
+		} else if ((val = match_opt(argv[i], "pred-window"))) {
+			args->pred_window = atoi(val);
+			if (args->pred_window < 1 || args->pred_window > PRED_WINDOW_MAX) {
+				ARG_ERROR("Predictor window must be between 1 and %d",
+				          PRED_WINDOW_MAX);
+			}
+		} else if ((val = match_opt(argv[i], "alpha-sweep"))) {
+			double v[ALPHA_SWEEP_MAX];
+			args->alpha_sweep = parse_list(val, v, ALPHA_SWEEP_MAX);
+			if (args->alpha_sweep < 0) {
+				ARG_ERROR("Alpha sweep must be a list of numbers");
+			}
+			for (int k = 0; k < args->alpha_sweep; ++k) {
+				if (v[k] < 0 || v[k] > 1) {
+					ARG_ERROR("Swept alphas must be between 0 and 1");
+				}
+				args->sweep_alpha[k] = v[k];
+			}
+		} else if ((val = match_opt(argv[i], "deadline"))) {
+			args->deadline_slack = atof(val);
+			if (args->deadline_slack < 1) {
+				ARG_ERROR("Deadline slack must be at least 1");
+			}
+		} else if ((val = match_opt(argv[i], "converge-metric"))) {
+			if (strcmp(val, "wait") == 0) {
+				args->converge_metric = 0;
+			} else if (strcmp(val, "turnaround") == 0) {
+				args->converge_metric = 1;
+			} else {
+				ARG_ERROR("Convergence metric must be wait or turnaround");
+			}
+		} else {
+			ARG_ERROR("Unknown option %s", argv[i]);
+		}
+	}
+
+	return args_finish(args, err, err_len);
+}
+
+int args_finish(args_t* args, char* err, size_t err_len) {
+	if (args->n < 1 || args->n > 26 || args->n_cpu < 0 || args->n_cpu > args->n)
+		ARG_ERROR("Number of Processes must be at most 26 and at least 1, of "
+		          "which at most all are CPU-bound");
+
+	// Defaults for unset options.
+	if (args->mlfq_levels == 0) args->mlfq_levels = 3;
+	if (args->mlfq_boost == 0) args->mlfq_boost = 20 * (args->Tslice ? args->Tslice : 1);
+	if (args->cfs_latency == 0) args->cfs_latency = args->Tslice ? args->Tslice : 1;
+	if (args->cfs_min_gran == 0)
+		args->cfs_min_gran = args->cfs_latency >= 8 ? args->cfs_latency / 8 : 1;
+	if (args->tickets_cpu == 0) args->tickets_cpu = 100;
+	if (args->tickets_io == 0) args->tickets_io = 100;
+	for (int g = 0; g < GROUP_MAX; ++g) {
+		if (args->group_shares[g] == 0) args->group_shares[g] = 1024;
+	}
+	if (args->group_period == 0) args->group_period = 100;
+	for (int c = 0; c < MCPU_MAX; ++c) {
+		if (args->cpu_speed[c] == 0) args->cpu_speed[c] = 1.0;
+	}
+	if (args->cache_decay == 0) args->cache_decay = 100;
+	if (args->cache_evict == 0) args->cache_evict = 0.5;
+	if (args->pred_window == 0) args->pred_window = 5;
+	if (args->result_cache_size == 0) args->result_cache_size = 64 * 1024;
+	if (args->serve && args->workers == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		args->workers = cpus < 1 ? 1 : cpus > 256 ? 256 : cpus;
+	}
+	for (int d = 0; d < IO_DEV_MAX; ++d) {
+		if (args->io_units[d] == 0) args->io_units[d] = 1;
+	}
+	if (args->balance_period == 0)
+		args->balance_period = args->Tslice ? args->Tslice : 1;
+	if (args->prio_aging == 0) args->prio_aging = 10 * (args->Tslice ? args->Tslice : 1);
+
+	if (args->tickets_cpu < 1 || args->tickets_io < 1) {
+		ARG_ERROR("Ticket counts must be positive");
+	}
+	if (args->nice_cpu < -20 || args->nice_cpu > 19 || args->nice_io < -20 ||
+	    args->nice_io > 19) {
+		ARG_ERROR("Nice levels must be between -20 and 19");
+	}
+	if (args->open_rate > 0 && args->horizon == 0) {
+		ARG_ERROR("Open-system mode requires --horizon");
+	}
+	if (args->serve && (args->reps > 0 || args->estimate)) {
+		ARG_ERROR("Server mode runs neither studies nor estimates");
+	}
+	if (args->burst_log && (args->reps > 0 || args->serve)) {
+		ARG_ERROR("Only single runs write a burst log");
+	}
+	if (args->estimate && (args->open_rate > 0 || args->reps > 0)) {
+		ARG_ERROR("Estimates are only made for a single closed-system run");
+	}
+	if ((args->checkpoint || args->restore) &&
+	    (args->reps > 0 || args->io_devices > 0)) {
+		ARG_ERROR("Checkpoints cannot be taken in a study or with I/O devices");
+	}
+	if (args->checkpoint && args->checkpoint_every == 0 && args->warmup == 0) {
+		ARG_ERROR("Checkpoints need --checkpoint-every or --warmup");
+	}
+	if (args->checkpoint_of && args->checkpoint == NULL) {
+		ARG_ERROR("Checkpoint engine given without --checkpoint");
+	}
+	if (args->antithetic && (args->reps == 0 || args->reps % 2 != 0)) {
+		ARG_ERROR("Antithetic replications need an even --reps count");
+	}
+	if (args->antithetic && args->reps < 4) {
+		// The pairs are the units; one gives no variance.
+		ARG_ERROR("Antithetic replications need at least 2 pairs (--reps=4)");
+	}
+	if (args->warmup >= args->horizon && args->horizon != 0) {
+		ARG_ERROR("Warm-up must end before the horizon");
+	}
+	return 0;
+}
+
+args_t* parse_args(int argc, char* argv[]) {
+	args_t* args = malloc(sizeof(args_t));
+	char err[256];
+	if (parse_args_r(args, argc, argv, err, sizeof(err)) != 0) {
+		fprintf(stderr, "ERROR: %s\n", err);
+		exit(1);
+	}
 	return args;
 }
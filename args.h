@@ -1,6 +1,61 @@
 #ifndef OPSYS_SIM_ARGS_H
 #define OPSYS_SIM_ARGS_H
 
+#include <stddef.h>
+#include <stdio.h>
+#include "obs.h"
+#include "simtime.h"
+
+// Most process groups (--groups).
+#define GROUP_MAX 8
+
+// Most CPUs in a multi-CPU run (--cpus).
+#define MCPU_MAX 16
+
+// Most I/O devices (--io-devices) and units per device (--io-units).
+#define IO_DEV_MAX 8
+#define IO_UNITS_MAX 64
+
+// Order in which an I/O device serves waiting requests (--io-discipline).
+enum io_discipline {
+	IO_FIFO = 0, // Order of arrival.
+	IO_SHORTEST, // Shortest request first.
+};
+
+// Longest window of the median burst predictor (--pred-window).
+#define PRED_WINDOW_MAX 16
+
+// Most alphas evaluated at once (--alpha-sweep).
+#define ALPHA_SWEEP_MAX 32
+
+// Burst predictor of SJF and SRT (--predictor).
+enum predictor {
+	PRED_DEFAULT = 0, // exp, without reporting its error.
+	PRED_EXP,         // Exponential averaging with a fixed alpha.
+	PRED_ADAPTIVE,    // ... with alpha adapting to the prediction error.
+	PRED_EWMA_VAR,    // Averaged mean plus k averaged standard deviations.
+	PRED_MEDIAN,      // Median of a sliding window of bursts.
+	PRED_CLASS,       // exp, starting from the average of the process class.
+};
+
+// Run queues and load balancing of multi-CPU runs (--balance).
+enum balance {
+	BAL_SHARED = 0, // One ready queue shared by all CPUs.
+	BAL_NONE,       // A queue per CPU, never rebalanced.
+	BAL_PUSH,       // ... with periodic push balancing.
+	BAL_STEAL,      // ... with idle CPUs stealing half the busiest queue.
+	BAL_PUSH_STEAL, // ... with both.
+};
+
+// Where multi-CPU runs place a ready process among the idle CPUs.
+enum placement {
+	PLACE_FASTEST_IDLE = 0, // The fastest idle CPU.
+	PLACE_CAPACITY,         // The slowest idle CPU that finishes the burst
+	                        // within a time slice, else the fastest.
+	PLACE_CPU_BOUND_BIG,    // CPU-bound processes on the fastest idle CPU,
+	                        // I/O-bound ones on the slowest.
+};
+
 typedef struct args {
 	int n;                     // Number of processes to simulate
 	int n_cpu;                 // Number of CPU-bound processes
@@ -16,8 +71,114 @@ typedef struct args {
 	             // When calculating τ values, use the “ceiling” function for all
 	             // calculations.
 	unsigned long int Tslice; // Time Slice value for the RR, in milliseconds.
+
+	// Optional settings, given as --name=value after the required arguments.
+	double open_rate; // Open-system arrival rate (processes/ms); 0 = closed.
+	                  // In open mode n is the number of process slots to
+	                  // start with; more are added as arrivals need them.
+	sim_time_t horizon; // Open system: no new arrivals after this time.
+	sim_time_t warmup;  // Statistics are only collected from this time.
+	double converge;     // Stop once the 95% CI half-width of the metric is
+	                     // below this fraction of its mean; 0 = run to the end.
+	int converge_metric; // Metric watched for convergence (conv_metric_t).
+	int reps;       // Replications for a variance-reduced study; 0 = one run.
+	int antithetic; // Study: pair each replication with its 1 - U mirror.
+	                // Inside a run: draw the workload antithetically.
+	int quiet;      // Suppress the per-event output.
+	FILE* out;      // Stream the per-event output is written to.
+	sim_time_t print_window; // Events after this time are not printed,
+	                         // except for a few such as terminations.
+	const obs_t* obs; // Observers of the events of a run, the per-event
+	                  // output among them; NULL = none.
+	int estimate;   // Queueing-theory estimates: 1 = next to the simulated
+	                // results, 2 = instead of simulating.
+	const char* result_cache; // Directory of the on-disk result cache;
+	                          // NULL = results are not cached.
+	unsigned long int result_cache_size; // Bound of the result cache, in KiB.
+	const char* workload_cache; // Directory of generated workloads kept for
+	                            // later runs; NULL = always generate.
+	const char* checkpoint; // File the state of checkpoint_of is checkpointed
+	                        // to, at the end of the warm-up and every
+	                        // checkpoint_every ms.
+	sim_time_t checkpoint_every; // 0 = only at the end of the warm-up.
+	const char* checkpoint_of; // FCFS, SJF, SRT, RR or the oracle of SJF or
+	                           // SRT; NULL = RR.
+	const char* restore; // Checkpoint FCFS, SJF, SRT, RR and the oracles
+	                     // continue from instead of starting, whichever of
+	                     // them took it.
+	const char* burst_log; // File every CPU burst of the runs is logged to;
+	                       // NULL = none.
+	const char* serve; // Serve requests on this Unix socket, or "-" for
+	                   // stdin/stdout; NULL = run once.
+	int workers;       // Server: requests run at once.
+	int mlfq_levels;   // MLFQ priority levels; level k has slice Tslice * 2^k.
+	unsigned long int mlfq_boost; // MLFQ priority boost period, in milliseconds.
+	int nice_cpu; // Nice level of CPU-bound processes.
+	int nice_io;  // Nice level of I/O-bound processes.
+	unsigned long int cfs_latency;  // CFS target latency, in milliseconds.
+	unsigned long int cfs_min_gran; // CFS minimum granularity, in milliseconds.
+	int tickets_cpu; // Lottery/stride tickets of CPU-bound processes.
+	int tickets_io;  // Lottery/stride tickets of I/O-bound processes.
+	int prio_levels; // Static priority levels, drawn at random per process;
+	                 // 0 = I/O-bound processes above CPU-bound ones.
+	unsigned long int prio_aging; // A waiting process rises one priority level
+	                              // per this many milliseconds.
+	int groups; // Process groups, drawn at random per process; 0 = two groups,
+	            // I/O-bound and CPU-bound.
+	int group_shares[GROUP_MAX]; // Weight of each group in the fair share.
+	unsigned long int group_quota[GROUP_MAX]; // CPU time each group may use
+	                                          // per period; 0 = unlimited.
+	unsigned long int group_period; // Bandwidth period, in milliseconds.
+	int cpus; // CPUs for the multi-CPU algorithms; 0 = they do not run.
+	double cpu_speed[MCPU_MAX]; // Relative speed of each CPU; a CPU burst of
+	                            // b ms takes b / speed ms of wall time.
+	int placement; // Placement policy of multi-CPU runs (enum placement).
+	unsigned long int cache_penalty; // Multi-CPU: extra switch-in time with a
+	                                 // cold cache, in ms; 0 = no cache model.
+	unsigned long int cache_decay; // Cache warmth decays by a factor of e over
+	                               // this many ms off the CPU.
+	double cache_evict; // Fraction of a process's cache evicted by each other
+	                    // process run on its CPU in between.
+	int balance; // Run queues of multi-CPU runs (enum balance).
+	unsigned long int balance_period; // Push balancing period, in ms.
+	unsigned long int migrate_cost; // Extra switch-in time on another CPU than
+	                                // the process last ran on, in ms.
+	int io_devices; // I/O devices of finite parallelism; 0 = I/O bursts never
+	                // wait for one another.
+	int io_units[IO_DEV_MAX];      // Requests each device serves at once.
+	int io_discipline[IO_DEV_MAX]; // Queueing discipline of each device.
+	int predictor;  // Burst predictor of SJF and SRT (enum predictor).
+	double pred_k;  // ewma-var predictor: standard deviations added.
+	int pred_window; // median predictor: bursts in the window.
+	int alpha_sweep; // Alphas whose prediction error SJF and SRT also track.
+	float sweep_alpha[ALPHA_SWEEP_MAX]; // ... their values.
+	double deadline_slack; // Burst deadlines are drawn up to this multiple of
+	                       // the burst length; 0 = no explicit deadlines.
 } args_t;
 
+/**
+ * Clear args and set the defaults of the options for which 0 is a valid
+ * value, as a starting point for setting options one by one.
+ */
+void args_init(args_t* args);
+
+/**
+ * Give the options left at 0 their defaults and check that the options
+ * make sense together.
+ * @return 0, or -1 with the reason in err, of size err_len.
+ */
+int args_finish(args_t* args, char* err, size_t err_len);
+
+/**
+ * Parse the command line into args, without exiting on bad input.
+ * @return 0, or -1 with the reason in err, of size err_len.
+ */
+int parse_args_r(args_t* args, int argc, char* argv[], char* err,
+                 size_t err_len);
+
+/**
+ * Parse the command line into a new args_t, or exit with an error message.
+ */
 args_t* parse_args(int argc, char* argv[]);
 
 #endif
@@ -0,0 +1,107 @@
+#include "bqueue.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// One level's FIFO, a growable ring buffer.
+typedef struct {
+	void** data;
+	size_t head;
+	size_t size;
+	size_t cap;
+} bucket_t;
+
+struct bqueue {
+	int levels;
+	unsigned long long bitmap; // Bit k is set when level k is non-empty.
+	bucket_t* buckets;
+};
+
+#define BUCKET_INITIAL_SIZE 8
+
+bqueue_t* make_bqueue(int levels) {
+	assert(levels > 0 && levels <= BQUEUE_MAX_LEVELS);
+	bqueue_t* q = malloc(sizeof(bqueue_t));
+	q->levels = levels;
+	q->bitmap = 0;
+	q->buckets = calloc(levels, sizeof(bucket_t));
+	return q;
+}
+
+void free_bqueue(bqueue_t** q) {
+	if (*q != NULL) {
+		for (int i = 0; i < (*q)->levels; ++i) free((*q)->buckets[i].data);
+		free((*q)->buckets);
+		free(*q);
+		*q = NULL;
+	}
+}
+
+int bqueue_levels(const bqueue_t* q) { return q->levels; }
+
+void bqueue_push(bqueue_t* q, int level, void* v) {
+	assert(q);
+	assert(v);
+	assert(level >= 0 && level < q->levels);
+
+	bucket_t* b = &q->buckets[level];
+	if (b->size == b->cap) {
+		// Grow and unwrap the ring.
+		size_t cap = b->cap ? b->cap * 2 : BUCKET_INITIAL_SIZE;
+		void** data = malloc(cap * sizeof(void*));
+		for (size_t i = 0; i < b->size; ++i)
+			data[i] = b->data[(b->head + i) % b->cap];
+		free(b->data);
+		b->data = data;
+		b->head = 0;
+		b->cap = cap;
+	}
+
+	b->data[(b->head + b->size) % b->cap] = v;
+	++b->size;
+	q->bitmap |= 1ULL << level;
+}
+
+void* bqueue_pop_level(bqueue_t* q, int level) {
+	assert(q);
+	assert(level >= 0 && level < q->levels);
+
+	bucket_t* b = &q->buckets[level];
+	if (b->size == 0) return NULL;
+
+	void* v = b->data[b->head];
+	b->head = (b->head + 1) % b->cap;
+	if (--b->size == 0) q->bitmap &= ~(1ULL << level);
+	return v;
+}
+
+int bqueue_top(const bqueue_t* q) {
+	assert(q);
+	return q->bitmap ? __builtin_ctzll(q->bitmap) : -1;
+}
+
+void* bqueue_pop(bqueue_t* q) {
+	int level = bqueue_top(q);
+	return level < 0 ? NULL : bqueue_pop_level(q, level);
+}
+
+void* bqueue_peek(const bqueue_t* q) {
+	int level = bqueue_top(q);
+	return level < 0 ? NULL : bqueue_at(q, level, 0);
+}
+
+void* bqueue_peek_level(const bqueue_t* q, int level) {
+	return bqueue_size(q, level) == 0 ? NULL : bqueue_at(q, level, 0);
+}
+
+size_t bqueue_size(const bqueue_t* q, int level) {
+	assert(q);
+	assert(level >= 0 && level < q->levels);
+	return q->buckets[level].size;
+}
+
+void* bqueue_at(const bqueue_t* q, int level, size_t i) {
+	assert(q);
+	assert(i < bqueue_size(q, level));
+	const bucket_t* b = &q->buckets[level];
+	return b->data[(b->head + i) % b->cap];
+}
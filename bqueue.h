@@ -0,0 +1,72 @@
+#include <stddef.h>
+
+#ifndef OPSYS_SIM_BQUEUE_H_
+#define OPSYS_SIM_BQUEUE_H_
+
+// Most levels a bucket queue can have (one bit each in the bitmap).
+#define BQUEUE_MAX_LEVELS 64
+
+/**
+ * Bucket queue: one FIFO per priority level plus a bitmap of the non-empty
+ * levels, so push and pop are O(1) however many items are queued. Level 0
+ * is the highest priority.
+ */
+typedef struct bqueue bqueue_t;
+
+/**
+ * Allocate a new bucket queue with the given number of levels.
+ * @pre: 0 < levels <= BQUEUE_MAX_LEVELS.
+ */
+bqueue_t* make_bqueue(int levels);
+
+/**
+ * Free the memory associated with the queue object and set q to NULL. Values
+ * stored by q are not freed.
+ */
+void free_bqueue(bqueue_t** q);
+
+int bqueue_levels(const bqueue_t* q);
+
+/**
+ * Add an item at the tail of its level.
+ */
+void bqueue_push(bqueue_t* q, int level, void* v);
+
+/**
+ * Remove the item at the head of the highest-priority non-empty level.
+ * @returns The value or NULL if the queue is empty.
+ */
+void* bqueue_pop(bqueue_t* q);
+
+/**
+ * Remove the item at the head of the given level.
+ * @returns The value or NULL if the level is empty.
+ */
+void* bqueue_pop_level(bqueue_t* q, int level);
+
+/**
+ * Peek at the item bqueue_pop() would return.
+ */
+void* bqueue_peek(const bqueue_t* q);
+
+/**
+ * Peek at the item bqueue_pop_level() would return.
+ */
+void* bqueue_peek_level(const bqueue_t* q, int level);
+
+/**
+ * @returns The highest-priority non-empty level, or -1 if the queue is empty.
+ */
+int bqueue_top(const bqueue_t* q);
+
+/**
+ * @returns The number of items queued at level.
+ */
+size_t bqueue_size(const bqueue_t* q, int level);
+
+/**
+ * @returns Item i (0 is the head) of level.
+ */
+void* bqueue_at(const bqueue_t* q, int level, size_t i);
+
+#endif // OPSYS_SIM_BQUEUE_H_
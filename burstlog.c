@@ -0,0 +1,185 @@
+#include "burstlog.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+
+// The columns, in the order of the file.
+static const burstlog_col_t burstlog_cols[BURSTLOG_COLUMNS] = {
+    {"id", 4},    {"class", 1}, {"burst", 4}, {"ready", 8},
+    {"start", 8}, {"end", 8},   {"wait", 8},  {"turnaround", 8},
+    {"preempt", 4}, {"tau", 8},
+};
+
+static void burstlog_data(const burstlog_t* bl,
+                          const void* data[BURSTLOG_COLUMNS]) {
+	data[0] = bl->id;
+	data[1] = bl->cls;
+	data[2] = bl->burst;
+	data[3] = bl->ready;
+	data[4] = bl->start;
+	data[5] = bl->end;
+	data[6] = bl->wait;
+	data[7] = bl->turnaround;
+	data[8] = bl->preempt;
+	data[9] = bl->tau;
+}
+
+static void burstlog_write(burstlog_t* bl, const void* data, size_t size) {
+	if (!bl->error && fwrite(data, 1, size, bl->f) != size) bl->error = 1;
+}
+
+/**
+ * Write the buffered bursts as a block.
+ */
+static void burstlog_flush(burstlog_t* bl) {
+	if (bl->rows == 0) return;
+	const void* data[BURSTLOG_COLUMNS];
+	burstlog_data(bl, data);
+
+	burstlog_block_t b = {.rows = bl->rows, .sum = FNV_OFFSET};
+	memcpy(b.algo, bl->algo, sizeof(b.algo));
+	for (int c = 0; c < BURSTLOG_COLUMNS; ++c) {
+		b.sum = fnv1a(b.sum, data[c], (size_t) bl->rows * burstlog_cols[c].width);
+	}
+	burstlog_write(bl, &b, sizeof(b));
+	for (int c = 0; c < BURSTLOG_COLUMNS; ++c) {
+		burstlog_write(bl, data[c], (size_t) bl->rows * burstlog_cols[c].width);
+	}
+	bl->rows = 0;
+}
+
+int burstlog_open(burstlog_t* bl, const char* path) {
+	memset(bl, 0, sizeof(*bl));
+	bl->id = malloc(BURSTLOG_ROWS * sizeof(uint32_t));
+	bl->cls = malloc(BURSTLOG_ROWS * sizeof(uint8_t));
+	bl->burst = malloc(BURSTLOG_ROWS * sizeof(uint32_t));
+	bl->ready = malloc(BURSTLOG_ROWS * sizeof(uint64_t));
+	bl->start = malloc(BURSTLOG_ROWS * sizeof(uint64_t));
+	bl->end = malloc(BURSTLOG_ROWS * sizeof(uint64_t));
+	bl->wait = malloc(BURSTLOG_ROWS * sizeof(uint64_t));
+	bl->turnaround = malloc(BURSTLOG_ROWS * sizeof(uint64_t));
+	bl->preempt = malloc(BURSTLOG_ROWS * sizeof(uint32_t));
+	bl->tau = malloc(BURSTLOG_ROWS * sizeof(int64_t));
+	const void* data[BURSTLOG_COLUMNS];
+	burstlog_data(bl, data);
+	for (int c = 0; c < BURSTLOG_COLUMNS; ++c) {
+		if (data[c] == NULL) {
+			burstlog_close(bl);
+			errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	bl->f = fopen(path, "wb");
+	if (bl->f == NULL) {
+		int e = errno;
+		burstlog_close(bl);
+		errno = e;
+		return -1;
+	}
+	burstlog_hdr_t h = {.version = BURSTLOG_VERSION, .columns = BURSTLOG_COLUMNS};
+	memcpy(h.magic, BURSTLOG_MAGIC, sizeof(h.magic));
+	burstlog_write(bl, &h, sizeof(h));
+	burstlog_write(bl, burstlog_cols, sizeof(burstlog_cols));
+	return 0;
+}
+
+void burstlog_begin(burstlog_t* bl, const char* algo) {
+	memset(bl->algo, 0, sizeof(bl->algo));
+	strncpy(bl->algo, algo, BURSTLOG_NAME_MAX - 1);
+	if (bl->procs) memset(bl->procs, 0, bl->n_procs * sizeof(burstlog_proc_t));
+}
+
+/**
+ * Start the next burst of process p, ready at time t.
+ */
+static void burstlog_ready(burstlog_proc_t* p, sim_time_t t) {
+	p->running = 0;
+	p->ready = t;
+	p->start = SIM_TIME_MAX;
+	p->joined = t;
+	p->wait = 0;
+	p->preempt = 0;
+}
+
+void burstlog_event(void* data, const obs_event_t* ev) {
+	burstlog_t* bl = data;
+	int i = ev->id - 'A';
+	if (i >= bl->n_procs) {
+		int n = bl->n_procs ? bl->n_procs : 26;
+		while (n <= i) n *= 2;
+		bl->procs = realloc(bl->procs, n * sizeof(burstlog_proc_t));
+		memset(bl->procs + bl->n_procs, 0,
+		       (n - bl->n_procs) * sizeof(burstlog_proc_t));
+		bl->n_procs = n;
+	}
+	burstlog_proc_t* p = &bl->procs[i];
+	switch (ev->kind) {
+	case OBS_ARRIVAL:
+		p->seen = 1;
+		p->cls = ev->arg;
+		p->burst = 0;
+		p->tau = -1;
+		burstlog_ready(p, ev->t);
+		break;
+	case OBS_IO_DONE:
+		++p->burst;
+		burstlog_ready(p, ev->t);
+		break;
+	case OBS_TAU:
+		p->tau = ev->arg;
+		break;
+	case OBS_START:
+		if (p->start == SIM_TIME_MAX) p->start = ev->t;
+		p->wait += ev->t - p->joined;
+		p->running = 1;
+		break;
+	case OBS_PREEMPT:
+		// Also while switching in, before it started.
+		if (p->running) p->joined = ev->t;
+		p->running = 0;
+		++p->preempt;
+		break;
+	case OBS_STOP:
+	case OBS_TERMINATE:
+		if (!p->seen) break;
+		if (bl->rows == BURSTLOG_ROWS) burstlog_flush(bl);
+		int r = bl->rows++;
+		bl->id[r] = ev->id;
+		bl->cls[r] = p->cls;
+		bl->burst[r] = p->burst;
+		bl->ready[r] = p->ready;
+		bl->start[r] = p->start;
+		bl->end[r] = ev->t;
+		bl->wait[r] = p->wait;
+		bl->turnaround[r] = ev->t - p->ready;
+		bl->preempt[r] = p->preempt;
+		bl->tau[r] = p->tau;
+		p->running = 0;
+		break;
+	}
+}
+
+void burstlog_end(burstlog_t* bl) {
+	burstlog_flush(bl);
+}
+
+int burstlog_close(burstlog_t* bl) {
+	if (bl->f) {
+		burstlog_flush(bl);
+		if (fclose(bl->f) != 0) bl->error = 1;
+	}
+	free(bl->procs);
+	free(bl->id);
+	free(bl->cls);
+	free(bl->burst);
+	free(bl->ready);
+	free(bl->start);
+	free(bl->end);
+	free(bl->wait);
+	free(bl->turnaround);
+	free(bl->preempt);
+	free(bl->tau);
+	return bl->error ? -1 : 0;
+}
@@ -0,0 +1,120 @@
+#ifndef OPSYS_SIM_BURSTLOG_H_
+#define OPSYS_SIM_BURSTLOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "obs.h"
+#include "simtime.h"
+
+#define BURSTLOG_MAGIC "SIMBLOG"
+#define BURSTLOG_VERSION 2
+#define BURSTLOG_NAME_MAX 32
+#define BURSTLOG_COLUMNS 10
+
+// Bursts buffered per block.
+#define BURSTLOG_ROWS 4096
+
+// Event kinds the log observes.
+#define BURSTLOG_MASK (OBS_ALL & ~OBS_MASK(OBS_OTHER) & ~OBS_MASK(OBS_IO_START))
+
+/**
+ * A burst log file: this header, then BURSTLOG_COLUMNS column descriptions,
+ * then blocks of the bursts of one run each. A block is a burstlog_block_t,
+ * then each column in turn, rows values of its width, in native byte order.
+ *
+ * The columns, one row per completed CPU burst, are:
+ *   id         u32  Process id, 'A' on.
+ *   class      u8   1 if the process is CPU-bound, 0 if I/O-bound.
+ *   burst      u32  Index of the CPU burst among those of the process.
+ *   ready      u64  When the burst was ready: the process arrived or
+ *                   completed I/O.
+ *   start      u64  When it first started using a CPU.
+ *   end        u64  When it was completed.
+ *   wait       u64  Time it was ready but not running, switches in included.
+ *   turnaround u64  end - ready.
+ *   preempt    u32  Times it was preempted.
+ *   tau        i64  Burst time predicted for it; -1 if the algorithm has no
+ *                   prediction.
+ */
+typedef struct {
+	char magic[8];
+	uint32_t version; // BURSTLOG_VERSION
+	uint32_t columns; // BURSTLOG_COLUMNS
+} burstlog_hdr_t;
+
+typedef struct {
+	char name[12];
+	uint32_t width; // Bytes per value.
+} burstlog_col_t;
+
+typedef struct {
+	char algo[BURSTLOG_NAME_MAX];
+	uint32_t rows;
+	uint32_t reserved;
+	uint64_t sum; // FNV-1a of the columns of the block.
+} burstlog_block_t;
+
+// The burst a process is on.
+typedef struct {
+	int seen;           // Whether its arrival was observed.
+	int running;        // Whether it is using a CPU.
+	uint8_t cls;        // ... see the columns.
+	uint32_t burst;
+	sim_time_t ready;
+	sim_time_t start;   // SIM_TIME_MAX until it starts.
+	sim_time_t joined;  // When it last became ready.
+	sim_time_t wait;
+	uint32_t preempt;
+	int64_t tau;
+} burstlog_proc_t;
+
+typedef struct {
+	FILE* f;
+	int error;  // Whether a write failed.
+	char algo[BURSTLOG_NAME_MAX];
+	burstlog_proc_t* procs; // By id - 'A'; grows with the open-system slots.
+	int n_procs;
+
+	int rows;   // Bursts buffered, by column.
+	uint32_t* id;
+	uint8_t* cls;
+	uint32_t* burst;
+	uint64_t* ready;
+	uint64_t* start;
+	uint64_t* end;
+	uint64_t* wait;
+	uint64_t* turnaround;
+	uint32_t* preempt;
+	int64_t* tau;
+} burstlog_t;
+
+/**
+ * Create the burst log file at path and write its header.
+ * @return 0, or -1 with errno set.
+ */
+int burstlog_open(burstlog_t* bl, const char* path);
+
+/**
+ * Start logging a run of algorithm algo.
+ */
+void burstlog_begin(burstlog_t* bl, const char* algo);
+
+/**
+ * Observer of the events of a run, with bl as data and BURSTLOG_MASK as
+ * mask. Processes that arrived before the run began, as when it is restored
+ * from a checkpoint, are not logged.
+ */
+void burstlog_event(void* data, const obs_event_t* ev);
+
+/**
+ * Write the bursts of the run still buffered.
+ */
+void burstlog_end(burstlog_t* bl);
+
+/**
+ * Close the file and free bl.
+ * @return 0, or -1 if a write failed.
+ */
+int burstlog_close(burstlog_t* bl);
+
+#endif // OPSYS_SIM_BURSTLOG_H_
@@ -0,0 +1,263 @@
+#include "ckpt.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hash.h"
+
+#define CKPT_MAGIC "SIMCKP1"
+#define CKPT_NAME_MAX 32
+
+/**
+ * Start of a checkpoint: what it is and the workload it continues.
+ */
+typedef struct {
+	char magic[8];
+	int version;  // CKPT_VERSION
+	char name[CKPT_NAME_MAX];
+	int n, n_cpu;
+	long seed;
+	double lambda;
+	unsigned long exp_max;
+	double open_rate;
+} ckpt_hdr_t;
+
+static void ckpt_hdr(ckpt_hdr_t* h, const char* name, const args_t* args) {
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, CKPT_MAGIC, sizeof(h->magic));
+	h->version = CKPT_VERSION;
+	strncpy(h->name, name, CKPT_NAME_MAX - 1);
+	h->n = args->n;
+	h->n_cpu = args->n_cpu;
+	h->seed = args->seed;
+	h->lambda = args->lambda;
+	h->exp_max = args->exp_max;
+	h->open_rate = args->open_rate;
+}
+
+int ckpt_wanted(const args_t* args, const char* name) {
+	return strcmp(args->checkpoint_of ? args->checkpoint_of : "RR", name) == 0;
+}
+
+int ckpt_save(ckpt_t* ck, const char* path, const char* name,
+              const args_t* args) {
+	*ck = (ckpt_t){.sum = FNV_OFFSET};
+	snprintf(ck->path, sizeof(ck->path), "%s", path);
+	snprintf(ck->tmp, sizeof(ck->tmp), "%s.tmp-XXXXXX", path);
+	int fd = mkstemp(ck->tmp);
+	ck->f = fd < 0 ? NULL : fdopen(fd, "wb");
+	if (ck->f == NULL) {
+		fprintf(stderr, "WARNING: checkpoint %s: %s\n", ck->tmp, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			unlink(ck->tmp);
+		}
+		return -1;
+	}
+
+	ckpt_hdr_t h;
+	ckpt_hdr(&h, name, args);
+	ckpt_data(ck, &h, sizeof(h));
+	return 0;
+}
+
+int ckpt_restore(ckpt_t* ck, const char* path, const char* name,
+                 const args_t* args) {
+	*ck = (ckpt_t){.restoring = 1, .sum = FNV_OFFSET};
+	snprintf(ck->path, sizeof(ck->path), "%s", path);
+	ck->f = fopen(path, "rb");
+	if (ck->f == NULL) {
+		fprintf(stderr, "ERROR: checkpoint %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	// Any engine's checkpoint of the same workload will do.
+	ckpt_hdr_t want, got;
+	ckpt_hdr(&want, name, args);
+	ckpt_data(ck, &got, sizeof(got));
+	ck->same = strncmp(want.name, got.name, CKPT_NAME_MAX) == 0;
+	memcpy(want.name, got.name, CKPT_NAME_MAX);
+	if (ck->error || memcmp(&want, &got, sizeof(want)) != 0) {
+		fprintf(stderr, "ERROR: checkpoint %s is not of this workload\n", path);
+		fclose(ck->f);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Read what is left of the state up to the checksum, so that it is summed.
+ */
+static void ckpt_skip(ckpt_t* ck) {
+	long at = ftell(ck->f), end = -1;
+	if (at >= 0 && fseek(ck->f, 0, SEEK_END) == 0) end = ftell(ck->f);
+	end -= sizeof(unsigned long long);
+	if (end < at || fseek(ck->f, at, SEEK_SET) != 0) {
+		ck->error = 1;
+		return;
+	}
+	char buf[4096];
+	for (long left = end - at; left > 0; left -= sizeof(buf))
+		ckpt_data(ck, buf,
+		          left < (long) sizeof(buf) ? (size_t) left : sizeof(buf));
+}
+
+int ckpt_close(ckpt_t* ck) {
+	if (ck->restoring && !ck->same && !ck->error) ckpt_skip(ck);
+	unsigned long long sum = ck->sum;
+	if (ck->restoring) {
+		unsigned long long want;
+		if (!ck->error && fread(&want, sizeof(want), 1, ck->f) != 1) ck->error = 1;
+		if (!ck->error && want != sum) ck->error = 1;
+		fclose(ck->f);
+		if (ck->error) {
+			fprintf(stderr, "ERROR: checkpoint %s is truncated or corrupt\n",
+			        ck->path);
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!ck->error && fwrite(&sum, sizeof(sum), 1, ck->f) != 1) ck->error = 1;
+	if (fclose(ck->f) != 0) ck->error = 1;
+	if (ck->error || rename(ck->tmp, ck->path) != 0) {
+		fprintf(stderr, "WARNING: checkpoint %s: %s\n", ck->path, strerror(errno));
+		unlink(ck->tmp);
+		return -1;
+	}
+	return 0;
+}
+
+void ckpt_data(ckpt_t* ck, void* data, size_t len) {
+	if (ck->error) return;
+	if (ck->restoring) {
+		if (fread(data, 1, len, ck->f) != len) {
+			ck->error = 1;
+			return;
+		}
+	} else if (fwrite(data, 1, len, ck->f) != len) {
+		ck->error = 1;
+		return;
+	}
+	ck->sum = fnv1a(ck->sum, data, len);
+}
+
+/**
+ * Write or read array *a of n ints, allocating it when restoring.
+ */
+static void ckpt_ints(ckpt_t* ck, int** a, int n) {
+	int present = *a != NULL;
+	ckpt_data(ck, &present, sizeof(present));
+	if (ck->restoring) {
+		free(*a);
+		*a = present && !ck->error ? malloc(n * sizeof(int)) : NULL;
+	}
+	if (*a) ckpt_data(ck, *a, n * sizeof(int));
+}
+
+void ckpt_procs(ckpt_t* ck, process_t* procs, int n) {
+	for (int i = 0; i < n; ++i) {
+		// Everything but the arrays, then the arrays.
+		process_t p = procs[i];
+		ckpt_data(ck, &p, sizeof(p));
+		if (ck->error) return;
+		if (ck->restoring) {
+			p.cpu_bursts = procs[i].cpu_bursts;
+			p.io_bursts = procs[i].io_bursts;
+			p.deadlines = procs[i].deadlines;
+			procs[i] = p;
+		}
+		ckpt_ints(ck, &procs[i].cpu_bursts, procs[i].cpu_burst_ct);
+		ckpt_ints(ck, &procs[i].io_bursts, procs[i].cpu_burst_ct - 1);
+		ckpt_ints(ck, &procs[i].deadlines, procs[i].cpu_burst_ct);
+	}
+}
+
+void ckpt_items(ckpt_t* ck, queue_t* q, size_t size) {
+	long n = queue_size(q);
+	ckpt_data(ck, &n, sizeof(n));
+	if (ck->restoring) {
+		for (void* v = queue_pop(q); v; v = queue_pop(q)) free(v);
+		for (long i = 0; i < n && !ck->error; ++i) {
+			void* v = malloc(size);
+			ckpt_data(ck, v, size);
+			if (ck->error) {
+				free(v);
+				break;
+			}
+			queue_push(q, v);
+		}
+		return;
+	}
+
+	// In the order they leave the queue, which pushing them back restores.
+	queue_t* q2 = make_queue();
+	queue_copy(q2, q);
+	for (void* v = queue_pop(q2); v; v = queue_pop(q2)) ckpt_data(ck, v, size);
+	free_queue(&q2);
+}
+
+void ckpt_refs(ckpt_t* ck, queue_t* q, void** items, int n) {
+	long m = queue_size(q);
+	ckpt_data(ck, &m, sizeof(m));
+	if (ck->restoring) {
+		while (queue_pop(q)) continue;
+		for (long i = 0; i < m && !ck->error; ++i) {
+			long k;
+			ckpt_data(ck, &k, sizeof(k));
+			if (!ck->error && (k < 0 || k >= n)) ck->error = 1;
+			if (!ck->error) queue_push(q, items[k]);
+		}
+		return;
+	}
+
+	queue_t* q2 = make_queue();
+	queue_copy(q2, q);
+	for (void* v = queue_pop(q2); v; v = queue_pop(q2)) {
+		long k = 0;
+		while (k < n && items[k] != v) ++k;
+		ckpt_data(ck, &k, sizeof(k));
+	}
+	free_queue(&q2);
+}
+
+void ckpt_open_sys(ckpt_t* ck, open_sys_t* os) {
+	ckpt_data(ck, &os->rng, sizeof(os->rng));
+	ckpt_data(ck, &os->clock, sizeof(os->clock));
+	ckpt_data(ck, &os->t_next, sizeof(os->t_next));
+	ckpt_data(ck, &os->live, sizeof(os->live));
+	ckpt_data(ck, &os->arrived, sizeof(os->arrived));
+	ckpt_data(ck, &os->live_max, sizeof(os->live_max));
+	int slots = os->slots;
+	ckpt_data(ck, &slots, sizeof(slots));
+	if (!ck->restoring || ck->error) return;
+	if (slots < os->slots || (!os->enabled && slots != os->slots)) {
+		ck->error = 1;
+		return;
+	}
+	if (slots > os->slots) {
+		os->procs = realloc(os->procs, slots * sizeof(process_t));
+		memset(os->procs + os->slots, 0, (slots - os->slots) * sizeof(process_t));
+		os->slots = slots;
+	}
+}
+
+void ckpt_conv(ckpt_t* ck, conv_t* cv) {
+	// Everything but what the options set, which are the restoring run's.
+	conv_t opts = *cv;
+	ckpt_data(ck, cv, sizeof(*cv));
+	cv->args = opts.args;
+	cv->enabled = opts.enabled;
+	cv->metric = opts.metric;
+}
+
+void ckpt_common(ckpt_t* ck, sim_time_t* t, open_sys_t* os,
+                 process_t** procs, ckpt_proc_t** where) {
+	ckpt_data(ck, t, sizeof(*t));
+	ckpt_open_sys(ck, os);
+	if (ck->error) return;
+	if (os->enabled) *procs = os->procs;
+	ckpt_procs(ck, *procs, os->slots);
+	if (ck->restoring) *where = calloc(os->slots, sizeof(ckpt_proc_t));
+	ckpt_data(ck, *where, os->slots * sizeof(ckpt_proc_t));
+}
@@ -0,0 +1,135 @@
+#ifndef OPSYS_SIM_CKPT_H_
+#define OPSYS_SIM_CKPT_H_
+
+#include <stdio.h>
+#include "args.h"
+#include "converge.h"
+#include "open_sys.h"
+#include "predict.h"
+#include "process.h"
+#include "queue.h"
+
+// Bump whenever the state an engine checkpoints changes.
+#define CKPT_VERSION 5
+
+/**
+ * Checkpoint file of a running engine. An engine describes its state once,
+ * as a sequence of ckpt_*() calls, and the same sequence writes the state
+ * when checkpointing and reads it back when restoring. Pointers are never
+ * written: queued items are written by value or, when they point into an
+ * array, by index.
+ *
+ * A checkpoint starts with the state every engine that checkpoints shares
+ * (ckpt_common()), and goes on with the engine's own. Restoring the
+ * checkpoint of another engine reads only the shared state, and continues
+ * the run under the restoring engine's policy (see ckpt_proc_t).
+ *
+ * Files are written under a temporary name and renamed into place when
+ * closed, so a crash leaves the previous checkpoint intact. A checksum at
+ * the end rejects truncated or corrupt files.
+ */
+typedef struct {
+	FILE* f;
+	int restoring; // Whether the calls read the state instead of writing it.
+	int same;      // Restoring: whether the checkpoint is of this engine,
+	               // whose own state follows the shared one.
+	int error;     // Whether a call failed; later calls do nothing.
+	unsigned long long sum;
+	char path[4096];
+	char tmp[4096];
+} ckpt_t;
+
+/**
+ * Where a process stands at a checkpoint, in terms every engine that
+ * checkpoints understands. A process switching in or using the CPU counts as
+ * ready with what its burst has left, so that an engine continuing another's
+ * run starts with an idle CPU and schedules every ready process itself.
+ */
+typedef enum {
+	CKPT_GONE = 0, // Empty open-system slot, or terminated.
+	CKPT_ARRIVING, // Arrives at time t.
+	CKPT_READY,    // Burst burst, ready since t, has left ms to run.
+	CKPT_IO,       // Completes the I/O after burst burst at time t.
+} ckpt_where_t;
+
+typedef struct {
+	ckpt_where_t where;
+	int burst;
+	int left;
+	sim_time_t t;
+	unsigned tau; // Burst predicted for the process; 0 if the engine has none.
+	pred_t pred;  // Predictor state behind tau.
+} ckpt_proc_t;
+
+/**
+ * @return Whether engine name is the one that takes the checkpoints of a
+ * run: args->checkpoint_of, or RR if it is not set.
+ */
+int ckpt_wanted(const args_t* args, const char* name);
+
+/**
+ * Start a checkpoint of engine name to path.
+ * @return 0, or -1 if it cannot be written.
+ */
+int ckpt_save(ckpt_t* ck, const char* path, const char* name,
+              const args_t* args);
+
+/**
+ * Start restoring engine name from the checkpoint at path, which another
+ * engine may have made (ck->same tells). The workload options (n, n_cpu,
+ * seed, lambda, exp_max, open_rate) must match those the checkpoint was
+ * made with; other options may differ, so that one warm-up can be continued
+ * under several policies.
+ * @return 0, or -1 (with a message on stderr) if it cannot be restored.
+ */
+int ckpt_restore(ckpt_t* ck, const char* path, const char* name,
+                 const args_t* args);
+
+/**
+ * Finish the checkpoint: check or write the checksum, and when saving, move
+ * the file into place. The state of another engine left unread is skipped.
+ * @return 0, or -1 (with a message on stderr) if it failed.
+ */
+int ckpt_close(ckpt_t* ck);
+
+/**
+ * Write or read the len bytes at data.
+ */
+void ckpt_data(ckpt_t* ck, void* data, size_t len);
+
+/**
+ * Write or read the n processes in procs, bursts included. Restoring
+ * replaces their bursts; empty open-system slots stay empty.
+ */
+void ckpt_procs(ckpt_t* ck, process_t* procs, int n);
+
+/**
+ * Write or read the items of q, which it owns, by value. Restoring frees the
+ * items q holds and pushes malloc'd copies.
+ */
+void ckpt_items(ckpt_t* ck, queue_t* q, size_t size);
+
+/**
+ * Write or read the items of q as indexes into items, an array of n
+ * pointers.
+ */
+void ckpt_refs(ckpt_t* ck, queue_t* q, void** items, int n);
+
+/**
+ * Write or read the arrival stream of os. Restoring grows its slot table to
+ * the checkpoint's, for the processes to be read into next.
+ */
+void ckpt_open_sys(ckpt_t* ck, open_sys_t* os);
+
+void ckpt_conv(ckpt_t* ck, conv_t* cv);
+
+/**
+ * Write or read the state every engine's checkpoint starts with: the time t,
+ * the arrival stream of os, its processes *procs and where each stands, an
+ * array of os->slots. Restoring grows the slots to the checkpoint's, points
+ * *procs at those of an open system and allocates *where.
+ */
+void ckpt_common(ckpt_t* ck, sim_time_t* t, open_sys_t* os,
+                 process_t** procs, ckpt_proc_t** where);
+
+#endif // OPSYS_SIM_CKPT_H_
@@ -0,0 +1,127 @@
+#include "converge.h"
+#include <math.h>
+
+void conv_init(conv_t* cv, const args_t* args, const process_t* procs) {
+	*cv = (conv_t){.args = args,
+	               .enabled = args->converge > 0,
+	               .metric = args->converge_metric,
+	               .batch_size = CONV_BATCH_SIZE};
+	if (args->open_rate > 0) return;
+	for (int i = 0; i < args->n; ++i) cv->total_bursts += procs[i].cpu_burst_ct;
+}
+
+// Exact to 4 decimals up to df = 30; past it, the Cornish-Fisher expansion
+// is within 1e-5.
+double t975(long df) {
+	static const double t[30] = {
+	    12.7062, 4.3027, 3.1824, 2.7764, 2.5706, 2.4469, 2.3646, 2.3060,
+	    2.2622,  2.2281, 2.2010, 2.1788, 2.1604, 2.1448, 2.1314, 2.1199,
+	    2.1098,  2.1009, 2.0930, 2.0860, 2.0796, 2.0739, 2.0687, 2.0639,
+	    2.0595,  2.0555, 2.0518, 2.0484, 2.0452, 2.0423,
+	};
+	if (df < 1) return NAN;
+	if (df <= 30) return t[df - 1];
+
+	const double z = 1.959963985;
+	double z2 = z * z, v = df;
+	return z + z * (z2 + 1) / (4 * v) +
+	       z * ((5 * z2 + 16) * z2 + 3) / (96 * v * v) +
+	       z * (((3 * z2 + 19) * z2 + 17) * z2 - 15) / (384 * v * v * v);
+}
+
+// MSER truncation of the batch means followed by a confidence interval on
+// what remains.
+static void conv_update(conv_t* cv) {
+	double s1 = 0.0, s2 = 0.0;
+	double best = INFINITY;
+	int best_d = 0;
+	double best_s1 = 0.0, best_s2 = 0.0;
+	// Walk d from the back so the suffix sums build up in one pass.
+	for (int d = cv->k - 1; d >= 0; --d) {
+		s1 += cv->batch[d];
+		s2 += cv->batch[d] * cv->batch[d];
+		int n = cv->k - d;
+		if (d > cv->k / 2) continue;
+		double ssd = s2 - s1 * s1 / n;
+		double mser = ssd / ((double) n * n);
+		if (mser <= best) {
+			best = mser;
+			best_d = d;
+			best_s1 = s1;
+			best_s2 = s2;
+		}
+	}
+
+	int n = cv->k - best_d;
+	cv->truncated = best_d * cv->batch_size;
+	cv->mean = best_s1 / n;
+	double var = n > 1 ? (best_s2 - best_s1 * best_s1 / n) / (n - 1) : 0.0;
+	cv->half = n > 1 ? t975(n - 1) * sqrt(var > 0 ? var : 0.0) / sqrt(n) : 0.0;
+
+	if (cv->enabled && cv->observed >= CONV_MIN_OBS && n >= CONV_MIN_BATCHES &&
+	    cv->mean > 0 && cv->half <= cv->args->converge * cv->mean)
+		cv->done = 1;
+}
+
+long conv_add(conv_t* cv, conv_metric_t metric, double val, long obs) {
+	if (!cv->enabled || metric != cv->metric) return CONV_NEW;
+
+	if (obs != CONV_NEW) {
+		// Batch j holds observations [j, j + 1) * batch_size, merges included.
+		long j = obs / cv->batch_size;
+		if (j < cv->k) {
+			cv->batch[j] += val / cv->batch_size;
+			conv_update(cv);
+		} else {
+			cv->cur_sum += val;
+		}
+		return obs;
+	}
+
+	obs = cv->observed++;
+	cv->cur_sum += val;
+	if (++cv->cur_n < cv->batch_size) return obs;
+
+	cv->batch[cv->k++] = cv->cur_sum / cv->cur_n;
+	cv->cur_sum = 0.0;
+	cv->cur_n = 0;
+	if (cv->k == CONV_BATCHES) {
+		for (int i = 0; i < CONV_BATCHES / 2; ++i)
+			cv->batch[i] = (cv->batch[2 * i] + cv->batch[2 * i + 1]) / 2;
+		cv->k = CONV_BATCHES / 2;
+		cv->batch_size *= 2;
+	}
+	conv_update(cv);
+	return obs;
+}
+
+int conv_done(conv_t* cv) {
+	if (cv->done) return 1;
+	++cv->events;
+	return 0;
+}
+
+void conv_finish(conv_t* cv, sim_time_t t, conv_stat_t* out) {
+	if (!cv->enabled) return;
+	if (cv->k > 0) conv_update(cv);
+
+	*out = (conv_stat_t){.enabled = 1,
+	                     .metric = cv->metric,
+	                     .mean = cv->mean,
+	                     .half = cv->half,
+	                     .truncated = cv->truncated,
+	                     .observed = cv->observed,
+	                     .events = cv->events,
+	                     .stopped = cv->done,
+	                     .t_stop = t};
+	if (!cv->done || cv->observed == 0) return;
+
+	// Extrapolate the events left at the rate events were simulated per
+	// observation.
+	const args_t* args = cv->args;
+	double left = cv->total_bursts - cv->observed;
+	if (args->open_rate > 0 && t < args->horizon)
+		left = (args->horizon - t) * args->open_rate * (MAX_BURSTS + 1) / 2.0;
+	if (left > 0)
+		out->skipped = left * cv->events / cv->observed;
+}
@@ -0,0 +1,85 @@
+#ifndef OPSYS_SIM_CONVERGE_H_
+#define OPSYS_SIM_CONVERGE_H_
+
+#include "args.h"
+#include "process.h"
+
+// Number of batch means kept. When full, neighbouring batches are merged and
+// the batch size doubles, so memory stays constant however long the run.
+#define CONV_BATCHES 64
+// Initial batch size (as in MSER-5).
+#define CONV_BATCH_SIZE 5
+// Observations required before the run may stop.
+#define CONV_MIN_OBS 500
+// Batches that must remain after warm-up truncation to form an interval.
+#define CONV_MIN_BATCHES 20
+
+typedef enum { CONV_WAIT = 0, CONV_TURN } conv_metric_t;
+
+typedef struct {
+	int enabled;    // Whether convergence tracking was requested.
+	conv_metric_t metric;
+	double mean;    // Steady-state mean of the metric.
+	double half;    // 95% confidence interval half-width.
+	long truncated; // Observations discarded as warm-up by MSER.
+	long observed;  // Observations of the metric.
+	long events;    // Events simulated.
+	long skipped;   // Estimated events left unsimulated by the early stop.
+	int stopped;    // Whether the run stopped early.
+	sim_time_t t_stop; // Time the simulation ended.
+} conv_stat_t;
+
+/**
+ * Batch-means tracker for one metric. Detects the end of the warm-up
+ * transient with MSER and signals an early stop once the 95% confidence
+ * interval half-width of the truncated mean falls below args->converge
+ * times the mean.
+ */
+typedef struct {
+	const args_t* args;
+	int enabled;
+	conv_metric_t metric;
+	double batch[CONV_BATCHES]; // Closed batch means.
+	int k;                      // Closed batch count.
+	long batch_size;
+	double cur_sum; // Open batch.
+	long cur_n;
+	long observed;
+	long events;
+	long total_bursts; // Closed system: bursts in the workload.
+	int done;
+	double mean, half;
+	long truncated;
+} conv_t;
+
+/**
+ * Two-sided 95% Student t quantile with df degrees of freedom.
+ * @return The quantile, or NaN if df < 1.
+ */
+double t975(long df);
+
+void conv_init(conv_t* cv, const args_t* args, const process_t* procs);
+
+// conv_add() observation of a value that starts a new one.
+#define CONV_NEW (-1L)
+
+/**
+ * Record a value of metric: a new observation if obs is CONV_NEW, or else
+ * more of observation obs (e.g. the second wait of a preempted burst), which
+ * counts in the batch obs fell in even if that batch has since closed.
+ * @return The observation the value went to.
+ */
+long conv_add(conv_t* cv, conv_metric_t metric, double val, long obs);
+
+/**
+ * Count one more event to be simulated.
+ * @return Whether the estimate has converged and the run should stop instead.
+ */
+int conv_done(conv_t* cv);
+
+/**
+ * Fill out the final convergence report.
+ */
+void conv_finish(conv_t* cv, sim_time_t t, conv_stat_t* out);
+
+#endif // OPSYS_SIM_CONVERGE_H_
@@ -0,0 +1,238 @@
+#define _GNU_SOURCE // fopencookie()
+#include "cpusched.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "exp_rand.h"
+#include "process.h"
+#include "wcache.h"
+
+// Longest per-event line passed on whole; longer ones are cut.
+#define CPUSCHED_LINE_MAX 1024
+
+struct cpusched {
+	args_t args;
+	process_t* procs; // The workload; empty slots of an open system.
+	obs_t obs;          // The caller's observers.
+	cpusched_event_fn on_event;
+	void* event_data;
+	pthread_mutex_t lock; // Guards the results.
+	int* done;            // Whether each of algos[] has results.
+	algo_stat_t* stats;   // ... and those results.
+};
+
+/**
+ * Stream of a run's per-event output, cut into lines for the callback.
+ */
+typedef struct {
+	cpusched_event_fn fn;
+	void* data;
+	const char* algo;
+	char line[CPUSCHED_LINE_MAX];
+	size_t len;
+} cpusched_sink_t;
+
+static ssize_t cpusched_sink_write(void* cookie, const char* buf, size_t size) {
+	cpusched_sink_t* s = cookie;
+	for (size_t i = 0; i < size; ++i) {
+		if (buf[i] == '\n') {
+			s->line[s->len] = '\0';
+			s->fn(s->data, s->algo, s->line);
+			s->len = 0;
+		} else if (s->len < sizeof(s->line) - 1) {
+			s->line[s->len++] = buf[i];
+		}
+	}
+	return size;
+}
+
+void cpusched_config_init(args_t* cfg) {
+	args_init(cfg);
+	cfg->out = NULL;
+}
+
+int cpusched_config_parse(args_t* cfg, int argc, char* argv[], char* err,
+                          size_t err_len) {
+	if (parse_args_r(cfg, argc, argv, err, err_len) != 0) return CPUSCHED_EINVAL;
+	cfg->out = NULL;
+	return CPUSCHED_OK;
+}
+
+/**
+ * Create a context for options cfg, without its workload.
+ */
+static int cpusched_new(cpusched_t** out, const args_t* cfg, char* err,
+                        size_t err_len) {
+	*out = NULL;
+	cpusched_t* cs = calloc(1, sizeof(cpusched_t));
+	if (cs == NULL) return CPUSCHED_ENOMEM;
+	pthread_mutex_init(&cs->lock, NULL);
+	cs->args = *cfg;
+	if (args_finish(&cs->args, err, err_len) != 0) {
+		cpusched_free(cs);
+		return CPUSCHED_EINVAL;
+	}
+	if (cfg->obs) {
+		if (cfg->obs->n == OBS_MAX) {
+			snprintf(err, err_len, "At most %d observers, to leave room for the "
+			         "per-event output", OBS_MAX - 1);
+			cpusched_free(cs);
+			return CPUSCHED_EINVAL;
+		}
+		cs->obs = *cfg->obs;
+		cs->args.obs = NULL;
+	}
+	if (cs->args.reps > 0 || cs->args.estimate || cs->args.burst_log) {
+		snprintf(err, err_len,
+		         "Studies, estimates and burst logs are not run by a context");
+		cpusched_free(cs);
+		return CPUSCHED_EINVAL;
+	}
+
+	cs->done = calloc(n_algos, sizeof(int));
+	cs->stats = calloc(n_algos, sizeof(algo_stat_t));
+	if (cs->done == NULL || cs->stats == NULL) {
+		cpusched_free(cs);
+		return CPUSCHED_ENOMEM;
+	}
+
+	*out = cs;
+	return CPUSCHED_OK;
+}
+
+int cpusched_create(cpusched_t** out, const args_t* cfg, char* err,
+                    size_t err_len) {
+	int r = cpusched_new(out, cfg, err, err_len);
+	if (r != CPUSCHED_OK) return r;
+	cpusched_t* cs = *out;
+	if (cs->args.open_rate > 0) {
+		cs->procs = calloc(cs->args.n, sizeof(process_t));
+	} else {
+		exp_rng_t rng;
+		seed_exp_r(&rng, cs->args.seed);
+		cs->procs = wcache_generate(&cs->args, &rng);
+		assign_attributes(cs->procs, cs->args.n, &cs->args, &rng);
+	}
+	return CPUSCHED_OK;
+}
+
+int cpusched_derive(cpusched_t** out, cpusched_t* base, const args_t* cfg,
+                    char* err, size_t err_len) {
+	int r = cpusched_new(out, cfg, err, err_len);
+	if (r != CPUSCHED_OK) return r;
+	cpusched_t* cs = *out;
+	if (!cpusched_same_workload(base, &cs->args)) {
+		snprintf(err, err_len, "The options draw another workload");
+		cpusched_free(cs);
+		*out = NULL;
+		return CPUSCHED_EINVAL;
+	}
+	cs->procs = dup_process_array(base->procs, cs->args.n);
+	return CPUSCHED_OK;
+}
+
+int cpusched_same_workload(const cpusched_t* cs, const args_t* cfg) {
+	// The options are compared as contexts hold them, defaults filled in.
+	args_t c = *cfg;
+	if (args_finish(&c, NULL, 0) != 0) return 0;
+	const args_t* a = &cs->args;
+	return a->n == c.n && a->n_cpu == c.n_cpu && a->seed == c.seed &&
+	       a->lambda == c.lambda && a->exp_max == c.exp_max &&
+	       a->open_rate == c.open_rate && a->nice_cpu == c.nice_cpu &&
+	       a->nice_io == c.nice_io && a->tickets_cpu == c.tickets_cpu &&
+	       a->tickets_io == c.tickets_io && a->prio_levels == c.prio_levels &&
+	       a->groups == c.groups && a->deadline_slack == c.deadline_slack &&
+	       a->io_devices == c.io_devices;
+}
+
+
+void cpusched_on_event(cpusched_t* cs, cpusched_event_fn fn, void* data) {
+	cs->on_event = fn;
+	cs->event_data = data;
+}
+
+int cpusched_run(cpusched_t* cs, const char* algo, algo_stat_t* stat) {
+	const algo_t* a = algo_find(algo);
+	if (a == NULL || !algo_enabled(a, &cs->args)) return CPUSCHED_ENOALGO;
+
+	// Each run has its own options, output and copy of the workload.
+	args_t args = cs->args;
+	cpusched_sink_t* sink = NULL;
+	if (cs->on_event) {
+		sink = calloc(1, sizeof(cpusched_sink_t));
+		if (sink == NULL) return CPUSCHED_ENOMEM;
+		*sink = (cpusched_sink_t){
+		    .fn = cs->on_event, .data = cs->event_data, .algo = a->name};
+		args.out = fopencookie(sink, "w", (cookie_io_functions_t){
+		                                      .write = cpusched_sink_write});
+		if (args.out == NULL) {
+			free(sink);
+			return CPUSCHED_ENOMEM;
+		}
+		setvbuf(args.out, NULL, _IOLBF, 0);
+	}
+	obs_t obs = cs->obs;
+	obs_text_t text = {.out = args.out, .window = args.print_window};
+	if (args.out && !args.quiet) obs_add(&obs, OBS_ALL, obs_text, &text);
+	args.obs = obs.n > 0 ? &obs : NULL;
+
+	process_t* procs = dup_process_array(cs->procs, args.n);
+	algo_stat_t result = a->run(&args, procs);
+	free_process_array(procs, args.n);
+	free(procs);
+	if (sink) {
+		fclose(args.out);
+		free(sink);
+	}
+	if (result.error) return CPUSCHED_ERUN;
+
+	pthread_mutex_lock(&cs->lock);
+	cs->stats[a - algos] = result;
+	cs->done[a - algos] = 1;
+	pthread_mutex_unlock(&cs->lock);
+	if (stat) *stat = result;
+	return CPUSCHED_OK;
+}
+
+int cpusched_stats(cpusched_t* cs, const char* algo, algo_stat_t* stat) {
+	const algo_t* a = algo_find(algo);
+	if (a == NULL) return CPUSCHED_ENOALGO;
+
+	pthread_mutex_lock(&cs->lock);
+	int done = cs->done[a - algos];
+	if (done) *stat = cs->stats[a - algos];
+	pthread_mutex_unlock(&cs->lock);
+	return done ? CPUSCHED_OK : CPUSCHED_ENORESULT;
+}
+
+void cpusched_free(cpusched_t* cs) {
+	if (cs == NULL) return;
+	if (cs->procs) {
+		free_process_array(cs->procs, cs->args.n);
+		free(cs->procs);
+	}
+	pthread_mutex_destroy(&cs->lock);
+	free(cs->done);
+	free(cs->stats);
+	free(cs);
+}
+
+const char* cpusched_strerror(int error) {
+	switch (error) {
+	case CPUSCHED_OK:
+		return "Success";
+	case CPUSCHED_EINVAL:
+		return "Invalid options";
+	case CPUSCHED_ENOALGO:
+		return "No such algorithm with these options";
+	case CPUSCHED_ENORESULT:
+		return "The algorithm has not been run";
+	case CPUSCHED_ERUN:
+		return "The run failed";
+	case CPUSCHED_ENOMEM:
+		return "Out of memory";
+	default:
+		return "Unknown error";
+	}
+}
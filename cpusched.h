@@ -0,0 +1,107 @@
+#ifndef OPSYS_SIM_CPUSCHED_H_
+#define OPSYS_SIM_CPUSCHED_H_
+
+#include <stddef.h>
+#include "algo.h"
+#include "args.h"
+
+/**
+ * Library interface of the simulator (libcpusched): every .c file but
+ * main.c, linked with -lm -lpthread.
+ *
+ * A context holds a workload, drawn from its options when it is created,
+ * and the results of the algorithms run on it. No state is kept outside of
+ * contexts and nothing exits, so any number of contexts can be used from
+ * any number of threads, and one context can run several algorithms from
+ * several threads at once.
+ */
+typedef struct cpusched cpusched_t;
+
+// What the functions below return.
+enum cpusched_error {
+	CPUSCHED_OK = 0,
+	CPUSCHED_EINVAL = -1,    // The options do not make sense.
+	CPUSCHED_ENOALGO = -2,   // No such algorithm, or not with these options.
+	CPUSCHED_ENORESULT = -3, // The algorithm has not been run yet.
+	CPUSCHED_ERUN = -4,      // The run failed, e.g. its checkpoint was corrupt.
+	CPUSCHED_ENOMEM = -5,    // Out of memory.
+};
+
+/**
+ * Called with each line of the per-event output of algorithm algo, without
+ * its newline, from the thread running it.
+ */
+typedef void (*cpusched_event_fn)(void* data, const char* algo,
+                                  const char* line);
+
+/**
+ * Start a configuration: every option at its default, with no per-event
+ * output. Set the required options (n, n_cpu, seed, lambda, exp_max, Tcs,
+ * alpha, Tslice) and any others before creating a context from it.
+ */
+void cpusched_config_init(args_t* cfg);
+
+/**
+ * Fill in cfg from a command line, as the simulator takes it; argv[0] is
+ * skipped. The per-event output is off unless cfg->out is set afterwards.
+ * @return CPUSCHED_OK, or CPUSCHED_EINVAL with the reason in err, of size
+ * err_len (err may be NULL).
+ */
+int cpusched_config_parse(args_t* cfg, int argc, char* argv[], char* err,
+                          size_t err_len);
+
+/**
+ * Create a context for the options in cfg, which is copied, and draw its
+ * workload. Studies (reps), estimates and burst logs are not run through a
+ * context; a burst log is kept by adding burstlog_event() to cfg->obs.
+ * The observers in cfg->obs, if any, are copied too and called with the
+ * events of every run, from the thread running it.
+ * @return CPUSCHED_OK, or an error with the reason in err, of size err_len
+ * (err may be NULL).
+ */
+int cpusched_create(cpusched_t** cs, const args_t* cfg, char* err,
+                    size_t err_len);
+
+/**
+ * Create a context for the options in cfg, as cpusched_create() does, on a
+ * copy of the workload of base instead of drawing one. cfg must draw the
+ * same workload as base (see cpusched_same_workload()).
+ * @return CPUSCHED_OK, or an error with the reason in err, of size err_len
+ * (err may be NULL).
+ */
+int cpusched_derive(cpusched_t** cs, cpusched_t* base, const args_t* cfg,
+                    char* err, size_t err_len);
+
+/**
+ * @return Whether the options in cfg draw the same workload as those of cs:
+ * the same n, n_cpu, seed, lambda, exp_max and open_rate, and the same
+ * options behind the attributes of the processes (nice levels, tickets,
+ * priority levels, groups, deadline slack and I/O devices).
+ */
+int cpusched_same_workload(const cpusched_t* cs, const args_t* cfg);
+
+/**
+ * Stream the per-event output of later runs to fn, in place of cfg->out.
+ * Not to be called while cs is running an algorithm.
+ */
+void cpusched_on_event(cpusched_t* cs, cpusched_event_fn fn, void* data);
+
+/**
+ * Run algorithm algo (a name as in the results, such as "RR") on a copy of
+ * the workload, and keep its results. stat, if not NULL, receives them.
+ */
+int cpusched_run(cpusched_t* cs, const char* algo, algo_stat_t* stat);
+
+/**
+ * Fetch the results of the last run of algorithm algo.
+ */
+int cpusched_stats(cpusched_t* cs, const char* algo, algo_stat_t* stat);
+
+void cpusched_free(cpusched_t* cs);
+
+/**
+ * @return A description of error code error.
+ */
+const char* cpusched_strerror(int error);
+
+#endif // OPSYS_SIM_CPUSCHED_H_
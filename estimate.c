@@ -0,0 +1,223 @@
+#include "estimate.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "process.h"
+
+// Burst lengths past the point where the exponential's tail falls below this
+// are left out of the distribution.
+#define EST_TAIL 1e-12
+// The fixed point stops once burst rates change by less than this fraction.
+#define EST_TOLERANCE 1e-9
+#define EST_ITERATIONS 10000
+
+enum est_model { EST_FCFS = 0, EST_PS, EST_SJF, EST_SRPT };
+
+static const struct {
+	const char* algo;
+	enum est_model model;
+	const char* name;
+} est_models[] = {
+    {"FCFS", EST_FCFS, "M/G/1 FCFS, Pollaczek-Khinchine"},
+    {"RR", EST_PS, "M/G/1 processor sharing"},
+    {"SJF", EST_SJF, "M/G/1 non-preemptive shortest job first"},
+    {"SRT", EST_SRPT, "M/G/1 shortest remaining processing time"},
+    {"SJF-ORACLE", EST_SJF, "M/G/1 non-preemptive shortest job first"},
+    {"SRT-ORACLE", EST_SRPT, "M/G/1 shortest remaining processing time"},
+};
+
+/**
+ * The workload as the CPU sees it. Class 0 is I/O-bound, class 1 CPU-bound.
+ */
+typedef struct {
+	int kmax;        // Longest burst drawn, before scaling.
+	double* p;       // p[k]: probability of a burst of k ms, k = 1..kmax.
+	int scale[2];    // CPU bursts of each class are scaled by this.
+	double n[2];     // Processes of each class.
+	double burst[2]; // Mean CPU burst of each class.
+	double io[2];    // Mean I/O time per CPU burst of each class.
+	int Tcs;
+	int smax;        // Longest CPU occupancy: burst and context switch.
+	double* rate;    // rate[s]: bursts per ms occupying the CPU for s ms.
+	double* wait;    // wait[s]: mean wait of those bursts.
+} est_work_t;
+
+/**
+ * Build the distributions generate_bursts() draws from.
+ */
+static void est_work_init(est_work_t* w, const args_t* args) {
+	double q = exp(-args->lambda); // P(burst > k) / P(burst > k - 1)
+	w->kmax = args->exp_max;
+	if (q > 0 && q < 1) {
+		double k_tail = 1 + log(EST_TAIL) / log(q);
+		if (k_tail < w->kmax) w->kmax = k_tail;
+	}
+	if (w->kmax < 1) w->kmax = 1;
+
+	w->p = calloc(w->kmax + 1, sizeof(double));
+	double total = 0, tail = 1;
+	for (int k = 1; k <= w->kmax; ++k) {
+		w->p[k] = tail * (1 - q);
+		tail *= q;
+		total += w->p[k];
+	}
+
+	// Mean burst count is (MAX_BURSTS + 1) / 2; every burst but a process's
+	// last is followed by I/O.
+	double bursts = (MAX_BURSTS + 1) / 2.0;
+	w->scale[0] = 1;
+	w->scale[1] = 4;
+	w->n[0] = args->n - args->n_cpu;
+	w->n[1] = args->n_cpu;
+	for (int c = 0; c < 2; ++c) w->burst[c] = w->io[c] = 0;
+	for (int k = 1; k <= w->kmax; ++k) {
+		w->p[k] /= total;
+		w->burst[0] += w->p[k] * k;
+		w->burst[1] += w->p[k] * 4 * k;
+		w->io[0] += w->p[k] * 10 * k;
+		w->io[1] += w->p[k] * (10 * k / 8);
+	}
+	for (int c = 0; c < 2; ++c) w->io[c] *= (bursts - 1) / bursts;
+
+	w->Tcs = args->Tcs;
+	w->smax = 4 * w->kmax + w->Tcs;
+	w->rate = calloc(w->smax + 1, sizeof(double));
+	w->wait = calloc(w->smax + 1, sizeof(double));
+}
+
+static void est_work_free(est_work_t* w) {
+	free(w->p);
+	free(w->rate);
+	free(w->wait);
+}
+
+/**
+ * Fill w->wait for the burst rates in w->rate, by the model's M/G/1 formula.
+ * Sizes the CPU cannot keep up with wait forever.
+ */
+static void est_wait(est_work_t* w, enum est_model model) {
+	double lam = 0, rho = 0, m2 = 0;
+	for (int s = 0; s <= w->smax; ++s) {
+		lam += w->rate[s];
+		rho += w->rate[s] * s;
+		m2 += w->rate[s] * s * s;
+	}
+
+	switch (model) {
+	case EST_FCFS:
+		for (int s = 0; s <= w->smax; ++s)
+			w->wait[s] = rho < 1 ? m2 / (2 * (1 - rho)) : INFINITY;
+		break;
+	case EST_PS:
+		for (int s = 0; s <= w->smax; ++s)
+			w->wait[s] = rho < 1 ? s * rho / (1 - rho) : INFINITY;
+		break;
+	case EST_SJF: {
+		// Bursts no longer than s go first: sigma is their load.
+		double sigma = 0;
+		for (int s = 0; s <= w->smax; ++s) {
+			double before = sigma;
+			sigma += w->rate[s] * s;
+			w->wait[s] = sigma < 1 ? m2 / 2 / ((1 - before) * (1 - sigma)) : INFINITY;
+		}
+		break;
+	}
+	case EST_SRPT: {
+		// A burst of s ms waits for the shorter ones and the residue of the
+		// longer ones, then is slowed down by those shorter than what remains.
+		double sigma = 0, m2_le = 0, lam_le = 0, residence = 0;
+		for (int s = 0; s <= w->smax; ++s) {
+			if (s > 0) residence += sigma < 1 ? 1 / (1 - sigma) : INFINITY;
+			sigma += w->rate[s] * s;
+			m2_le += w->rate[s] * s * s;
+			lam_le += w->rate[s];
+			double queued = (m2_le + (double) s * s * (lam - lam_le)) /
+			                (2 * (1 - sigma) * (1 - sigma));
+			w->wait[s] = sigma < 1 ? queued + residence - s : INFINITY;
+		}
+		break;
+	}
+	}
+}
+
+int estimate(const args_t* args, const char* name, est_stat_t* out) {
+	int m = 0, n_models = sizeof(est_models) / sizeof(est_models[0]);
+	while (m < n_models && strcmp(est_models[m].algo, name) != 0) ++m;
+	if (m == n_models) return 0;
+
+	est_work_t w;
+	est_work_init(&w, args);
+
+	// Start from bursts that never wait, and damp the steps by half each time
+	// they overshoot.
+	double lam[2], wait[2] = {0, 0}, step = 0.5, last_d = 0;
+	for (int c = 0; c < 2; ++c)
+		lam[c] = w.n[c] / (w.io[c] + w.burst[c] + w.Tcs);
+	for (int it = 0; it < EST_ITERATIONS; ++it) {
+		memset(w.rate, 0, (w.smax + 1) * sizeof(double));
+		for (int c = 0; c < 2; ++c) {
+			for (int k = 1; k <= w.kmax; ++k)
+				w.rate[w.scale[c] * k + w.Tcs] += lam[c] * w.p[k];
+		}
+		est_wait(&w, est_models[m].model);
+
+		double next[2], d = 0, sum = 0;
+		for (int c = 0; c < 2; ++c) {
+			wait[c] = 0;
+			for (int k = 1; k <= w.kmax; ++k)
+				wait[c] += w.p[k] * w.wait[w.scale[c] * k + w.Tcs];
+			next[c] = w.n[c] / (w.io[c] + wait[c] + w.burst[c] + w.Tcs);
+			d += next[c] - lam[c];
+			sum += lam[c];
+		}
+		if (fabs(d) <= EST_TOLERANCE * sum) break;
+		if (d * last_d < 0) step /= 2;
+		last_d = d;
+		for (int c = 0; c < 2; ++c) lam[c] += step * (next[c] - lam[c]);
+	}
+
+	*out = (est_stat_t){.model = est_models[m].name};
+	double total = lam[0] + lam[1];
+	for (int c = 0; c < 2; ++c) {
+		out->cpu_util += lam[c] * w.burst[c] * 100.0;
+		out->load += lam[c] * (w.burst[c] + w.Tcs);
+		out->t_wait.avg += lam[c] / total * wait[c];
+		out->t_turn.avg += lam[c] / total * (wait[c] + w.burst[c] + w.Tcs);
+	}
+	// A class without processes reports 0, as the simulation does.
+	if (w.n[0] > 0) {
+		out->t_wait.io_avg = wait[0];
+		out->t_turn.io_avg = wait[0] + w.burst[0] + w.Tcs;
+	}
+	if (w.n[1] > 0) {
+		out->t_wait.cpu_avg = wait[1];
+		out->t_turn.cpu_avg = wait[1] + w.burst[1] + w.Tcs;
+	}
+
+	est_work_free(&w);
+	return 1;
+}
+
+/**
+ * Print value in unit, and its error relative to sim if there is one.
+ */
+static void print_est_value(FILE* stream, double value, const char* unit,
+                            const double* sim) {
+	fprintf(stream, "%.3f%s", value, unit);
+	if (sim) fprintf(stream, " (error %+.3f%%)", (value - *sim) / *sim * 100.0);
+}
+
+void print_estimate(FILE* stream, const est_stat_t* est,
+                    const algo_stat_t* sim) {
+	fprintf(stream, "-- estimate by %s at load %.3f:\n", est->model, est->load);
+	fprintf(stream, "-- estimated CPU utilization: ");
+	print_est_value(stream, est->cpu_util, "%", sim ? &sim->cpu_util : NULL);
+	fprintf(stream, "\n-- estimated average wait time: ");
+	print_est_value(stream, est->t_wait.avg, " ms", sim ? &sim->t_wait.avg : NULL);
+	fprintf(stream, " (%.3f ms/%.3f ms)\n", est->t_wait.cpu_avg,
+	        est->t_wait.io_avg);
+	fprintf(stream, "-- estimated average turnaround time: ");
+	print_est_value(stream, est->t_turn.avg, " ms", sim ? &sim->t_turn.avg : NULL);
+	fprintf(stream, " (%.3f ms/%.3f ms)\n", est->t_turn.cpu_avg,
+	        est->t_turn.io_avg);
+}
@@ -0,0 +1,41 @@
+#ifndef OPSYS_SIM_ESTIMATE_H_
+#define OPSYS_SIM_ESTIMATE_H_
+
+#include <stdio.h>
+#include "algo.h"
+#include "args.h"
+
+typedef struct {
+	const char* model; // Queueing model behind the estimate
+	double cpu_util;   // Estimated CPU utilization, in percent
+	sim_stat_t t_wait; // Estimated wait time
+	sim_stat_t t_turn; // Estimated turnaround time
+	double load;       // Offered load, with context switches
+} est_stat_t;
+
+/**
+ * Estimate the results of algorithm name from the workload parameters alone,
+ * without simulating. Bursts and I/O are distributed as generate_bursts()
+ * draws them, and each class cycles through its CPU bursts and I/O. The
+ * closed system is solved as a fixed point: the CPU is an M/G/1 queue fed by
+ * the bursts of all processes, and each process's burst rate is one over its
+ * cycle of I/O and turnaround.
+ *
+ * Models:
+ * - FCFS: Pollaczek-Khinchine mean wait.
+ * - RR: processor sharing, the limit of a vanishing time slice.
+ * - SJF: non-preemptive priority by burst length.
+ * - SRT: shortest remaining processing time.
+ * SJF and SRT are modelled with the true bursts known, as their oracles are.
+ * @return Whether name has a model; if not, *out is untouched.
+ */
+int estimate(const args_t* args, const char* name, est_stat_t* out);
+
+/**
+ * Print estimate est, and its relative error against the simulated results
+ * sim if they are given.
+ */
+void print_estimate(FILE* stream, const est_stat_t* est,
+                    const algo_stat_t* sim);
+
+#endif // OPSYS_SIM_ESTIMATE_H_
@@ -1,24 +1,41 @@
 #include "exp_rand.h"
 #include <math.h>
-#include <stdlib.h>
+#include <stdint.h>
 
-void seed_exp(unsigned int seed) {
-	srand48(seed); // Correctly seed the random number generator
+void seed_exp_r(exp_rng_t* rng, unsigned int seed) {
+	// Same state layout srand48() produces.
+	rng->xsubi[0] = 0x330E;
+	rng->xsubi[1] = seed & 0xFFFF;
+	rng->xsubi[2] = (seed >> 16) & 0xFFFF;
+	rng->antithetic = 0;
 }
 
-double next_exp(double lambda) {
-	double u = drand48();    // Generate U, a uniform random number in [0, 1)
-	return -log(u) / lambda; // Return an exponentially distributed random number
+double next_unif_r(exp_rng_t* rng) {
+	// The erand48() step, done here because glibc's erand48() shares its
+	// multiplier state between threads.
+	unsigned short* x = rng->xsubi;
+	uint64_t s = (uint64_t) x[2] << 32 | (uint64_t) x[1] << 16 | x[0];
+	s = (s * 0x5DEECE66DULL + 0xB) & 0xFFFFFFFFFFFFULL;
+	x[0] = s & 0xFFFF;
+	x[1] = (s >> 16) & 0xFFFF;
+	x[2] = (s >> 32) & 0xFFFF;
+	double u = ldexp((double) s, -48);
+	return rng->antithetic ? 1.0 - u : u;
 }
 
-double ceil_exp(double lambda, double exp_max) {
-	double r = ceil(next_exp(lambda));
-	while (r > exp_max) { r = ceil(next_exp(lambda)); }
+double next_exp_r(exp_rng_t* rng, double lambda) {
+	double u = next_unif_r(rng);
+	return -log(u) / lambda;
+}
+
+double ceil_exp_r(exp_rng_t* rng, double lambda, double exp_max) {
+	double r = ceil(next_exp_r(rng, lambda));
+	while (r > exp_max) { r = ceil(next_exp_r(rng, lambda)); }
 	return r;
 }
 
-double floor_exp(double lambda, double exp_max) {
-	double r = floor(next_exp(lambda));
-	while (r > exp_max) { r = floor(next_exp(lambda)); }
+double floor_exp_r(exp_rng_t* rng, double lambda, double exp_max) {
+	double r = floor(next_exp_r(rng, lambda));
+	while (r > exp_max) { r = floor(next_exp_r(rng, lambda)); }
 	return r;
 }
@@ -1,13 +1,24 @@
 #ifndef OPSYS_SIM_EXP_RAND_H_
 #define OPSYS_SIM_EXP_RAND_H_
 
-void seed_exp(unsigned int seed);
-double next_exp(double lambda);
+/**
+ * Independent drand48-compatible random stream. Seeding one with
+ * seed_exp_r() yields exactly the sequence srand48()/drand48() would.
+ */
+typedef struct {
+	unsigned short xsubi[3];
+	int antithetic; // Draw 1 - U in place of each uniform U.
+} exp_rng_t;
 
-// Generate ceil(next_exp(lambda)), skipping values > exp_max.
-double ceil_exp(double lambda, double exp_max);
+// Seeding clears the antithetic flag.
+void seed_exp_r(exp_rng_t* rng, unsigned int seed);
+double next_unif_r(exp_rng_t* rng);
+double next_exp_r(exp_rng_t* rng, double lambda);
 
-// Generate floor(next_exp(lambda)), skipping values > exp_max.
-double floor_exp(double lambda, double exp_max);
+// Generate ceil(next_exp_r(rng, lambda)), skipping values > exp_max.
+double ceil_exp_r(exp_rng_t* rng, double lambda, double exp_max);
+
+// Generate floor(next_exp_r(rng, lambda)), skipping values > exp_max.
+double floor_exp_r(exp_rng_t* rng, double lambda, double exp_max);
 
 #endif // OPSYS_SIM_EXP_RAND_H_
@@ -0,0 +1,74 @@
+#include "fenwick.h"
+#include <stdlib.h>
+
+struct fenwick {
+	int n;
+	int top;    // Highest power of two <= n.
+	long* tree; // 1-based: tree[i] sums slots (i - lowbit(i), i].
+	long total;
+};
+
+fenwick_t* make_fenwick(int n) {
+	fenwick_t* f = malloc(sizeof(fenwick_t));
+	f->n = n;
+	f->top = 1;
+	while (f->top * 2 <= n) f->top *= 2;
+	f->tree = calloc(n + 1, sizeof(long));
+	f->total = 0;
+	return f;
+}
+
+void fenwick_grow(fenwick_t* f, int n) {
+	long* w = malloc(f->n * sizeof(long));
+	for (int i = 0; i < f->n; ++i) w[i] = fenwick_get(f, i);
+	int old = f->n;
+	f->n = n;
+	while (f->top * 2 <= n) f->top *= 2;
+	free(f->tree);
+	f->tree = calloc(n + 1, sizeof(long));
+	f->total = 0;
+	for (int i = 0; i < old; ++i)
+		if (w[i]) fenwick_add(f, i, w[i]);
+	free(w);
+}
+
+void free_fenwick(fenwick_t** f) {
+	free((*f)->tree);
+	free(*f);
+	*f = NULL;
+}
+
+int fenwick_size(const fenwick_t* f) {
+	return f->n;
+}
+
+void fenwick_add(fenwick_t* f, int i, long delta) {
+	f->total += delta;
+	for (++i; i <= f->n; i += i & -i) f->tree[i] += delta;
+}
+
+long fenwick_get(const fenwick_t* f, int i) {
+	// Sum of (i, i + 1] is the tree node minus the nodes it covers.
+	long w = f->tree[i + 1];
+	for (int j = i, stop = (i + 1) - ((i + 1) & -(i + 1)); j > stop; j -= j & -j)
+		w -= f->tree[j];
+	return w;
+}
+
+long fenwick_total(const fenwick_t* f) {
+	return f->total;
+}
+
+int fenwick_find(const fenwick_t* f, long r) {
+	if (r < 0 || r >= f->total) return -1;
+
+	// Descend from the largest power of two, keeping the prefix sum <= r.
+	int pos = 0;
+	for (int step = f->top; step > 0; step /= 2) {
+		if (pos + step <= f->n && f->tree[pos + step] <= r) {
+			pos += step;
+			r -= f->tree[pos];
+		}
+	}
+	return pos; // Slot pos (0-based) is the first whose prefix sum exceeds r.
+}
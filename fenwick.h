@@ -0,0 +1,52 @@
+#include <stddef.h>
+
+#ifndef OPSYS_SIM_FENWICK_H_
+#define OPSYS_SIM_FENWICK_H_
+
+/**
+ * Fenwick (binary indexed) tree of non-negative weights, one per slot. Updates,
+ * totals and weighted draws are O(log n).
+ */
+typedef struct fenwick fenwick_t;
+
+/**
+ * Allocate a new tree of n slots, all of weight 0.
+ */
+fenwick_t* make_fenwick(int n);
+
+/**
+ * Grow the tree to n slots, keeping the weights; the new slots weigh 0.
+ */
+void fenwick_grow(fenwick_t* f, int n);
+
+/**
+ * Free the memory associated with the tree and set f to NULL.
+ */
+void free_fenwick(fenwick_t** f);
+
+int fenwick_size(const fenwick_t* f);
+
+/**
+ * Add delta to the weight of slot i.
+ */
+void fenwick_add(fenwick_t* f, int i, long delta);
+
+/**
+ * @returns The weight of slot i.
+ */
+long fenwick_get(const fenwick_t* f, int i);
+
+/**
+ * @returns The total weight of all slots.
+ */
+long fenwick_total(const fenwick_t* f);
+
+/**
+ * Find the slot that owns point r of the weight line, so that a uniform r in
+ * [0, fenwick_total()) picks each slot with probability proportional to its
+ * weight.
+ * @returns The slot, or -1 if r is out of range.
+ */
+int fenwick_find(const fenwick_t* f, long r);
+
+#endif // OPSYS_SIM_FENWICK_H_
@@ -3,14 +3,17 @@
 algo="$1"
 
 case "$algo" in
-FCFS|SJF|SRT|RR) ;;
+FCFS|SJF|SRT|RR|MLFQ|CFS|EDF|EDF-NP|STRIDE|LOTTERY|PRIO|GROUP|MC-FCFS|MC-SJF|MC-RR|\
+MC-FCFS-AFF|MC-SJF-AFF|MC-RR-AFF|SJF-ORACLE|SRT-ORACLE) ;;
 *) echo "USAGE: $0 ALGO"
-echo "ALGO may be FCFS, SJF, SRT, or RR."
+echo "ALGO may be FCFS, SJF, SRT, RR, MLFQ, CFS, EDF, EDF-NP,"
+echo "STRIDE, LOTTERY, PRIO, GROUP, MC-FCFS, MC-SJF, MC-RR, MC-FCFS-AFF,"
+echo "MC-SJF-AFF, MC-RR-AFF, SJF-ORACLE, or SRT-ORACLE."
 exit 1
 ;;
 esac
 
 awk "BEGIN { ok = 0 }
-/started for $algo/ { ok = 1 }
+/started for $algo / { ok = 1 }
 ok == 1 {print}
-/ended for $algo/ {ok = 0}"
+/ended for $algo / {ok = 0}"
@@ -0,0 +1,15 @@
+#ifndef OPSYS_SIM_HASH_H_
+#define OPSYS_SIM_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Starting value of an FNV-1a hash.
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+/**
+ * Continue 64-bit FNV-1a hash h over the len bytes at data.
+ */
+uint64_t fnv1a(uint64_t h, const void* data, size_t len);
+
+#endif // OPSYS_SIM_HASH_H_
@@ -0,0 +1,47 @@
+#include "hist.h"
+#include <math.h>
+
+// Bucket index of v.
+static int hist_bucket(unsigned long long v) {
+	if (v < (1ULL << HIST_LINEAR_BITS)) return v;
+
+	int e = 63 - __builtin_clzll(v); // floor(log2(v)) >= HIST_LINEAR_BITS
+	if (e >= HIST_MAX_BITS) return HIST_BUCKETS - 1;
+	int sub = (v >> (e - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1);
+	return (1 << HIST_LINEAR_BITS) + ((e - HIST_LINEAR_BITS) << HIST_SUB_BITS) +
+	       sub;
+}
+
+// Upper bound of the values in bucket b.
+static double hist_bucket_max(int b) {
+	if (b < (1 << HIST_LINEAR_BITS)) return b;
+
+	b -= 1 << HIST_LINEAR_BITS;
+	int e = (b >> HIST_SUB_BITS) + HIST_LINEAR_BITS;
+	int sub = b & ((1 << HIST_SUB_BITS) - 1);
+	return ldexp((1 << HIST_SUB_BITS) + sub + 1, e - HIST_SUB_BITS) - 1;
+}
+
+void hist_add(hist_t* h, double v) {
+	if (v < 0) v = 0;
+	++h->counts[hist_bucket(ceil(v))];
+	++h->n;
+	h->sum += v;
+	if (v > h->max) h->max = v;
+}
+
+double hist_percentile(const hist_t* h, double p) {
+	if (h->n == 0) return 0.0;
+
+	long rank = ceil(p / 100.0 * h->n);
+	if (rank < 1) rank = 1;
+	long seen = 0;
+	for (int b = 0; b < HIST_BUCKETS; ++b) {
+		seen += h->counts[b];
+		if (seen >= rank) {
+			double v = hist_bucket_max(b);
+			return v < h->max ? v : h->max;
+		}
+	}
+	return h->max;
+}
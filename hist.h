@@ -0,0 +1,35 @@
+#ifndef OPSYS_SIM_HIST_H_
+#define OPSYS_SIM_HIST_H_
+
+// Values below 2^HIST_LINEAR_BITS ms get one bucket each; above that each
+// power of two is split into 2^HIST_SUB_BITS buckets (about 3% resolution).
+#define HIST_LINEAR_BITS 6
+#define HIST_SUB_BITS 5
+#define HIST_MAX_BITS 40
+#define HIST_BUCKETS \
+	((1 << HIST_LINEAR_BITS) + \
+	 (HIST_MAX_BITS - HIST_LINEAR_BITS) * (1 << HIST_SUB_BITS))
+
+/**
+ * Log-linear histogram of non-negative times in milliseconds, for
+ * percentiles in constant memory.
+ */
+typedef struct {
+	long counts[HIST_BUCKETS];
+	long n;
+	double sum;
+	double max;
+} hist_t;
+
+/**
+ * Record value v. Negative values are recorded as 0.
+ */
+void hist_add(hist_t* h, double v);
+
+/**
+ * @return The p-th percentile (0 < p <= 100) to within one bucket, or 0 if
+ * the histogram is empty.
+ */
+double hist_percentile(const hist_t* h, double p);
+
+#endif // OPSYS_SIM_HIST_H_
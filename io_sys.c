@@ -0,0 +1,135 @@
+#include "io_sys.h"
+#include <stdlib.h>
+
+typedef struct {
+	void* v;            // Engine item.
+	sim_time_t t_ready; // When it may start.
+	unsigned len;       // Service time.
+	long seq;           // Submission order.
+} io_req_t;
+
+static int io_cmp_fifo(const void* lhs, const void* rhs) {
+	const io_req_t *l = lhs, *r = rhs;
+	return l->seq < r->seq ? -1 : (l->seq > r->seq);
+}
+
+static int io_cmp_shortest(const void* lhs, const void* rhs) {
+	const io_req_t *l = lhs, *r = rhs;
+	if (l->len != r->len) return l->len < r->len ? -1 : 1;
+	return io_cmp_fifo(lhs, rhs);
+}
+
+void io_sys_init(io_sys_t* io, const args_t* args) {
+	*io = (io_sys_t){.enabled = args->io_devices > 0, .args = args};
+	for (int d = 0; d < args->io_devices; ++d) {
+		io->dev[d].units = args->io_units[d];
+		io->dev[d].Q = make_queue();
+		queue_set_cmp(io->dev[d].Q, args->io_discipline[d] == IO_SHORTEST
+		                                ? io_cmp_shortest
+		                                : io_cmp_fifo);
+	}
+}
+
+void io_sys_free(io_sys_t* io) {
+	for (int d = 0; d < io->args->io_devices; ++d) {
+		for (io_req_t* r = queue_pop(io->dev[d].Q); r; r = queue_pop(io->dev[d].Q)) {
+			free(r->v);
+			free(r);
+		}
+		free_queue(&io->dev[d].Q);
+	}
+}
+
+/**
+ * Start request v of len ms on a free unit of dev.
+ * @return When it completes.
+ */
+static sim_time_t io_start(io_sys_t* io, io_dev_t* dev, void* v,
+                         sim_time_t t_ready, unsigned len, sim_time_t t) {
+	sim_time_t t_start = t > t_ready ? t : t_ready;
+	int k = dev->serving++;
+	dev->v[k] = v;
+	dev->t_start[k] = t_start;
+	dev->t_done[k] = t_start + len;
+
+	if (t_start >= io->args->warmup) {
+		double delay = t_start - t_ready;
+		dev->delay += delay;
+		if (delay > dev->delay_max) dev->delay_max = delay;
+		++dev->requests;
+	}
+	return dev->t_done[k];
+}
+
+int io_sys_submit(io_sys_t* io, int d, void* v, sim_time_t t_ready, unsigned len,
+                  sim_time_t* t_done) {
+	if (!io->enabled) {
+		*t_done = t_ready + len;
+		return 1;
+	}
+
+	io_dev_t* dev = &io->dev[d];
+	if (dev->serving < dev->units) {
+		*t_done = io_start(io, dev, v, t_ready, len, t_ready);
+		return 1;
+	}
+
+	io_req_t* r = malloc(sizeof(io_req_t));
+	*r = (io_req_t){.v = v, .t_ready = t_ready, .len = len, .seq = io->seq++};
+	queue_push(dev->Q, r);
+	if ((int) queue_size(dev->Q) > dev->queue_max) dev->queue_max = queue_size(dev->Q);
+	return 0;
+}
+
+/**
+ * Credit dev with the service of request k up to time t.
+ */
+static void io_credit(io_sys_t* io, io_dev_t* dev, int k, sim_time_t t) {
+	sim_time_t from = dev->t_start[k];
+	if (from < io->args->warmup) from = io->args->warmup;
+	if (t > from) dev->busy += t - from;
+}
+
+void* io_sys_complete(io_sys_t* io, int d, void* v, sim_time_t t,
+                      sim_time_t* t_done) {
+	if (!io->enabled) return NULL;
+
+	io_dev_t* dev = &io->dev[d];
+	for (int k = 0; k < dev->serving; ++k) {
+		if (dev->v[k] != v) continue;
+		io_credit(io, dev, k, t);
+		--dev->serving;
+		dev->v[k] = dev->v[dev->serving];
+		dev->t_start[k] = dev->t_start[dev->serving];
+		dev->t_done[k] = dev->t_done[dev->serving];
+		break;
+	}
+
+	io_req_t* r = queue_pop(dev->Q);
+	if (r == NULL) return NULL;
+	void* next = r->v;
+	*t_done = io_start(io, dev, next, r->t_ready, r->len, t);
+	free(r);
+	return next;
+}
+
+void io_sys_finish(io_sys_t* io, sim_time_t t, sim_time_t t_begin,
+                   io_stat_t* out) {
+	*out = (io_stat_t){.n = io->args->io_devices};
+	for (int d = 0; d < out->n; ++d) {
+		io_dev_t* dev = &io->dev[d];
+		// Requests still in service when the run ended.
+		for (int k = 0; k < dev->serving; ++k) {
+			io_credit(io, dev, k, dev->t_done[k] < t ? dev->t_done[k] : t);
+		}
+		dev->serving = 0;
+
+		out->units[d] = dev->units;
+		out->discipline[d] = io->args->io_discipline[d];
+		out->util[d] = dev->busy / ((double) (t - t_begin) * dev->units) * 100.0;
+		out->delay[d] = dev->requests > 0 ? dev->delay / dev->requests : 0.0;
+		out->delay_max[d] = dev->delay_max;
+		out->requests[d] = dev->requests;
+		out->queue_max[d] = dev->queue_max;
+	}
+}
@@ -0,0 +1,82 @@
+#ifndef OPSYS_SIM_IO_SYS_H_
+#define OPSYS_SIM_IO_SYS_H_
+
+#include "args.h"
+#include "queue.h"
+
+typedef struct {
+	int n;                         // Devices (0 = I/O never waits)
+	int units[IO_DEV_MAX];         // Requests each device serves at once
+	int discipline[IO_DEV_MAX];    // enum io_discipline
+	double util[IO_DEV_MAX];       // Average utilization of a unit
+	double delay[IO_DEV_MAX];      // Average time a request queued
+	double delay_max[IO_DEV_MAX];  // Longest time a request queued
+	long requests[IO_DEV_MAX];     // Requests served
+	int queue_max[IO_DEV_MAX];     // Most requests queued at once
+} io_stat_t;
+
+/**
+ * One I/O device: args->io_units[d] units serving requests, and a queue of
+ * requests waiting for a unit in the device's discipline.
+ */
+typedef struct {
+	int units;
+	queue_t* Q;                        // Waiting requests.
+	int serving;                       // Requests in service.
+	void* v[IO_UNITS_MAX];             // ... their engine items,
+	sim_time_t t_start[IO_UNITS_MAX];  // ... when they started,
+	sim_time_t t_done[IO_UNITS_MAX];   // ... and when they finish.
+	double busy;                       // Unit time spent serving.
+	double delay, delay_max;
+	long requests;
+	int queue_max;
+} io_dev_t;
+
+/**
+ * I/O devices of finite parallelism. Engines hand each I/O burst to
+ * io_sys_submit() instead of completing it after its length, and report its
+ * completion with io_sys_complete(), which starts the next waiting request.
+ * Requests are opaque items of the engine (its I/O completion events), held
+ * while they wait.
+ *
+ * Without args->io_devices every request starts at once, so I/O bursts never
+ * wait for one another.
+ */
+typedef struct {
+	int enabled; // Whether args asked for I/O devices.
+	const args_t* args;
+	long seq;    // Requests submitted, for FIFO order.
+	io_dev_t dev[IO_DEV_MAX];
+} io_sys_t;
+
+void io_sys_init(io_sys_t* io, const args_t* args);
+
+/**
+ * Free the devices and any items still waiting for them.
+ */
+void io_sys_free(io_sys_t* io);
+
+/**
+ * Submit request v of len ms to device d; it may start at t_ready.
+ * @return Whether it started, in which case *t_done is set to when it
+ * completes. Otherwise v waits in the device's queue.
+ */
+int io_sys_submit(io_sys_t* io, int d, void* v, sim_time_t t_ready, unsigned len,
+                  sim_time_t* t_done);
+
+/**
+ * Request v on device d completed at time t. Start the next waiting request.
+ * @return The started item, with *t_done set to when it completes, or NULL
+ * if none was waiting.
+ */
+void* io_sys_complete(io_sys_t* io, int d, void* v, sim_time_t t,
+                      sim_time_t* t_done);
+
+/**
+ * Fill out the final device report for a run that ended at t and was measured
+ * from t_begin.
+ */
+void io_sys_finish(io_sys_t* io, sim_time_t t, sim_time_t t_begin,
+                   io_stat_t* out);
+
+#endif // OPSYS_SIM_IO_SYS_H_
@@ -1,46 +1,103 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "algo.h"
 #include "args.h"
+#include "burstlog.h"
+#include "ckpt.h"
+#include "estimate.h"
 #include "exp_rand.h"
+#include "obs.h"
 #include "process.h"
+#include "rcache.h"
+#include "server.h"
+#include "study.h"
+#include "wcache.h"
 
 int main(int argc, char* argv[]) {
 	args_t* args = parse_args(argc, argv);
-	printf("<<< PROJECT PART I -- process set (n=%d) ", args->n);
-	printf("with %d CPU-bound process%s >>>\n", args->n_cpu,
-	       args->n_cpu == 1 ? "" : "es");
+	if (args->serve) {
+		int failed = run_server(args, argc, argv) != 0;
+		free(args);
+		return failed ? EXIT_FAILURE : 0;
+	}
+	if (args->reps > 0) {
+		run_study(args);
+		free(args);
+		return 0;
+	}
+
+	process_t* processes;
+	if (args->open_rate > 0) {
+		// Open system: processes are generated as they arrive into empty slots.
+		printf("<<< PROJECT PART I -- open system (%d slots to start) ", args->n);
+		printf("with arrival rate %g/ms until %llums; warm-up %llums >>>\n",
+		       args->open_rate, args->horizon, args->warmup);
+		processes = calloc(args->n, sizeof(process_t));
+	} else {
+		printf("<<< PROJECT PART I -- process set (n=%d) ", args->n);
+		printf("with %d CPU-bound process%s >>>\n", args->n_cpu,
+		       args->n_cpu == 1 ? "" : "es");
 
-	process_t* processes = generate_processes(args->n, args->n_cpu, args->seed,
-	                                          args->lambda, args->exp_max);
-	print_processes(processes, args->n, 0);
+		exp_rng_t rng;
+		seed_exp_r(&rng, args->seed);
+		processes = wcache_generate(args, &rng);
+		assign_attributes(processes, args->n, args, &rng);
+		print_processes(processes, args->n, 0);
+	}
 	printf("\n");
 
 	printf("<<< PROJECT PART II -- t_cs=%ums; alpha=%.2f; t_slice=%lums >>>\n",
 	       args->Tcs, args->alpha, args->Tslice);
 
-	process_t* p_copy = dup_process_array(processes, args->n);
-	algo_stat_t stats_fcfs = algo_fcfs(args, p_copy);
-	printf("\n");
-
-	copy_process_array(p_copy, processes, args->n);
-	algo_stat_t stats_sjf = algo_sjf(args, p_copy);
-	printf("\n");
+	// The runs are observed by the per-event output and the burst log.
+	obs_t obs = {0};
+	obs_text_t text = {.out = args->out, .window = args->print_window};
+	if (!args->quiet) obs_add(&obs, OBS_ALL, obs_text, &text);
+	burstlog_t bl;
+	if (args->burst_log) {
+		if (burstlog_open(&bl, args->burst_log) != 0) {
+			perror("ERROR: burst log");
+			exit(EXIT_FAILURE);
+		}
+		obs_add(&obs, BURSTLOG_MASK, burstlog_event, &bl);
+	}
+	if (obs.n > 0) args->obs = &obs;
 
-	copy_process_array(p_copy, processes, args->n);
-	algo_stat_t stats_srt = algo_srt(args, p_copy);
-	printf("\n");
+	// Every algorithm runs on its own copy of the same workload.
+	algo_stat_t* stats = calloc(n_algos, sizeof(algo_stat_t));
+	process_t* p_copy = dup_process_array(processes, args->n);
+	rcache_t rc;
+	rcache_init(&rc, args);
+	for (int i = 0, ran = 0; args->estimate != 2 && i < n_algos; ++i) {
+		if (!algo_enabled(&algos[i], args)) continue;
+		if (ran++ > 0 && !args->quiet) printf("\n");
+		// Cached results have no bursts to log and write no checkpoint.
+		if (!args->burst_log &&
+		    !(args->checkpoint && ckpt_wanted(args, algos[i].name)) &&
+		    rcache_get(&rc, args, algos[i].name, &stats[i])) {
+			if (!args->quiet)
+				printf("Results of %s taken from the result cache\n", algos[i].name);
+			continue;
+		}
+		copy_process_array(p_copy, processes, args->n);
+		if (args->burst_log) burstlog_begin(&bl, algos[i].name);
+		stats[i] = algos[i].run(args, p_copy);
+		if (stats[i].error) exit(EXIT_FAILURE);
+		if (args->burst_log) burstlog_end(&bl);
+		rcache_put(&rc, args, algos[i].name, &stats[i]);
+	}
 
-	copy_process_array(p_copy, processes, args->n);
-	algo_stat_t stats_rr = algo_rr(args, p_copy);
+	if (args->burst_log && burstlog_close(&bl) != 0) {
+		perror("ERROR: burst log");
+		exit(EXIT_FAILURE);
+	}
 
 	free_process_array(processes, args->n);
 	free_process_array(p_copy, args->n);
 	free(p_copy);
 	free(processes);
-	free(args);
-	args = NULL;
 
 	FILE* f = fopen("simout.txt", "w");
 	if (f == NULL) {
@@ -48,20 +105,29 @@ int main(int argc, char* argv[]) {
 		exit(EXIT_FAILURE);
 	}
 
-	fprintf(f, "Algorithm FCFS\n");
-	print_algo_stat(f, &stats_fcfs);
-	fprintf(f, "\n");
+	for (int i = 0, ran = 0; i < n_algos; ++i) {
+		if (!algo_enabled(&algos[i], args)) continue;
+		est_stat_t est;
+		int estimated = args->estimate && estimate(args, algos[i].name, &est);
+		if (args->estimate == 2 && !estimated) continue;
+		if (ran++ > 0) fprintf(f, "\n");
+		fprintf(f, "Algorithm %s\n", algos[i].name);
+		if (args->estimate == 2) {
+			print_estimate(f, &est, NULL);
+			continue;
+		}
 
-	fprintf(f, "Algorithm SJF\n");
-	print_algo_stat(f, &stats_sjf);
-	fprintf(f, "\n");
-
-	fprintf(f, "Algorithm SRT\n");
-	print_algo_stat(f, &stats_srt);
-	fprintf(f, "\n");
-
-	fprintf(f, "Algorithm RR\n");
-	print_algo_stat(f, &stats_rr);
+		print_algo_stat(f, &stats[i]);
+		for (int j = 0; algos[i].oracle_of && j < n_algos; ++j) {
+			if (strcmp(algos[j].name, algos[i].oracle_of) == 0) {
+				print_oracle_gap(f, algos[j].name, &stats[j], &stats[i]);
+			}
+		}
+		if (estimated) print_estimate(f, &est, &stats[i]);
+	}
+	free(stats);
+	free(args);
+	args = NULL;
 
 	if (fclose(f) != 0) {
 		perror("ERROR: fclose");
@@ -0,0 +1,60 @@
+#include "obs.h"
+
+int obs_add(obs_t* obs, unsigned mask, obs_fn fn, void* data) {
+	if (obs->n == OBS_MAX) return -1;
+	obs->o[obs->n].mask = mask;
+	obs->o[obs->n].fn = fn;
+	obs->o[obs->n].data = data;
+	obs->n++;
+	obs->mask |= mask;
+	return 0;
+}
+
+static void obs_dispatch(const obs_t* obs, const obs_event_t* ev) {
+	for (int i = 0; i < obs->n; ++i) {
+		if (obs->o[i].mask >> ev->kind & 1u) obs->o[i].fn(obs->o[i].data, ev);
+	}
+}
+
+void obs_emit(const obs_t* obs, int kind, sim_time_t t, int id,
+              long long arg) {
+	obs_event_t ev = {.kind = kind, .t = t, .id = id, .arg = arg};
+	obs_dispatch(obs, &ev);
+}
+
+void obs_emitf(const obs_t* obs, int kind, sim_time_t t, int id,
+               long long arg, int always, obs_queue_fn print_queue,
+               const void* q, int n, const char* fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	obs_event_t ev = {.kind = kind,
+	                  .t = t,
+	                  .id = id,
+	                  .arg = arg,
+	                  .always = always,
+	                  .fmt = fmt,
+	                  .ap = &ap,
+	                  .print_queue = print_queue,
+	                  .q = q,
+	                  .n = n};
+	obs_dispatch(obs, &ev);
+	va_end(ap);
+}
+
+void obs_print(const obs_event_t* ev, FILE* out) {
+	// Each observer may print the arguments again.
+	va_list ap;
+	va_copy(ap, *ev->ap);
+	vfprintf(out, ev->fmt, ap);
+	va_end(ap);
+	fprintf(out, " ");
+	ev->print_queue(out, ev->q, ev->n);
+}
+
+void obs_text(void* data, const obs_event_t* ev) {
+	const obs_text_t* text = data;
+	if (ev->fmt == NULL || !(ev->always || ev->t < text->window)) return;
+	fprintf(text->out, "time %llums: ", ev->t);
+	obs_print(ev, text->out);
+	fprintf(text->out, "\n");
+}
@@ -0,0 +1,110 @@
+#ifndef OPSYS_SIM_OBS_H_
+#define OPSYS_SIM_OBS_H_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "simtime.h"
+
+// Kinds of scheduling events, and what the arg of each carries.
+enum obs_kind {
+	OBS_ARRIVAL = 0, // A process arrived; arg = 1 if it is CPU-bound.
+	OBS_START,       // It started using a CPU; arg = ms of the burst it runs.
+	OBS_STOP,        // It completed a CPU burst; arg = CPU bursts left.
+	OBS_PREEMPT,     // It was taken off a CPU; arg = ms of the burst left.
+	OBS_TAU,         // Its predicted burst time was set; arg = the new tau.
+	OBS_IO_START,    // It blocked on I/O; arg = when the I/O completes, or -1
+	                 // while it waits for its device.
+	OBS_IO_DONE,     // It completed I/O and joined the ready queue.
+	OBS_TERMINATE,   // It completed its last CPU burst.
+	OBS_OTHER,       // Anything else, e.g. the simulator starting.
+	OBS_KINDS,
+};
+
+#define OBS_MASK(kind) (1u << (kind))
+#define OBS_ALL (OBS_MASK(OBS_KINDS) - 1)
+
+// Most observers of one run.
+#define OBS_MAX 8
+
+/**
+ * Prints the ready queue(s) q, of n CPUs or groups where the algorithm has
+ * several.
+ */
+typedef void (*obs_queue_fn)(FILE* out, const void* q, int n);
+
+typedef struct obs_event {
+	int kind;      // enum obs_kind.
+	sim_time_t t;  // When it happened.
+	int id;        // Process it happened to; 0 for none.
+	long long arg; // See enum obs_kind.
+
+	// The event as the per-event output describes it, if it does.
+	int always;               // Printed outside the print window too.
+	const char* fmt;          // printf() format; NULL = not described.
+	va_list* ap;              // ... its arguments.
+	obs_queue_fn print_queue; // Printer of the ready queue(s) ...
+	const void* q;            // ... q ...
+	int n;                    // ... of n CPUs or groups.
+} obs_event_t;
+
+typedef void (*obs_fn)(void* data, const obs_event_t* ev);
+
+/**
+ * The observers of a run, each called with the events of the kinds in its
+ * mask, in the order they were added. Start from obs_t obs = {0}.
+ */
+typedef struct obs {
+	unsigned mask; // Kinds any observer wants.
+	int n;
+	struct {
+		unsigned mask;
+		obs_fn fn;
+		void* data;
+	} o[OBS_MAX];
+} obs_t;
+
+/**
+ * Whether any observer wants events of this kind; a NULL obs has none. The
+ * engines test this before building an event, so a run nobody observes
+ * only pays for the test.
+ */
+#define obs_wants(obs, kind) ((obs) != NULL && ((obs)->mask >> (kind) & 1u))
+
+/**
+ * Add observer fn, called with data and the events of the kinds in mask.
+ * @return 0, or -1 if obs already has OBS_MAX observers.
+ */
+int obs_add(obs_t* obs, unsigned mask, obs_fn fn, void* data);
+
+/**
+ * Pass an event that the per-event output does not describe on to the
+ * observers that want it.
+ */
+void obs_emit(const obs_t* obs, int kind, sim_time_t t, int id,
+              long long arg);
+
+/**
+ * Pass an event on to the observers that want it, described by fmt and the
+ * arguments after it, followed by the ready queue(s) q.
+ */
+void obs_emitf(const obs_t* obs, int kind, sim_time_t t, int id,
+               long long arg, int always, obs_queue_fn print_queue,
+               const void* q, int n, const char* fmt, ...);
+
+/**
+ * Print the description of ev and its ready queue(s) to out.
+ */
+void obs_print(const obs_event_t* ev, FILE* out);
+
+/**
+ * The per-event output: "time <t>ms: " and the description of each event,
+ * for events before the print window ends or marked always.
+ */
+typedef struct obs_text {
+	FILE* out;
+	sim_time_t window;
+} obs_text_t;
+
+void obs_text(void* data, const obs_event_t* ev);
+
+#endif // OPSYS_SIM_OBS_H_
@@ -0,0 +1,84 @@
+#include "open_sys.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void open_sys_init(open_sys_t* os, const args_t* args) {
+	*os = (open_sys_t){
+	    .enabled = args->open_rate > 0, .args = args, .slots = args->n};
+	if (!os->enabled) return;
+
+	seed_exp_r(&os->rng, args->seed);
+	os->rng.antithetic = args->antithetic;
+	os->procs = calloc(os->slots, sizeof(process_t));
+	os->clock = next_exp_r(&os->rng, args->open_rate);
+	os->t_next = ceil(os->clock);
+}
+
+void open_sys_free(open_sys_t* os) {
+	if (os->procs) free_process_array(os->procs, os->slots);
+	free(os->procs);
+	os->procs = NULL;
+}
+
+int open_sys_pending(const open_sys_t* os) {
+	return os->enabled && os->t_next < os->args->horizon;
+}
+
+int open_sys_admit(open_sys_t* os, sim_time_t t_limit) {
+	const args_t* args = os->args;
+	if (!open_sys_pending(os) || os->t_next > t_limit) return -1;
+
+	sim_time_t t = os->t_next;
+	os->clock += next_exp_r(&os->rng, args->open_rate);
+	os->t_next = ceil(os->clock);
+
+	int i = 0;
+	while (i < os->slots && os->procs[i].cpu_bursts) ++i;
+	if (i == os->slots) {
+		os->slots *= 2;
+		os->procs = realloc(os->procs, os->slots * sizeof(process_t));
+		memset(os->procs + i, 0, (os->slots - i) * sizeof(process_t));
+	}
+
+	process_t* p = &os->procs[i];
+	*p = (process_t){.id = 'A' + i, .arrival_time = t};
+	p->cpu_bound = next_unif_r(&os->rng) * args->n < args->n_cpu;
+	generate_bursts(p, &os->rng, args->lambda, args->exp_max);
+	assign_attributes(p, 1, args, &os->rng);
+
+	++os->live;
+	if (t >= args->warmup) {
+		++os->arrived;
+		if (os->live > os->live_max) os->live_max = os->live;
+	}
+	return i;
+}
+
+void open_sys_retire(open_sys_t* os, int i) {
+	if (!os->enabled) return;
+
+	free_process(os->procs[i]);
+	os->procs[i].cpu_bursts = NULL;
+	os->procs[i].io_bursts = NULL;
+	os->procs[i].deadlines = NULL;
+	--os->live;
+}
+
+void* open_sys_grow(const open_sys_t* os, void* a, int n, size_t size) {
+	a = realloc(a, os->slots * size);
+	memset((char*) a + n * size, 0, (os->slots - n) * size);
+	return a;
+}
+
+void** open_sys_grow_state(const open_sys_t* os, void** a, int n,
+                           size_t size) {
+	a = realloc(a, os->slots * sizeof(void*));
+	for (int i = n; i < os->slots; ++i) a[i] = calloc(1, size);
+	return a;
+}
+
+void open_sys_free_state(void** a, int n) {
+	for (int i = 0; i < n; ++i) free(a[i]);
+	free(a);
+}
@@ -0,0 +1,81 @@
+#ifndef OPSYS_SIM_OPEN_SYS_H_
+#define OPSYS_SIM_OPEN_SYS_H_
+
+#include <stddef.h>
+#include "args.h"
+#include "exp_rand.h"
+#include "process.h"
+
+/**
+ * Open-system workload source. Processes arrive as a Poisson stream with
+ * rate args->open_rate until args->horizon. Each takes the first free slot of
+ * a slot table that doubles whenever every slot is taken, and gives the slot
+ * back when it terminates, so no arrival is turned away and memory follows
+ * the number of live processes. Slot i holds process 'A' + i; past 'Z' the
+ * ids run on through the characters after it.
+ *
+ * The stream is seeded from args->seed, so each algorithm sees the same
+ * arrival times and bursts regardless of how it schedules them.
+ *
+ * Engines keep their per-process state in arrays of os->slots elements, in
+ * both modes, and grow them after an admission that added slots.
+ */
+typedef struct {
+	int enabled;       // Whether args asked for an open system.
+	exp_rng_t rng;     // Arrival times and generated bursts.
+	const args_t* args;
+	double clock;      // Exact time of the next arrival.
+	sim_time_t t_next; // ... rounded up to the next ms.
+	process_t* procs;  // The slot table; a slot is free when it has no bursts.
+	int slots;         // Length of procs; args->n for a closed system.
+	int live;          // Processes currently holding a slot.
+	int arrived;       // Arrivals after the warm-up.
+	int live_max;      // Most processes live at once after the warm-up.
+} open_sys_t;
+
+void open_sys_init(open_sys_t* os, const args_t* args);
+
+/**
+ * Free the slot table, with the processes still live.
+ */
+void open_sys_free(open_sys_t* os);
+
+/**
+ * @return Whether more arrivals will be generated before the horizon.
+ */
+int open_sys_pending(const open_sys_t* os);
+
+/**
+ * Admit the next arrival if it happens no later than t_limit. The new process
+ * is generated into its slot in os->procs, which may move and grow.
+ * @return The slot index, or -1 if nothing arrives by t_limit.
+ */
+int open_sys_admit(open_sys_t* os, sim_time_t t_limit);
+
+/**
+ * Release the slot of terminated process i and free its bursts.
+ */
+void open_sys_retire(open_sys_t* os, int i);
+
+/**
+ * Grow per-slot array a of n elements of size bytes to os->slots elements,
+ * zeroing the new ones.
+ * @return The reallocated array.
+ */
+void* open_sys_grow(const open_sys_t* os, void* a, int n, size_t size);
+
+/**
+ * Grow per-slot state a of n elements to os->slots. Each element of size
+ * bytes is allocated (zeroed) on its own, so pointers to it, as ready queues
+ * hold, stay valid when more slots are added.
+ * @return The reallocated array of pointers.
+ */
+void** open_sys_grow_state(const open_sys_t* os, void** a, int n,
+                           size_t size);
+
+/**
+ * Free per-slot state a of n elements.
+ */
+void open_sys_free_state(void** a, int n);
+
+#endif // OPSYS_SIM_OPEN_SYS_H_
@@ -0,0 +1,119 @@
+#include "predict.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "algo.h"
+
+// Smoothing of the adaptive predictor's tracking signal.
+#define PRED_TRACK_BETA 0.2
+
+void predict_init(predict_t* pr, const args_t* args) {
+	*pr = (predict_t){.args = args};
+	for (int k = 0; k < args->alpha_sweep; ++k)
+		pr->sweep_alpha[k] = args->sweep_alpha[k];
+}
+
+unsigned predict_first(predict_t* pr, pred_t* p, int cpu_bound) {
+	const args_t* args = pr->args;
+	unsigned tau = ceil(1 / args->lambda);
+	if (args->predictor == PRED_CLASS && pr->class_n[cpu_bound] > 0)
+		tau = ceil(pr->class_sum[cpu_bound] / pr->class_n[cpu_bound]);
+
+	*p = (pred_t){.mean = tau};
+	for (int k = 0; k < args->alpha_sweep; ++k) p->sweep[k] = tau;
+	return tau;
+}
+
+/**
+ * Advance the exp-averaging tau of each of the n swept alphas by burst,
+ * adding the error of the old tau to mae and bias. The arrays are all
+ * doubles and never overlap, and ceil() is done inline (tau is positive and
+ * fits an int), so that -O3 or -ftree-vectorize vectorizes the loop.
+ */
+static void predict_sweep(int n, const double* restrict alpha,
+                          double* restrict tau, double* restrict mae,
+                          double* restrict bias, double burst) {
+	for (int k = 0; k < n; ++k) {
+		double d = tau[k] - burst;
+		mae[k] += fabs(d);
+		bias[k] += d;
+		double x = alpha[k] * burst + (1.0 - alpha[k]) * tau[k];
+		double c = (int) x;
+		tau[k] = c + (c < x);
+	}
+}
+
+static int cmp_int(const void* lhs, const void* rhs) {
+	return *(const int*) lhs - *(const int*) rhs;
+}
+
+unsigned predict_update(predict_t* pr, pred_t* p, unsigned tau, int burst,
+                        int cpu_bound, pred_stat_t* stat) {
+	const args_t* args = pr->args;
+	double err = (double) tau - burst;
+	stat->mae += fabs(err);
+	stat->bias += err;
+	++stat->n;
+
+	predict_sweep(args->alpha_sweep, pr->sweep_alpha, p->sweep, stat->sweep_mae,
+	              stat->sweep_bias, burst);
+
+	switch (args->predictor) {
+	case PRED_ADAPTIVE: {
+		p->err = PRED_TRACK_BETA * -err + (1 - PRED_TRACK_BETA) * p->err;
+		p->abs_err = PRED_TRACK_BETA * fabs(err) + (1 - PRED_TRACK_BETA) * p->abs_err;
+		double alpha = p->abs_err > 0 ? fabs(p->err) / p->abs_err : args->alpha;
+		tau = ceil(alpha * burst + (1.0 - alpha) * tau);
+		break;
+	}
+	case PRED_EWMA_VAR: {
+		double diff = burst - p->mean;
+		p->mean += args->alpha * diff;
+		p->var = (1.0 - args->alpha) * (p->var + args->alpha * diff * diff);
+		tau = ceil(p->mean + args->pred_k * sqrt(p->var));
+		break;
+	}
+	case PRED_MEDIAN: {
+		p->window[p->n % args->pred_window] = burst;
+		++p->n;
+		int k = p->n < args->pred_window ? p->n : args->pred_window;
+		int sorted[PRED_WINDOW_MAX];
+		memcpy(sorted, p->window, k * sizeof(int));
+		qsort(sorted, k, sizeof(int), cmp_int);
+		tau = k % 2 ? sorted[k / 2] : ceil((sorted[k / 2 - 1] + sorted[k / 2]) / 2.0);
+		break;
+	}
+	case PRED_CLASS:
+		pr->class_sum[cpu_bound] += burst;
+		++pr->class_n[cpu_bound];
+		tau = exp_avg_tau(args->alpha, burst, tau);
+		break;
+	default:
+		tau = exp_avg_tau(args->alpha, burst, tau);
+		break;
+	}
+	return tau;
+}
+
+void predict_finish(const predict_t* pr, pred_stat_t* stat) {
+	stat->enabled = pr->args->predictor != PRED_DEFAULT;
+	stat->kind = pr->args->predictor;
+	stat->sweep = pr->args->alpha_sweep;
+	for (int k = 0; k < stat->sweep; ++k) {
+		stat->sweep_alpha[k] = pr->args->sweep_alpha[k];
+	}
+	if (stat->n > 0) {
+		stat->mae /= stat->n;
+		stat->bias /= stat->n;
+		for (int k = 0; k < stat->sweep; ++k) {
+			stat->sweep_mae[k] /= stat->n;
+			stat->sweep_bias[k] /= stat->n;
+		}
+	}
+}
+
+const char* predict_name(int kind) {
+	static const char* names[] = {"exp", "exp", "adaptive", "ewma-var", "median",
+	                              "class"};
+	return names[kind];
+}
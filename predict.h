@@ -0,0 +1,78 @@
+#ifndef OPSYS_SIM_PREDICT_H_
+#define OPSYS_SIM_PREDICT_H_
+
+#include "args.h"
+
+typedef struct {
+	int enabled;  // Whether a predictor was chosen with --predictor.
+	int kind;     // enum predictor
+	double mae;   // Mean absolute error of the predictions
+	double bias;  // Mean of prediction minus burst (> 0 overestimates)
+	long n;       // Bursts predicted
+	int sweep;    // Alphas swept (args->alpha_sweep)
+	float sweep_alpha[ALPHA_SWEEP_MAX];
+	double sweep_mae[ALPHA_SWEEP_MAX];  // Error of exp averaging with each
+	double sweep_bias[ALPHA_SWEEP_MAX];
+} pred_stat_t;
+
+/**
+ * Per-process predictor state, kept next to the process's tau.
+ */
+typedef struct {
+	double mean;    // ewma-var: averaged burst.
+	double var;     // ewma-var: averaged squared deviation.
+	double err;     // adaptive: smoothed error.
+	double abs_err; // adaptive: smoothed absolute error.
+	int window[PRED_WINDOW_MAX]; // median: last bursts, as a ring.
+	int n;          // Bursts seen.
+	double sweep[ALPHA_SWEEP_MAX]; // tau of exp averaging with each swept alpha.
+} pred_t;
+
+/**
+ * Burst predictor of one run, as chosen by args->predictor. Alongside it,
+ * tau is kept for every alpha of args->alpha_sweep, so that the error of
+ * exp averaging can be measured for all of them in one run. Predictors:
+ * - exp: tau = alpha * burst + (1 - alpha) * tau, with tau0 = 1 / lambda.
+ * - adaptive: as exp, with alpha set each burst to the Trigg-Leach tracking
+ *   signal |smoothed error| / smoothed |error|, so alpha rises while the
+ *   predictions are off in one direction and falls while they scatter.
+ * - ewma-var: exponential averages of the burst and its variance, predicting
+ *   mean + args->pred_k standard deviations.
+ * - median: median of the last args->pred_window bursts.
+ * - class: as exp, but a new process starts from the average burst seen so far
+ *   from processes of its class (CPU-bound or I/O-bound) instead of 1 / lambda.
+ */
+typedef struct {
+	const args_t* args;
+	double class_sum[2]; // class: bursts seen by class.
+	long class_n[2];
+	double sweep_alpha[ALPHA_SWEEP_MAX]; // args->sweep_alpha, as doubles.
+} predict_t;
+
+void predict_init(predict_t* pr, const args_t* args);
+
+/**
+ * Reset the predictor state p of a new process.
+ * @return Its first prediction, tau0.
+ */
+unsigned predict_first(predict_t* pr, pred_t* p, int cpu_bound);
+
+/**
+ * A process predicted to take tau ms finished a burst of burst ms. Record the
+ * error in stat.
+ * @return Its next prediction.
+ */
+unsigned predict_update(predict_t* pr, pred_t* p, unsigned tau, int burst,
+                        int cpu_bound, pred_stat_t* stat);
+
+/**
+ * Turn the sums in stat into the final report.
+ */
+void predict_finish(const predict_t* pr, pred_stat_t* stat);
+
+/**
+ * @return The option name of predictor kind.
+ */
+const char* predict_name(int kind);
+
+#endif // OPSYS_SIM_PREDICT_H_
@@ -7,37 +7,82 @@
 
 process_t* generate_processes(int n, int n_cpu, int seed, double lambda,
                               int exp_max) {
-	seed_exp(seed);
+	exp_rng_t rng;
+	seed_exp_r(&rng, seed);
+	return generate_processes_r(n, n_cpu, &rng, lambda, exp_max);
+}
+
+process_t* generate_processes_r(int n, int n_cpu, exp_rng_t* rng,
+                                double lambda, int exp_max) {
 	process_t* p = calloc(n, sizeof(process_t));
 	for (int i = 0; i < n; ++i) {
 		p[i].id = 'A' + i;
-		p[i].arrival_time = floor_exp(lambda, exp_max);
-		p[i].cpu_burst_ct = ceil(drand48() * MAX_BURSTS);
+		p[i].arrival_time = floor_exp_r(rng, lambda, exp_max);
+		p[i].cpu_bound = i >= (n - n_cpu);
+		generate_bursts(&p[i], rng, lambda, exp_max);
+	}
+
+	return p;
+}
+
+void generate_bursts(process_t* p, exp_rng_t* rng, double lambda,
+                     int exp_max) {
+	p->cpu_burst_ct = ceil(next_unif_r(rng) * MAX_BURSTS);
 
-		p[i].cpu_bursts = calloc(p[i].cpu_burst_ct, sizeof(int));
-		p[i].io_bursts = calloc(p[i].cpu_burst_ct - 1, sizeof(int));
+	p->cpu_bursts = calloc(p->cpu_burst_ct, sizeof(int));
+	p->io_bursts = calloc(p->cpu_burst_ct - 1, sizeof(int));
 
-		// Get burst times.
-		for (int j = 0; j < p[i].cpu_burst_ct - 1; ++j) {
-			p[i].cpu_bursts[j] = ceil_exp(lambda, exp_max);
-			p[i].io_bursts[j] = ceil_exp(lambda, exp_max) * 10;
+	// Get burst times.
+	for (int j = 0; j < p->cpu_burst_ct - 1; ++j) {
+		p->cpu_bursts[j] = ceil_exp_r(rng, lambda, exp_max);
+		p->io_bursts[j] = ceil_exp_r(rng, lambda, exp_max) * 10;
+	}
+	p->cpu_bursts[p->cpu_burst_ct - 1] = ceil_exp_r(rng, lambda, exp_max);
+
+	// Re-scale CPU-bound processes.
+	if (p->cpu_bound) {
+		for (int j = 0; j < p->cpu_burst_ct - 1; ++j) {
+			p->cpu_bursts[j] *= 4;
+			p->io_bursts[j] /= 8;
 		}
-		p[i].cpu_bursts[p[i].cpu_burst_ct - 1] = ceil_exp(lambda, exp_max);
+		p->cpu_bursts[p->cpu_burst_ct - 1] *= 4;
+	}
+}
 
-		// Re-scale CPU-bound processes.
-		if (i < (n - n_cpu)) {
-			p[i].cpu_bound = 0;
-		} else {
-			p[i].cpu_bound = 1;
-			for (int j = 0; j < p[i].cpu_burst_ct - 1; ++j) {
-				p[i].cpu_bursts[j] *= 4;
-				p[i].io_bursts[j] /= 8;
-			}
-			p[i].cpu_bursts[p[i].cpu_burst_ct - 1] *= 4;
+void assign_attributes(process_t* p, int n, const args_t* args,
+                       exp_rng_t* rng) {
+	for (int i = 0; i < n; ++i) {
+		p[i].nice = p[i].cpu_bound ? args->nice_cpu : args->nice_io;
+		p[i].tickets = p[i].cpu_bound ? args->tickets_cpu : args->tickets_io;
+		p[i].priority = p[i].cpu_bound;
+		p[i].group = p[i].cpu_bound;
+		p[i].io_dev = 0;
+	}
+
+	// Priorities and groups are drawn uniformly when their count is given.
+	for (int i = 0; args->prio_levels > 0 && i < n; ++i) {
+		p[i].priority = next_unif_r(rng) * args->prio_levels;
+		if (p[i].priority == args->prio_levels) --p[i].priority;
+	}
+	for (int i = 0; args->groups > 0 && i < n; ++i) {
+		p[i].group = next_unif_r(rng) * args->groups;
+		if (p[i].group == args->groups) --p[i].group;
+	}
+
+	// Each burst's deadline is between 1 and deadline_slack times its length.
+	for (int i = 0; args->deadline_slack > 0 && i < n; ++i) {
+		p[i].deadlines = realloc(p[i].deadlines, p[i].cpu_burst_ct * sizeof(int));
+		for (int j = 0; j < p[i].cpu_burst_ct; ++j) {
+			double slack = 1.0 + (args->deadline_slack - 1.0) * next_unif_r(rng);
+			p[i].deadlines[j] = ceil(p[i].cpu_bursts[j] * slack);
 		}
 	}
 
-	return p;
+	// With several I/O devices, each process uses one drawn uniformly.
+	for (int i = 0; args->io_devices > 1 && i < n; ++i) {
+		p[i].io_dev = next_unif_r(rng) * args->io_devices;
+		if (p[i].io_dev == args->io_devices) --p[i].io_dev;
+	}
 }
 
 void print_processes(process_t* p, int n, int print_bursts) {
@@ -49,7 +94,7 @@ void print_processes(process_t* p, int n, int print_bursts) {
 			printf("I/O");
 		}
 		printf("-bound process %c: ", p[i].id);
-		printf("arrival time %dms; ", p[i].arrival_time);
+		printf("arrival time %llums; ", p[i].arrival_time);
 		printf("%d CPU burst%s%s\n", p[i].cpu_burst_ct,
 		       p[i].cpu_burst_ct == 1 ? "" : "s", print_bursts == 1 ? ":" : "");
 
@@ -81,6 +126,7 @@ void free_process_array(process_t* src, size_t n) {
 void free_process(process_t p) {
 	free(p.cpu_bursts);
 	free(p.io_bursts);
+	free(p.deadlines);
 }
 
 
@@ -91,12 +137,18 @@ void copy_process(process_t* dest, const process_t* source) {
 	dest->id = source->id;
 	dest->cpu_bound = source->cpu_bound;
 	dest->arrival_time = source->arrival_time;
+	dest->nice = source->nice;
+	dest->tickets = source->tickets;
+	dest->priority = source->priority;
+	dest->group = source->group;
+	dest->io_dev = source->io_dev;
 	dest->cpu_burst_ct = source->cpu_burst_ct;
 
 	if (dest->cpu_burst_ct > 0) {
 	dest->cpu_bursts =
 	    realloc(dest->cpu_bursts, dest->cpu_burst_ct * sizeof(int));
 	} else {
+		free(dest->cpu_bursts);
 		dest->cpu_bursts = NULL;
 	}
 
@@ -104,9 +156,23 @@ void copy_process(process_t* dest, const process_t* source) {
 		dest->io_bursts =
 	    realloc(dest->io_bursts, (dest->cpu_burst_ct - 1) * sizeof(int));
 	} else {
+		free(dest->io_bursts);
 		dest->io_bursts = NULL;
 	}
 
+	if (source->deadlines && dest->cpu_burst_ct > 0) {
+		dest->deadlines =
+		    realloc(dest->deadlines, dest->cpu_burst_ct * sizeof(int));
+		for (int j = 0; j < dest->cpu_burst_ct; ++j)
+			dest->deadlines[j] = source->deadlines[j];
+	} else {
+		free(dest->deadlines);
+		dest->deadlines = NULL;
+	}
+
+	// Empty (open-system) slots have no bursts.
+	if (dest->cpu_burst_ct == 0) return;
+
 	// Copy burst times.
 	for (int j = 0; j < dest->cpu_burst_ct - 1; ++j) {
 		dest->cpu_bursts[j] = source->cpu_bursts[j];
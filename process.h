@@ -2,21 +2,51 @@
 #define OPSYS_SIM_PROCESS_H_
 
 #include <sys/types.h>
+#include "args.h"
+#include "exp_rand.h"
 
 #define MAX_BURSTS 64
 
 typedef struct process {
-	char id;
+	int id;
 	int cpu_bound;
-	int arrival_time;
+	sim_time_t arrival_time;
 	int cpu_burst_ct;
 	int* cpu_bursts;
 	int* io_bursts;
+	int nice; // Nice level (-20 to 19) for weighted schedulers.
+	int* deadlines; // Relative deadline of each CPU burst, or NULL if none.
+	int tickets;    // Share of the CPU for proportional-share schedulers.
+	int priority;   // Static priority, 0 is the highest.
+	int group;      // Process group for group scheduling.
+	int io_dev;     // I/O device its I/O bursts use.
 } process_t;
 
 process_t* generate_processes(int n, int n_cpu, int seed, double lambda,
                               int exp_max);
 
+/**
+ * Generate n processes drawing from rng.
+ */
+process_t* generate_processes_r(int n, int n_cpu, exp_rng_t* rng,
+                                double lambda, int exp_max);
+
+/**
+ * Draw the burst count and CPU/I/O burst times of p from rng. p->cpu_bound
+ * must already be set; CPU-bound processes are re-scaled.
+ */
+void generate_bursts(process_t* p, exp_rng_t* rng, double lambda,
+                     int exp_max);
+
+/**
+ * Set the scheduling attributes of the n processes in p (nice level, tickets,
+ * priority, group, burst deadlines, I/O device, ...) from the options in args. Random attributes are drawn from
+ * rng, and only when their option is given, so the rest of the stream is
+ * unchanged.
+ */
+void assign_attributes(process_t* p, int n, const args_t* args,
+                       exp_rng_t* rng);
+
 /**
  * Duplicate process array p of length n.
  * @return The newly copied array.
@@ -140,6 +140,12 @@ void* queue_peek(queue_t* q) {
 	return q->data[0];
 }
 
+size_t queue_size(const queue_t* q) {
+	assert(q);
+
+	return q->size;
+}
+
 void queue_update(queue_t* q, void* v) {
 	assert(q);
 	assert(v);
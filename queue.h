@@ -50,6 +50,11 @@ void* queue_pop(queue_t* q);
  */
 void* queue_peek(queue_t* q);
 
+/**
+ * @returns The number of items in the queue.
+ */
+size_t queue_size(const queue_t* q);
+
 /**
  * Search the queue for item v without using cmp.
  * @returns An iterator to item v or -1 if not found.
@@ -0,0 +1,197 @@
+#include "rcache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include "hash.h"
+
+#define RCACHE_MAGIC "SIMRES1"
+#define RCACHE_NAME_MAX 32
+#define RCACHE_PATH_MAX 4096
+
+/**
+ * A cache file: this header, then the key options and the results.
+ */
+typedef struct {
+	char magic[8];
+	uint32_t version;    // RCACHE_VERSION
+	uint32_t args_size;  // sizeof(args_t)
+	uint32_t stat_size;  // sizeof(algo_stat_t)
+	char algo[RCACHE_NAME_MAX];
+	uint64_t sum;        // FNV-1a of the key options and the results.
+} rcache_hdr_t;
+
+typedef struct {
+	rcache_hdr_t hdr;
+	args_t key;
+	algo_stat_t stat;
+} rcache_file_t;
+
+/**
+ * Fill in the header and key of file f for algorithm algo run with options
+ * run_args. The key is copied bytewise, padding included, with the options
+ * that do not change the results cleared.
+ */
+static void rcache_key(rcache_file_t* f, const args_t* run_args,
+                       const char* algo) {
+	memset(f, 0, sizeof(*f));
+	memcpy(f->hdr.magic, RCACHE_MAGIC, sizeof(f->hdr.magic));
+	f->hdr.version = RCACHE_VERSION;
+	f->hdr.args_size = sizeof(args_t);
+	f->hdr.stat_size = sizeof(algo_stat_t);
+	strncpy(f->hdr.algo, algo, RCACHE_NAME_MAX - 1);
+
+	memcpy(&f->key, run_args, sizeof(args_t));
+	f->key.quiet = 0;
+	f->key.out = NULL;
+	f->key.print_window = 0;
+	f->key.obs = NULL;
+	f->key.serve = NULL;
+	f->key.workers = 0;
+	f->key.reps = 0;
+	f->key.estimate = 0;
+	f->key.result_cache = NULL;
+	f->key.result_cache_size = 0;
+	f->key.workload_cache = NULL;
+	f->key.checkpoint = NULL;
+	f->key.checkpoint_of = NULL;
+	f->key.checkpoint_every = 0;
+	f->key.burst_log = NULL;
+}
+
+/**
+ * Set path to the file of f's key, hashed with everything but the results.
+ */
+static void rcache_path(const rcache_t* rc, const rcache_file_t* f,
+                        char* path) {
+	uint64_t h = fnv1a(FNV_OFFSET, &f->hdr, offsetof(rcache_hdr_t, sum));
+	h = fnv1a(h, &f->key, sizeof(args_t));
+	snprintf(path, RCACHE_PATH_MAX, "%s/%016llx.res", rc->args->result_cache,
+	         (unsigned long long) h);
+}
+
+static uint64_t rcache_sum(const rcache_file_t* f) {
+	uint64_t h = fnv1a(FNV_OFFSET, &f->key, sizeof(args_t));
+	return fnv1a(h, &f->stat, sizeof(algo_stat_t));
+}
+
+void rcache_init(rcache_t* rc, const args_t* args) {
+	*rc = (rcache_t){.enabled = args->result_cache != NULL, .args = args};
+	if (rc->enabled && mkdir(args->result_cache, 0777) != 0 && errno != EEXIST) {
+		fprintf(stderr, "WARNING: result cache %s: %s\n", args->result_cache,
+		        strerror(errno));
+		rc->enabled = 0;
+	}
+}
+
+int rcache_get(rcache_t* rc, const args_t* run_args, const char* algo,
+               algo_stat_t* out) {
+	// A restored run continues a prefix that its key does not describe.
+	if (!rc->enabled || run_args->restore) return 0;
+
+	rcache_file_t want, got;
+	char path[RCACHE_PATH_MAX];
+	rcache_key(&want, run_args, algo);
+	rcache_path(rc, &want, path);
+
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL) return 0;
+	size_t read = fread(&got, sizeof(got), 1, fp);
+	fclose(fp);
+	if (read != 1 ||
+	    memcmp(&got.hdr, &want.hdr, offsetof(rcache_hdr_t, sum)) != 0 ||
+	    memcmp(&got.key, &want.key, sizeof(args_t)) != 0 ||
+	    got.hdr.sum != rcache_sum(&got))
+		return 0;
+
+	// Mark it recently used.
+	utime(path, NULL);
+	*out = got.stat;
+	return 1;
+}
+
+typedef struct {
+	char name[256];
+	long long used; // Last use, in ns.
+	off_t size;
+} rcache_entry_t;
+
+static int rcache_entry_cmp(const void* lhs, const void* rhs) {
+	const rcache_entry_t *l = lhs, *r = rhs;
+	return l->used < r->used ? -1 : (l->used > r->used);
+}
+
+/**
+ * Remove the least recently used results until the cache fits its size.
+ */
+static void rcache_evict(rcache_t* rc) {
+	const char* dir = rc->args->result_cache;
+	DIR* d = opendir(dir);
+	if (d == NULL) return;
+
+	int n = 0, cap = 64;
+	rcache_entry_t* e = malloc(cap * sizeof(rcache_entry_t));
+	off_t total = 0;
+	char path[RCACHE_PATH_MAX];
+	for (struct dirent* de = readdir(d); de; de = readdir(d)) {
+		size_t len = strlen(de->d_name);
+		if (len < 4 || len >= sizeof(e->name) ||
+		    strcmp(de->d_name + len - 4, ".res") != 0)
+			continue;
+		struct stat st;
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		if (stat(path, &st) != 0) continue;
+		if (n == cap) e = realloc(e, (cap *= 2) * sizeof(rcache_entry_t));
+		strcpy(e[n].name, de->d_name);
+		e[n].used = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+		e[n].size = st.st_size;
+		total += st.st_size;
+		++n;
+	}
+	closedir(d);
+
+	qsort(e, n, sizeof(rcache_entry_t), rcache_entry_cmp);
+	off_t limit = (off_t) rc->args->result_cache_size * 1024;
+	for (int i = 0; i < n && total > limit; ++i) {
+		snprintf(path, sizeof(path), "%s/%s", dir, e[i].name);
+		if (unlink(path) == 0) total -= e[i].size;
+	}
+	free(e);
+}
+
+void rcache_put(rcache_t* rc, const args_t* run_args, const char* algo,
+                const algo_stat_t* stat) {
+	if (!rc->enabled || run_args->restore) return;
+
+	rcache_file_t* f = malloc(sizeof(rcache_file_t));
+	char path[RCACHE_PATH_MAX], tmp[RCACHE_PATH_MAX];
+	rcache_key(f, run_args, algo);
+	rcache_path(rc, f, path);
+	f->stat = *stat;
+	f->hdr.sum = rcache_sum(f);
+
+	// Write under a temporary name, so that concurrent runs never read a
+	// partial file.
+	snprintf(tmp, sizeof(tmp), "%s/.tmp-XXXXXX", rc->args->result_cache);
+	int fd = mkstemp(tmp);
+	if (fd < 0) {
+		fprintf(stderr, "WARNING: result cache %s: %s\n", tmp, strerror(errno));
+		free(f);
+		return;
+	}
+	int ok = write(fd, f, sizeof(rcache_file_t)) == sizeof(rcache_file_t);
+	ok = close(fd) == 0 && ok;
+	if (!ok || rename(tmp, path) != 0) {
+		fprintf(stderr, "WARNING: result cache %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+	}
+	free(f);
+
+	rcache_evict(rc);
+}
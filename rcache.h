@@ -0,0 +1,43 @@
+#ifndef OPSYS_SIM_RCACHE_H_
+#define OPSYS_SIM_RCACHE_H_
+
+#include "algo.h"
+#include "args.h"
+
+// Bump whenever a change alters the results of existing options, so that
+// results cached by older simulators are no longer found.
+#define RCACHE_VERSION 3
+
+/**
+ * On-disk cache of results in directory args->result_cache, one file per
+ * algorithm and run options. The options include the seed and workload
+ * parameters, which identify the workload; options that do not change the
+ * results, like --quiet, are left out of the key.
+ *
+ * Each file holds the full key, so hash collisions and files of other
+ * simulator versions are never mistaken for a hit, and a checksum, so
+ * corrupt files are not either. The directory is kept under
+ * args->result_cache_size KiB by removing the least recently used results.
+ */
+typedef struct {
+	int enabled; // Whether args asked for a result cache.
+	const args_t* args;
+} rcache_t;
+
+void rcache_init(rcache_t* rc, const args_t* args);
+
+/**
+ * Look up the results of algorithm algo run with options run_args.
+ * @return Whether they were found, in which case they are copied to *out.
+ */
+int rcache_get(rcache_t* rc, const args_t* run_args, const char* algo,
+               algo_stat_t* out);
+
+/**
+ * Store the results stat of algorithm algo run with options run_args, then
+ * evict old results until the cache fits its size.
+ */
+void rcache_put(rcache_t* rc, const args_t* run_args, const char* algo,
+                const algo_stat_t* stat);
+
+#endif // OPSYS_SIM_RCACHE_H_
@@ -0,0 +1,632 @@
+#include "server.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "cpusched.h"
+#include "queue.h"
+
+// Contexts, and so workloads, kept between requests.
+#define SERVER_CONTEXTS 64
+
+// Longest algorithm name and id accepted in a request.
+#define SERVER_NAME_MAX 32
+#define SERVER_ID_MAX 64
+
+typedef struct {
+	args_t key;    // Options it was created with.
+	cpusched_t* cs;
+	long used;     // When it was last used, counted in requests.
+	int refs;      // Requests using it.
+	int kept;      // Whether it is in the table, or freed once unused.
+} server_ctx_t;
+
+typedef struct {
+	int fd;               // Where its responses go.
+	pthread_mutex_t lock; // Keeps responses whole; guards refs.
+	int refs;             // Its reader and its requests in flight.
+} server_conn_t;
+
+typedef struct {
+	long seq; // Order of arrival.
+	server_conn_t* conn;
+	char* line;
+	double t_read; // When it was read, in ms.
+} server_job_t;
+
+typedef struct {
+	const args_t* args;
+	int argc; // The server's command line, the base of every request's.
+	char** argv;
+	pthread_mutex_t lock; // Guards everything below.
+	pthread_cond_t ready; // Jobs were queued, or the server is stopping.
+	queue_t* jobs;
+	long seq;
+	int stopping;
+	server_ctx_t* ctx[SERVER_CONTEXTS];
+	int n_ctx;
+	long uses;
+} server_t;
+
+typedef struct {
+	char id[SERVER_ID_MAX]; // As JSON, echoed back.
+	char algo[SERVER_NAME_MAX];
+	char* args;             // NULL if not given.
+} server_req_t;
+
+static double now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int job_cmp(const void* lhs, const void* rhs) {
+	const server_job_t *l = lhs, *r = rhs;
+	return l->seq < r->seq ? -1 : (l->seq > r->seq);
+}
+
+static const char* json_skip_ws(const char* s) {
+	while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') ++s;
+	return s;
+}
+
+/**
+ * Parse the JSON string at s into out, of size len, cutting it if longer;
+ * out may be NULL to skip it. \u escapes beyond ASCII become '?'.
+ * @return Where the string ends, or NULL if it is malformed.
+ */
+static const char* json_parse_str(const char* s, char* out, size_t len) {
+	if (*s++ != '"') return NULL;
+	size_t k = 0;
+	for (; *s != '"'; ++s) {
+		char c = *s;
+		if (c == '\0') return NULL;
+		if (c == '\\') {
+			switch (*++s) {
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
+			case '"':
+			case '\\':
+			case '/': c = *s; break;
+			case 'u': {
+				unsigned u = 0;
+				for (int i = 1; i <= 4; ++i) {
+					char h = s[i];
+					if (h >= '0' && h <= '9') u = u * 16 + (h - '0');
+					else if (h >= 'a' && h <= 'f') u = u * 16 + (h - 'a' + 10);
+					else if (h >= 'A' && h <= 'F') u = u * 16 + (h - 'A' + 10);
+					else return NULL;
+				}
+				s += 4;
+				c = u < 0x80 ? (char) u : '?';
+				break;
+			}
+			default:
+				return NULL;
+			}
+		}
+		if (out && k + 1 < len) out[k++] = c;
+	}
+	if (out) out[k] = '\0';
+	return s + 1;
+}
+
+/**
+ * Skip the JSON number, true, false or null at s.
+ * @return Where it ends, or NULL if there is none.
+ */
+static const char* json_scalar(const char* s) {
+	static const char* const words[] = {"true", "false", "null"};
+	for (int i = 0; i < 3; ++i) {
+		size_t len = strlen(words[i]);
+		if (strncmp(s, words[i], len) == 0) return s + len;
+	}
+
+	// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+	if (*s == '-') ++s;
+	if (*s == '0') {
+		++s;
+	} else if (*s >= '1' && *s <= '9') {
+		while (*s >= '0' && *s <= '9') ++s;
+	} else {
+		return NULL;
+	}
+	if (*s == '.') {
+		if (*++s < '0' || *s > '9') return NULL;
+		while (*s >= '0' && *s <= '9') ++s;
+	}
+	if (*s == 'e' || *s == 'E') {
+		if (*++s == '+' || *s == '-') ++s;
+		if (*s < '0' || *s > '9') return NULL;
+		while (*s >= '0' && *s <= '9') ++s;
+	}
+	return s;
+}
+
+/**
+ * Parse request line into req: a JSON object of strings and scalars.
+ * @return NULL, or what is wrong with it.
+ */
+static const char* server_parse_req(const char* line, server_req_t* req) {
+	*req = (server_req_t){.id = "null"};
+	const char* s = json_skip_ws(line);
+	if (*s++ != '{') return "Request is not a JSON object";
+	s = json_skip_ws(s);
+	while (*s != '}') {
+		char key[SERVER_NAME_MAX];
+		if ((s = json_parse_str(s, key, sizeof(key))) == NULL)
+			return "Malformed request";
+		s = json_skip_ws(s);
+		if (*s++ != ':') return "Malformed request";
+		s = json_skip_ws(s);
+
+		const char* v = s;
+		if (strcmp(key, "algo") == 0) {
+			s = json_parse_str(s, req->algo, sizeof(req->algo));
+		} else if (strcmp(key, "args") == 0) {
+			free(req->args);
+			req->args = malloc(strlen(s) + 1);
+			s = json_parse_str(s, req->args, strlen(s) + 1);
+		} else if (*s == '"') {
+			s = json_parse_str(s, NULL, 0);
+		} else if (*s == '{' || *s == '[') {
+			return "Nested values are not supported";
+		} else {
+			s = json_scalar(s);
+			if (s && *s && !strchr(",} \t\r\n", *s)) s = NULL;
+		}
+		if (s == NULL) return "Malformed request";
+		if (strcmp(key, "id") == 0) {
+			if ((size_t) (s - v) >= sizeof(req->id)) return "Request id is too long";
+			memcpy(req->id, v, s - v);
+			req->id[s - v] = '\0';
+		}
+		s = json_skip_ws(s);
+		if (*s == ',') {
+			s = json_skip_ws(s + 1);
+		} else if (*s != '}') {
+			return "Malformed request";
+		}
+	}
+	if (*json_skip_ws(s + 1) != '\0') return "Malformed request";
+	if (req->algo[0] == '\0') return "Request names no algo";
+	return NULL;
+}
+
+/**
+ * Parse the options of request req into cfg.
+ * @return 0, or -1 with the reason in err, of size err_len.
+ */
+static int server_options(const server_t* sv, server_req_t* req, args_t* cfg,
+                          char* err, size_t err_len) {
+	char none[1] = "";
+	char* words = req->args ? req->args : none;
+	int cap = sv->argc + strlen(words) / 2 + 2;
+	char** argv = malloc(cap * sizeof(char*));
+	int argc = 0;
+	char* save;
+	char* w = strtok_r(words, " \t\r\n", &save);
+	if (w == NULL || strncmp(w, "--", 2) == 0) {
+		for (int i = 0; i < sv->argc; ++i) argv[argc++] = sv->argv[i];
+	} else {
+		argv[argc++] = sv->argv[0];
+	}
+	for (; w; w = strtok_r(NULL, " \t\r\n", &save)) argv[argc++] = w;
+	argv[argc] = NULL;
+
+	int r = cpusched_config_parse(cfg, argc, argv, err, err_len);
+	free(argv);
+	if (r != CPUSCHED_OK) return -1;
+
+	// Paths point into the request, which is freed once answered; only the
+	// server's own may be used.
+	const args_t* a = sv->args;
+	if ((cfg->checkpoint && cfg->checkpoint != a->checkpoint) ||
+	    (cfg->checkpoint_of && cfg->checkpoint_of != a->checkpoint_of) ||
+	    (cfg->restore && cfg->restore != a->restore) ||
+	    (cfg->result_cache && cfg->result_cache != a->result_cache) ||
+	    (cfg->workload_cache && cfg->workload_cache != a->workload_cache) ||
+	    cfg->burst_log) {
+		snprintf(err, err_len, "Requests cannot set checkpoints, caches or logs");
+		return -1;
+	}
+	cfg->serve = NULL;
+	cfg->workers = 0;
+	cfg->quiet = 1;
+	cfg->print_window = 0;
+	return 0;
+}
+
+static void server_release(server_t* sv, server_ctx_t* c);
+
+/**
+ * Get a context for options cfg, kept or new, and hold it. A new one copies
+ * the workload of a kept one that draws the same.
+ * @return The context, or NULL with the reason in err, of size err_len.
+ */
+static server_ctx_t* server_acquire(server_t* sv, const args_t* cfg,
+                                    int* warm, char* err, size_t err_len) {
+	server_ctx_t* base = NULL;
+	pthread_mutex_lock(&sv->lock);
+	for (int i = 0; i < sv->n_ctx; ++i) {
+		server_ctx_t* c = sv->ctx[i];
+		if (memcmp(&c->key, cfg, sizeof(args_t)) == 0) {
+			c->refs++;
+			c->used = ++sv->uses;
+			pthread_mutex_unlock(&sv->lock);
+			*warm = 1;
+			return c;
+		}
+		// Other options may still draw the same workload.
+		if (base == NULL && cpusched_same_workload(c->cs, cfg)) base = c;
+	}
+	if (base) base->refs++;
+	pthread_mutex_unlock(&sv->lock);
+
+	// Copy or draw the workload outside the lock.
+	*warm = base != NULL;
+	cpusched_t* cs;
+	int r = base ? cpusched_derive(&cs, base->cs, cfg, err, err_len)
+	             : cpusched_create(&cs, cfg, err, err_len);
+	if (base) server_release(sv, base);
+	if (r == CPUSCHED_ENOMEM) snprintf(err, err_len, "%s", cpusched_strerror(r));
+	if (r != CPUSCHED_OK) return NULL;
+	server_ctx_t* c = malloc(sizeof(server_ctx_t));
+	*c = (server_ctx_t){.cs = cs, .refs = 1};
+	memcpy(&c->key, cfg, sizeof(args_t)); // Padding included, for memcmp().
+
+	// Keep it in place of the least recently used unused context, if any,
+	// unless another request made one meanwhile.
+	pthread_mutex_lock(&sv->lock);
+	for (int i = 0; i < sv->n_ctx; ++i) {
+		if (memcmp(&sv->ctx[i]->key, cfg, sizeof(args_t)) == 0) {
+			server_ctx_t* other = sv->ctx[i];
+			other->refs++;
+			other->used = ++sv->uses;
+			pthread_mutex_unlock(&sv->lock);
+			cpusched_free(c->cs);
+			free(c);
+			return other;
+		}
+	}
+	c->used = ++sv->uses;
+	int slot = sv->n_ctx < SERVER_CONTEXTS ? sv->n_ctx : -1;
+	for (int i = 0; slot < 0 && i < sv->n_ctx; ++i) {
+		if (sv->ctx[i]->refs == 0 &&
+		    (slot < 0 || sv->ctx[i]->used < sv->ctx[slot]->used))
+			slot = i;
+	}
+	server_ctx_t* old = NULL;
+	if (slot >= 0) {
+		if (slot == sv->n_ctx) {
+			sv->n_ctx++;
+		} else {
+			old = sv->ctx[slot];
+		}
+		sv->ctx[slot] = c;
+		c->kept = 1;
+	}
+	pthread_mutex_unlock(&sv->lock);
+
+	if (old) {
+		cpusched_free(old->cs);
+		free(old);
+	}
+	return c;
+}
+
+static void server_release(server_t* sv, server_ctx_t* c) {
+	pthread_mutex_lock(&sv->lock);
+	int gone = --c->refs == 0 && !c->kept;
+	pthread_mutex_unlock(&sv->lock);
+	if (gone) {
+		cpusched_free(c->cs);
+		free(c);
+	}
+}
+
+static void server_conn_put(server_conn_t* conn) {
+	pthread_mutex_lock(&conn->lock);
+	int gone = --conn->refs == 0;
+	pthread_mutex_unlock(&conn->lock);
+	if (gone) {
+		close(conn->fd);
+		pthread_mutex_destroy(&conn->lock);
+		free(conn);
+	}
+}
+
+static void server_respond(server_conn_t* conn, const char* buf, size_t len) {
+	pthread_mutex_lock(&conn->lock);
+	while (len > 0) {
+		ssize_t w = write(conn->fd, buf, len);
+		if (w < 0 && errno == EINTR) continue;
+		if (w <= 0) break; // The client is gone.
+		buf += w;
+		len -= w;
+	}
+	pthread_mutex_unlock(&conn->lock);
+}
+
+static void json_str(FILE* f, const char* s) {
+	fputc('"', f);
+	for (; *s; ++s) {
+		unsigned char c = *s;
+		if (c == '"' || c == '\\') {
+			fprintf(f, "\\%c", c);
+		} else if (c == '\n') {
+			fputs("\\n", f);
+		} else if (c < 0x20) {
+			fprintf(f, "\\u%04x", c);
+		} else {
+			fputc(c, f);
+		}
+	}
+	fputc('"', f);
+}
+
+static void json_num(FILE* f, double x) {
+	if (isfinite(x)) {
+		fprintf(f, "%.15g", x);
+	} else {
+		fputs("null", f);
+	}
+}
+
+static void json_sim_stat(FILE* f, const char* name, const sim_stat_t* s) {
+	fprintf(f, "\"%s\":{\"avg\":", name);
+	json_num(f, s->avg);
+	fputs(",\"cpu\":", f);
+	json_num(f, s->cpu_avg);
+	fputs(",\"io\":", f);
+	json_num(f, s->io_avg);
+	fputc('}', f);
+}
+
+static void json_stats(FILE* f, algo_stat_t* st) {
+	fputs("{\"cpu_util\":", f);
+	json_num(f, st->cpu_util);
+	fputc(',', f);
+	json_sim_stat(f, "burst", &st->t_burst);
+	fputc(',', f);
+	json_sim_stat(f, "wait", &st->t_wait);
+	fputc(',', f);
+	json_sim_stat(f, "turnaround", &st->t_turn);
+	fprintf(f, ",\"context_switches\":{\"cpu\":%d,\"io\":%d}", st->cs_cpu,
+	        st->cs_io);
+	fprintf(f, ",\"preemptions\":{\"cpu\":%d,\"io\":%d}", st->pre_cpu,
+	        st->pre_io);
+	fprintf(f, ",\"arrived\":%d,\"live_max\":%d", st->arrived, st->live_max);
+
+	// Everything else, as the report prints it.
+	char* report;
+	size_t len;
+	FILE* r = open_memstream(&report, &len);
+	print_algo_stat(r, st);
+	fclose(r);
+	fputs(",\"report\":", f);
+	json_str(f, report);
+	free(report);
+	fputc('}', f);
+}
+
+static void server_handle(server_t* sv, server_job_t* job) {
+	double t_start = now_ms();
+	char err[256] = "";
+	server_req_t req;
+	server_ctx_t* c = NULL;
+	int warm = 0, cached = 0;
+	algo_stat_t st;
+	double t_setup = t_start, t_run = t_start;
+
+	const char* bad = server_parse_req(job->line, &req);
+	if (bad) {
+		snprintf(err, sizeof(err), "%s", bad);
+	} else {
+		args_t cfg;
+		if (server_options(sv, &req, &cfg, err, sizeof(err)) == 0)
+			c = server_acquire(sv, &cfg, &warm, err, sizeof(err));
+		t_setup = now_ms();
+		if (c) {
+			cached = cpusched_stats(c->cs, req.algo, &st) == CPUSCHED_OK;
+			int r = cached ? CPUSCHED_OK : cpusched_run(c->cs, req.algo, &st);
+			if (r != CPUSCHED_OK)
+				snprintf(err, sizeof(err), "%s", cpusched_strerror(r));
+			server_release(sv, c);
+		}
+		t_run = now_ms();
+	}
+	free(req.args);
+
+	char* buf;
+	size_t len;
+	FILE* f = open_memstream(&buf, &len);
+	fprintf(f, "{\"id\":%s,\"ok\":%s", req.id, err[0] ? "false" : "true");
+	if (err[0]) {
+		fputs(",\"error\":", f);
+		json_str(f, err);
+	} else {
+		fputs(",\"algo\":", f);
+		json_str(f, req.algo);
+		fprintf(f, ",\"workload\":\"%s\",\"cached\":%s", warm ? "warm" : "new",
+		        cached ? "true" : "false");
+	}
+	double t_end = now_ms();
+	fprintf(f,
+	        ",\"time_ms\":{\"queued\":%.3f,\"setup\":%.3f,\"run\":%.3f,"
+	        "\"total\":%.3f}",
+	        t_start - job->t_read, t_setup - t_start, t_run - t_setup,
+	        t_end - job->t_read);
+	if (!err[0]) {
+		fputs(",\"stats\":", f);
+		json_stats(f, &st);
+	}
+	fputs("}\n", f);
+	fclose(f);
+
+	server_respond(job->conn, buf, len);
+	free(buf);
+	server_conn_put(job->conn);
+	free(job->line);
+	free(job);
+}
+
+static void* server_worker(void* v) {
+	server_t* sv = v;
+	pthread_mutex_lock(&sv->lock);
+	for (;;) {
+		server_job_t* job;
+		while ((job = queue_pop(sv->jobs)) == NULL && !sv->stopping)
+			pthread_cond_wait(&sv->ready, &sv->lock);
+		if (job == NULL) break;
+		pthread_mutex_unlock(&sv->lock);
+		server_handle(sv, job);
+		pthread_mutex_lock(&sv->lock);
+	}
+	pthread_mutex_unlock(&sv->lock);
+	return NULL;
+}
+
+/**
+ * Queue the requests read from in, answering them on conn.
+ */
+static void server_read(server_t* sv, server_conn_t* conn, FILE* in) {
+	char* line = NULL;
+	size_t cap = 0;
+	while (getline(&line, &cap, in) > 0) {
+		if (*json_skip_ws(line) == '\0') continue;
+		server_job_t* job = malloc(sizeof(server_job_t));
+		*job = (server_job_t){
+		    .conn = conn, .line = strdup(line), .t_read = now_ms()};
+		pthread_mutex_lock(&conn->lock);
+		conn->refs++;
+		pthread_mutex_unlock(&conn->lock);
+
+		pthread_mutex_lock(&sv->lock);
+		job->seq = sv->seq++;
+		queue_push(sv->jobs, job);
+		pthread_cond_signal(&sv->ready);
+		pthread_mutex_unlock(&sv->lock);
+	}
+	free(line);
+	server_conn_put(conn);
+}
+
+static server_conn_t* server_conn(int fd) {
+	server_conn_t* conn = malloc(sizeof(server_conn_t));
+	*conn = (server_conn_t){.fd = fd, .refs = 1};
+	pthread_mutex_init(&conn->lock, NULL);
+	return conn;
+}
+
+typedef struct {
+	server_t* sv;
+	int fd;
+} server_client_t;
+
+static void* server_client(void* v) {
+	server_client_t* cl = v;
+	server_conn_t* conn = server_conn(cl->fd);
+	FILE* in = fdopen(dup(cl->fd), "r");
+	if (in) {
+		server_read(cl->sv, conn, in);
+		fclose(in);
+	} else {
+		server_conn_put(conn);
+	}
+	free(cl);
+	return NULL;
+}
+
+/**
+ * Accept clients on the socket at path until the process ends.
+ * @return -1 if the socket cannot be served.
+ */
+static int server_listen(server_t* sv, const char* path) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "ERROR: socket path %s is too long\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	// A socket left behind by an earlier server is replaced; nothing else is.
+	struct stat st;
+	if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+	    listen(fd, 64) != 0) {
+		fprintf(stderr, "ERROR: socket %s: %s\n", path, strerror(errno));
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+
+	for (;;) {
+		int c = accept(fd, NULL, NULL);
+		if (c < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			fprintf(stderr, "ERROR: socket %s: %s\n", path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		server_client_t* cl = malloc(sizeof(server_client_t));
+		*cl = (server_client_t){.sv = sv, .fd = c};
+		pthread_t t;
+		if (pthread_create(&t, NULL, server_client, cl) != 0) {
+			close(c);
+			free(cl);
+			continue;
+		}
+		pthread_detach(t);
+	}
+}
+
+int run_server(const args_t* args, int argc, char* argv[]) {
+	server_t sv = {.args = args, .argc = argc, .argv = argv};
+	pthread_mutex_init(&sv.lock, NULL);
+	pthread_cond_init(&sv.ready, NULL);
+	sv.jobs = make_queue();
+	queue_set_cmp(sv.jobs, job_cmp);
+
+	// A client that hangs up must not end the server.
+	signal(SIGPIPE, SIG_IGN);
+
+	pthread_t* workers = malloc(args->workers * sizeof(pthread_t));
+	for (int i = 0; i < args->workers; ++i)
+		pthread_create(&workers[i], NULL, server_worker, &sv);
+
+	int r = 0;
+	if (strcmp(args->serve, "-") == 0) {
+		server_read(&sv, server_conn(dup(STDOUT_FILENO)), stdin);
+	} else {
+		r = server_listen(&sv, args->serve);
+	}
+
+	// Answer what was read, then stop.
+	pthread_mutex_lock(&sv.lock);
+	sv.stopping = 1;
+	pthread_cond_broadcast(&sv.ready);
+	pthread_mutex_unlock(&sv.lock);
+	for (int i = 0; i < args->workers; ++i) pthread_join(workers[i], NULL);
+	free(workers);
+
+	for (int i = 0; i < sv.n_ctx; ++i) {
+		cpusched_free(sv.ctx[i]->cs);
+		free(sv.ctx[i]);
+	}
+	free_queue(&sv.jobs);
+	pthread_cond_destroy(&sv.ready);
+	pthread_mutex_destroy(&sv.lock);
+	return r;
+}
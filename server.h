@@ -0,0 +1,33 @@
+#ifndef OPSYS_SIM_SERVER_H_
+#define OPSYS_SIM_SERVER_H_
+
+#include "args.h"
+
+/**
+ * Serve simulation requests on the Unix domain socket at args->serve, or on
+ * stdin and stdout if it is "-", with args->workers threads. Requests and
+ * responses are JSON objects, one per line:
+ *
+ *   {"id": 1, "algo": "MC-RR", "args": "--warmup=10000 --cpus=2"}
+ *   {"id": 2, "algo": "SJF", "args": "8 3 32 0.001 1024 4 0.5 256"}
+ *
+ * args is a command line split at whitespace. If it starts with options, it
+ * is appended to the server's own command line argv, so later options win;
+ * otherwise it replaces it, required arguments included, as it must to set
+ * one of those, such as alpha in the second request. Requests may not
+ * set checkpoints, caches or burst logs of their own. Each response echoes
+ * the id and carries the results (or an error) and the time the request
+ * spent queued, setting up and running.
+ *
+ * Workloads are kept warm between requests: a context per distinct set of
+ * options, least recently used first out, keeps the results of the
+ * algorithms already run with them, and a new context copies the workload
+ * of a kept one whose options draw the same (see cpusched_same_workload())
+ * instead of drawing it again. Responses to the requests of a
+ * connection may come out of order.
+ *
+ * @return 0 once stdin ends, or -1 if the socket cannot be served.
+ */
+int run_server(const args_t* args, int argc, char* argv[]);
+
+#endif // OPSYS_SIM_SERVER_H_
@@ -0,0 +1,19 @@
+#ifndef OPSYS_SIM_SIMTIME_H_
+#define OPSYS_SIM_SIMTIME_H_
+
+#include <limits.h>
+
+/**
+ * Simulated time, in ms. 64 bits cover horizons of millions of years.
+ */
+typedef unsigned long long sim_time_t;
+
+#define SIM_TIME_MAX ULLONG_MAX
+
+/**
+ * Compare times a and b without subtracting them, which would overflow:
+ * < 0, 0 or > 0 as a is before, at or after b.
+ */
+#define SIM_TIME_CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+#endif // OPSYS_SIM_SIMTIME_H_
@@ -0,0 +1,179 @@
+#include "study.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "algo.h"
+#include "converge.h"
+#include "exp_rand.h"
+#include "process.h"
+#include "rcache.h"
+#include "wcache.h"
+
+#define STUDY_METRICS 2
+
+static const char* metric_names[STUDY_METRICS] = {"wait", "turnaround"};
+
+static double study_metric(const algo_stat_t* s, int m) {
+	return m == 0 ? s->t_wait.avg : s->t_turn.avg;
+}
+
+typedef struct {
+	double mean;
+	double var;  // Sample variance of one unit.
+	double half; // 95% confidence half-width of the mean.
+} est_t;
+
+static est_t estimate(const double* x, int m) {
+	est_t e = {0};
+	for (int i = 0; i < m; ++i) e.mean += x[i];
+	e.mean /= m;
+	for (int i = 0; i < m; ++i) e.var += (x[i] - e.mean) * (x[i] - e.mean);
+	e.var /= m - 1;
+	e.half = t975(m - 1) * sqrt(e.var / m);
+	return e;
+}
+
+typedef struct {
+	const args_t* args;
+	int units;  // Independent units: replications, or antithetic pairs.
+	double* x;  // Per-run results: x[(a * reps + r) * STUDY_METRICS + m].
+	double* u;  // Per-unit results, same layout with units for reps.
+} study_t;
+
+static double* study_run(study_t* s, int a, int r) {
+	return &s->x[(a * s->args->reps + r) * STUDY_METRICS];
+}
+
+static double* study_unit(study_t* s, int a, int k) {
+	return &s->u[(a * s->units + k) * STUDY_METRICS];
+}
+
+static void print_study(FILE* f, study_t* s) {
+	const args_t* args = s->args;
+	double* y = calloc(s->units, sizeof(double));
+
+	fprintf(f, "Study of %d replications", args->reps);
+	if (args->antithetic) fprintf(f, " (%d antithetic pairs)", s->units);
+	fprintf(f, " with common random numbers\n");
+
+	for (int a = 0; a < n_algos; ++a) {
+		if (!algo_enabled(&algos[a], args)) continue;
+		fprintf(f, "\nAlgorithm %s\n", algos[a].name);
+		for (int m = 0; m < STUDY_METRICS; ++m) {
+			for (int k = 0; k < s->units; ++k) y[k] = study_unit(s, a, k)[m];
+			est_t e = estimate(y, s->units);
+			fprintf(f, "-- average %s time: %.3f ms +/- %.3f ms", metric_names[m],
+			        e.mean, e.half);
+			if (args->antithetic) {
+				// Compare with the same number of independent runs.
+				double* z = calloc(args->reps, sizeof(double));
+				for (int r = 0; r < args->reps; ++r) z[r] = study_run(s, a, r)[m];
+				est_t plain = estimate(z, args->reps);
+				free(z);
+				fprintf(f, " (antithetic variance reduction x%.2f)",
+				        (plain.var / args->reps) / (e.var / s->units));
+			}
+			fprintf(f, "\n");
+		}
+	}
+
+	fprintf(f, "\nPaired differences\n");
+	for (int a = 0; a < n_algos; ++a) {
+		for (int b = a + 1; b < n_algos; ++b) {
+			if (!algo_enabled(&algos[a], args) || !algo_enabled(&algos[b], args))
+				continue;
+			for (int m = 0; m < STUDY_METRICS; ++m) {
+				double var_a = 0.0, var_b = 0.0;
+				for (int k = 0; k < s->units; ++k) y[k] = study_unit(s, a, k)[m];
+				var_a = estimate(y, s->units).var;
+				for (int k = 0; k < s->units; ++k) y[k] = study_unit(s, b, k)[m];
+				var_b = estimate(y, s->units).var;
+				for (int k = 0; k < s->units; ++k)
+					y[k] = study_unit(s, b, k)[m] - study_unit(s, a, k)[m];
+				est_t d = estimate(y, s->units);
+				fprintf(f,
+				        "-- %s - %s %s time: %.3f ms +/- %.3f ms "
+				        "(common random numbers variance reduction x%.2f)\n",
+				        algos[b].name, algos[a].name, metric_names[m], d.mean, d.half,
+				        (var_a + var_b) / d.var);
+			}
+		}
+	}
+
+	free(y);
+}
+
+void run_study(const args_t* args) {
+	study_t s = {.args = args,
+	             .units = args->antithetic ? args->reps / 2 : args->reps};
+	s.x = calloc(n_algos * args->reps * STUDY_METRICS, sizeof(double));
+	s.u = calloc(n_algos * s.units * STUDY_METRICS, sizeof(double));
+
+	printf("<<< STUDY -- %d replications of n=%d processes ", args->reps,
+	       args->n);
+	printf("(seeds %ld to %ld) >>>\n", args->seed,
+	       args->seed + s.units - 1);
+
+	rcache_t rc;
+	rcache_init(&rc, args);
+	args_t r_args = *args;
+	r_args.reps = 0;
+	r_args.quiet = 1;
+	for (int r = 0; r < args->reps; ++r) {
+		r_args.seed = args->seed + (args->antithetic ? r / 2 : r);
+		r_args.antithetic = args->antithetic && r % 2 == 1;
+
+		process_t* processes;
+		if (args->open_rate > 0) {
+			processes = calloc(args->n, sizeof(process_t));
+		} else {
+			exp_rng_t rng;
+			seed_exp_r(&rng, r_args.seed);
+			rng.antithetic = r_args.antithetic;
+			processes = wcache_generate(args, &rng);
+			assign_attributes(processes, args->n, args, &rng);
+		}
+
+		process_t* p_copy = calloc(args->n, sizeof(process_t));
+		for (int a = 0; a < n_algos; ++a) {
+			if (!algo_enabled(&algos[a], args)) continue;
+			algo_stat_t stat;
+			if (!rcache_get(&rc, &r_args, algos[a].name, &stat)) {
+				copy_process_array(p_copy, processes, args->n);
+				stat = algos[a].run(&r_args, p_copy);
+				if (stat.error) exit(EXIT_FAILURE);
+				rcache_put(&rc, &r_args, algos[a].name, &stat);
+			}
+			for (int m = 0; m < STUDY_METRICS; ++m)
+				study_run(&s, a, r)[m] = study_metric(&stat, m);
+		}
+
+		free_process_array(processes, args->n);
+		free_process_array(p_copy, args->n);
+		free(p_copy);
+		free(processes);
+	}
+
+	// Antithetic pairs are averaged into one unit.
+	int per_unit = args->reps / s.units;
+	for (int a = 0; a < n_algos; ++a)
+		for (int r = 0; r < args->reps; ++r)
+			for (int m = 0; m < STUDY_METRICS; ++m)
+				study_unit(&s, a, r / per_unit)[m] += study_run(&s, a, r)[m] / per_unit;
+
+	print_study(stdout, &s);
+
+	FILE* f = fopen("simout.txt", "w");
+	if (f == NULL) {
+		perror("ERROR: fopen");
+		exit(EXIT_FAILURE);
+	}
+	print_study(f, &s);
+	if (fclose(f) != 0) {
+		perror("ERROR: fclose");
+		exit(EXIT_FAILURE);
+	}
+
+	free(s.x);
+	free(s.u);
+}
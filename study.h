@@ -0,0 +1,19 @@
+#ifndef OPSYS_SIM_STUDY_H_
+#define OPSYS_SIM_STUDY_H_
+
+#include "args.h"
+
+/**
+ * Run args->reps replications of every algorithm and report each
+ * algorithm's mean wait and turnaround times with 95% confidence intervals,
+ * plus the paired differences between algorithms, to stdout and simout.txt.
+ *
+ * Replication r draws its workload from seed + r, and every algorithm in a
+ * replication runs on that same workload (common random numbers). With
+ * args->antithetic, replications come in pairs sharing a seed where the
+ * second draws 1 - U for every uniform U. The variance reduction achieved by
+ * each technique is reported next to the estimates.
+ */
+void run_study(const args_t* args);
+
+#endif // OPSYS_SIM_STUDY_H_
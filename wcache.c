@@ -0,0 +1,177 @@
+#include "wcache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash.h"
+
+#define WCACHE_MAGIC "SIMWKL1"
+#define WCACHE_PATH_MAX 4096
+
+/**
+ * A workload file: this header, then a wcache_proc_t per process, then the
+ * bursts of every process, its CPU bursts followed by its I/O bursts. All of
+ * it can be used in place once mapped.
+ */
+typedef struct {
+	char magic[8];
+	uint32_t version; // WCACHE_VERSION
+	int32_t n, n_cpu;
+	int32_t antithetic;
+	double lambda;
+	uint64_t exp_max;
+	uint16_t start[3]; // State of the generator before the workload,
+	uint16_t end[3];   // ... and after it.
+	int64_t bursts;    // Bursts stored.
+	uint64_t sum;      // FNV-1a of everything after the header.
+} wcache_hdr_t;
+
+typedef struct {
+	int64_t arrival_time;
+	int32_t cpu_bound;
+	int32_t cpu_burst_ct;
+	int32_t first; // Index of its first burst.
+} wcache_proc_t;
+
+/**
+ * Fill in the key fields of header h.
+ */
+static void wcache_key(wcache_hdr_t* h, const args_t* args,
+                       const exp_rng_t* rng) {
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, WCACHE_MAGIC, sizeof(h->magic));
+	h->version = WCACHE_VERSION;
+	h->n = args->n;
+	h->n_cpu = args->n_cpu;
+	h->antithetic = rng->antithetic;
+	h->lambda = args->lambda;
+	h->exp_max = args->exp_max;
+	memcpy(h->start, rng->xsubi, sizeof(h->start));
+}
+
+/**
+ * Map the file at path and copy its workload out if it matches key.
+ * @return The processes, or NULL if the file is missing or does not match.
+ */
+static process_t* wcache_load(const char* path, const wcache_hdr_t* key,
+                              exp_rng_t* rng) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(wcache_hdr_t)) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = st.st_size;
+	const char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return NULL;
+
+	const wcache_hdr_t* h = (const wcache_hdr_t*) map;
+	const wcache_proc_t* wp = (const wcache_proc_t*) (h + 1);
+	const int32_t* bursts = (const int32_t*) (wp + key->n);
+	process_t* p = NULL;
+	if (memcmp(h, key, offsetof(wcache_hdr_t, end)) != 0 ||
+	    size != sizeof(*h) + key->n * sizeof(*wp) + h->bursts * sizeof(int32_t)) {
+		goto done;
+	}
+	if (fnv1a(FNV_OFFSET, wp, size - sizeof(*h)) != h->sum) {
+		fprintf(stderr, "WARNING: workload cache %s is corrupt; regenerating\n",
+		        path);
+		goto done;
+	}
+
+	p = calloc(key->n, sizeof(process_t));
+	for (int i = 0; i < key->n; ++i) {
+		int ct = wp[i].cpu_burst_ct;
+		p[i].id = 'A' + i;
+		p[i].cpu_bound = wp[i].cpu_bound;
+		p[i].arrival_time = wp[i].arrival_time;
+		p[i].cpu_burst_ct = ct;
+		p[i].cpu_bursts = malloc(ct * sizeof(int));
+		p[i].io_bursts = calloc(ct - 1, sizeof(int));
+		memcpy(p[i].cpu_bursts, bursts + wp[i].first, ct * sizeof(int));
+		memcpy(p[i].io_bursts, bursts + wp[i].first + ct, (ct - 1) * sizeof(int));
+	}
+	memcpy(rng->xsubi, h->end, sizeof(h->end));
+
+done:
+	munmap((void*) map, size);
+	return p;
+}
+
+/**
+ * Write workload p, drawn with key, to path.
+ */
+static void wcache_store(const char* dir, const char* path,
+                         const wcache_hdr_t* key, const process_t* p,
+                         const exp_rng_t* rng) {
+	wcache_hdr_t h = *key;
+	memcpy(h.end, rng->xsubi, sizeof(h.end));
+	for (int i = 0; i < key->n; ++i) h.bursts += 2 * p[i].cpu_burst_ct - 1;
+
+	size_t size = key->n * sizeof(wcache_proc_t) + h.bursts * sizeof(int32_t);
+	char* body = calloc(1, size);
+	wcache_proc_t* wp = (wcache_proc_t*) body;
+	int32_t* bursts = (int32_t*) (wp + key->n);
+	for (int i = 0, first = 0; i < key->n; ++i) {
+		int ct = p[i].cpu_burst_ct;
+		wp[i] = (wcache_proc_t){.arrival_time = p[i].arrival_time,
+		                        .cpu_bound = p[i].cpu_bound,
+		                        .cpu_burst_ct = ct,
+		                        .first = first};
+		memcpy(bursts + first, p[i].cpu_bursts, ct * sizeof(int));
+		memcpy(bursts + first + ct, p[i].io_bursts, (ct - 1) * sizeof(int));
+		first += 2 * ct - 1;
+	}
+	h.sum = fnv1a(FNV_OFFSET, body, size);
+
+	// Write under a temporary name, so that concurrent runs never map a
+	// partial file.
+	char tmp[WCACHE_PATH_MAX];
+	snprintf(tmp, sizeof(tmp), "%s/.tmp-XXXXXX", dir);
+	int fd = mkstemp(tmp);
+	if (fd < 0) {
+		fprintf(stderr, "WARNING: workload cache %s: %s\n", tmp, strerror(errno));
+		free(body);
+		return;
+	}
+	int ok = write(fd, &h, sizeof(h)) == sizeof(h) &&
+	         write(fd, body, size) == (ssize_t) size;
+	ok = close(fd) == 0 && ok;
+	if (!ok || rename(tmp, path) != 0) {
+		fprintf(stderr, "WARNING: workload cache %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+	}
+	free(body);
+}
+
+process_t* wcache_generate(const args_t* args, exp_rng_t* rng) {
+	const char* dir = args->workload_cache;
+	if (dir == NULL)
+		return generate_processes_r(args->n, args->n_cpu, rng, args->lambda,
+		                            args->exp_max);
+
+	wcache_hdr_t key;
+	wcache_key(&key, args, rng);
+	char path[WCACHE_PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%016llx.wl", dir,
+	         (unsigned long long) fnv1a(FNV_OFFSET, &key, sizeof(key)));
+
+	process_t* p = wcache_load(path, &key, rng);
+	if (p) return p;
+
+	p = generate_processes_r(args->n, args->n_cpu, rng, args->lambda,
+	                         args->exp_max);
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		fprintf(stderr, "WARNING: workload cache %s: %s\n", dir, strerror(errno));
+	} else {
+		wcache_store(dir, path, &key, p, rng);
+	}
+	return p;
+}
@@ -0,0 +1,24 @@
+#ifndef OPSYS_SIM_WCACHE_H_
+#define OPSYS_SIM_WCACHE_H_
+
+#include "args.h"
+#include "exp_rand.h"
+#include "process.h"
+
+// Bump whenever generate_processes_r() changes what it draws or the file
+// layout changes.
+#define WCACHE_VERSION 2
+
+/**
+ * Generate the args->n processes of a closed system from rng, as
+ * generate_processes_r() does. With args->workload_cache, the workload is
+ * mapped from a file in that directory, keyed by n, n_cpu, lambda, exp_max
+ * and the starting state of rng (the seed), and written there if missing.
+ * Files that fail their checksum are regenerated.
+ *
+ * Either way rng is left as if the workload had been drawn from it, so
+ * assign_attributes() draws the same attributes.
+ */
+process_t* wcache_generate(const args_t* args, exp_rng_t* rng);
+
+#endif // OPSYS_SIM_WCACHE_H_